@@ -0,0 +1,372 @@
+/*
+ *	Copyright (c) 2014 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ *
+ *	Based on:	Characterization of K-Complexes and Slow Wave Activity in a Neural Mass Model
+ *				A Weigenand, M Schellenberger Costa, H-VV Ngo, JC Claussen, T Martinetz
+ *				PLoS Computational Biology. 2014;10:e1003923
+ */
+
+/******************************************************************************/
+/*						Microbenchmarks of the simulation					  */
+/*																			  */
+/*	Usage:																	  */
+/*		benchmark [results.csv] [repeats]									  */
+/*		benchmark compare baseline.csv results.csv [threshold]				  */
+/*																			  */
+/*	Every case is run repeats times (default 15) after a warm up run, at the */
+/*	N2 and N3 parameters of Figures/Data_Time_Series.m with noise. Reported	  */
+/*	are the median time per simulation step, the median absolute deviation	  */
+/*	(MAD), the minimum and the resulting steps per second.					  */
+/*																			  */
+/*	For noise free columns the adaptive integrator (Dormand_Prince.h) is	  */
+/*	compared to SRK4 without noise on a stimulation protocol, reporting the  */
+/*	speedup, the evaluations of the vector field and the maximal deviation	  */
+/*	of Vp.																	  */
+/*																			  */
+/*	compare flags every case whose median grew by more than threshold		  */
+/*	(default 0.05) relative to the baseline and by more than 3 MAD of both	  */
+/*	runs, and exits with 1 if there is any regression.						  */
+/******************************************************************************/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Cortical_Column.h"
+#include "Data_Storage.h"
+#include "Dormand_Prince.h"
+#include "Simulation_Settings.h"
+#include "Stimulation.h"
+
+/******************************************************************************/
+/*                          Fixed simulation settings						  */
+/******************************************************************************/
+const Simulation_Settings Settings;
+const int Steps			= 1E5;		/* Simulation steps per repeat			  */
+const int Warm_up		= 2E4;		/* Steps before the measurement			  */
+
+/******************************************************************************/
+/*						Access to the stages of a step						  */
+/******************************************************************************/
+class Benchmark {
+public:
+    static void set_RK		(Cortical_Column& C, int N)	{C.set_RK(N);}
+    static void add_RK		(Cortical_Column& C)		{C.add_RK();}
+    static void fill_noise	(Cortical_Column& C)		{C.fill_noise();}
+    static void set_Vp		(Cortical_Column& C, double Vp) {C.Stepper.state()[Cortex_Model::Vp] = Vp;}
+
+    /* SRK4 without the noise that is drawn even for dphi == 0 */
+    static void zero_noise	(Cortical_Column& C) {
+        std::fill(C.Noise_std.begin(), C.Noise_std.end(), 0.0);
+        std::fill(C.Rand_vars.begin(), C.Rand_vars.end(), 0.0);
+    }
+};
+
+/******************************************************************************/
+/*								Statistics									  */
+/******************************************************************************/
+struct Statistics {
+    double median;		/* ns per step */
+    double mad;
+    double min;
+};
+
+static double median(std::vector<double> x) {
+    std::sort(x.begin(), x.end());
+    const unsigned n = x.size();
+    return n%2 ? x[n/2] : 0.5*(x[n/2-1] + x[n/2]);
+}
+
+static Statistics statistics(const std::vector<double>& x) {
+    const double m = median(x);
+    std::vector<double> deviation;
+    for (double value : x) {
+        deviation.push_back(std::abs(value - m));
+    }
+    return Statistics{m, median(deviation), *std::min_element(x.begin(), x.end())};
+}
+
+/* Runs the case repeats times and returns the time per step in ns. run has to
+ * perform Steps steps */
+static Statistics measure(const std::function<void(void)>& run, unsigned repeats) {
+    run();
+    std::vector<double> times;
+    for (unsigned r=0; r < repeats; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::nano>(end - start).count() / Steps);
+    }
+    return statistics(times);
+}
+
+/******************************************************************************/
+/*								Benchmark cases								  */
+/******************************************************************************/
+struct Result {
+    std::string	name;
+    std::string	parameters;
+    Statistics	stats;
+};
+
+static std::vector<Result> run_cases(const std::string& set, std::vector<double> Param,
+                                     unsigned repeats) {
+    std::vector<Result> results;
+    auto report = [&](const std::string& name, const Statistics& stats) {
+        results.push_back(Result{name, set, stats});
+        std::cout << std::left  << std::setw(16) << name << std::setw(4) << set << std::right
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(10) << stats.median << " ns/step +- "
+                  << std::setw(6)  << stats.mad << " (min " << std::setw(8) << stats.min << ")"
+                  << std::setprecision(0) << std::setw(12) << 1E9/stats.median << " steps/s\n";
+    };
+
+    /* Column after the transient, shared by all cases */
+    Cortical_Column Cortex(Param.data(), Settings, 1);
+    for (int t=0; t < Warm_up; ++t) {
+        Cortex.iterate_ODE();
+    }
+
+    /* Full step */
+    report("iterate_ODE", measure([&]() {
+        for (int t=0; t < Steps; ++t) {
+            Cortex.iterate_ODE();
+        }
+    }, repeats));
+
+    /* Single stages of the SRK4 scheme */
+    for (int N=0; N < 4; ++N) {
+        report("set_RK_" + std::to_string(N), measure([&]() {
+            for (int t=0; t < Steps; ++t) {
+                Benchmark::set_RK(Cortex, N);
+            }
+        }, repeats));
+    }
+    report("add_RK", measure([&]() {
+        for (int t=0; t < Steps; ++t) {
+            Benchmark::add_RK(Cortex);
+        }
+    }, repeats));
+
+    /* Noise of one step, generated in blocks */
+    report("noise", measure([&]() {
+        for (int t=0; t < Steps; t += Cortical_Column::Noise_block) {
+            Benchmark::fill_noise(Cortex);
+        }
+    }, repeats));
+
+    /* Stimulation protocol on a recorded trajectory of Vp */
+    std::vector<double> Vp(Steps);
+    Cortical_Column Trajectory(Param.data(), Settings, 2);
+    for (int t=0; t < Steps; ++t) {
+        Trajectory.iterate_ODE();
+        Vp[t] = get_channel(Trajectory, 0);
+    }
+    const std::vector<std::vector<double>> Stims = {
+        {0, 0,   0,   0, 0, 0, 0,    0},	/* none				*/
+        {1, 60,  120, 5, 1, 1, 0,    0},	/* semi-periodic	*/
+        {2, 60,  120, 0, 0, 2, 1050, 350}};	/* phase dependent	*/
+    for (unsigned mode=0; mode < Stims.size(); ++mode) {
+        report("check_stim_" + std::to_string(mode), measure([&]() {
+            std::vector<double> var_stim = Stims[mode];
+            Cortical_Column Target(Param.data(), Settings, 3);
+            Stim Stimulation(Target, var_stim.data(), Settings, 3);
+            const int onset = Settings.onset*Settings.res;
+            Stimulation.run(onset, onset + Steps, [&](int t) {
+                Benchmark::set_Vp(Target, Vp[t - onset]);
+            });
+        }, repeats));
+    }
+
+    /* Recording of the six channels */
+    std::vector<double> data(6*Steps/Settings.red);
+    std::vector<double*> pData;
+    for (unsigned i=0; i < 6; ++i) {
+        pData.push_back(&data[i*Steps/Settings.red]);
+    }
+    report("get_data", measure([&]() {
+        for (int t=0; t < Steps; ++t) {
+            if (t%Settings.red == 0) {
+                get_data(t/Settings.red, Cortex, pData);
+            }
+        }
+    }, repeats));
+    return results;
+}
+
+/* Adaptive against fixed step integration of a noise free column with the
+ * semi-periodic stimulation of Figures/Data_Stimulation.m */
+static std::vector<Result> run_adaptive(const std::string& set, std::vector<double> Param,
+                                        unsigned repeats) {
+    const int Time = 30*Settings.res;
+    std::vector<double> var_stim = {1, 100, 100, 7, 0, 1, 0, 0};
+    Param[2] = 0;
+
+    std::vector<double> Vp_fixed(Time), Vp_adaptive(Time);
+    unsigned long evaluations = 0;
+    auto fixed = [&]() {
+        Cortical_Column Cortex(Param.data(), Settings, 1);
+        Benchmark::zero_noise(Cortex);
+        Stim Stimulation(Cortex, var_stim.data(), Settings, 1);
+        Stimulation.run(0, Time, [&](int t) {
+            Cortex.iterate_ODE();
+            Vp_fixed[t] = get_channel(Cortex, 0);
+        });
+    };
+    auto adaptive = [&]() {
+        Cortical_Column Cortex(Param.data(), Settings, 1);
+        Stim Stimulation(Cortex, var_stim.data(), Settings, 1);
+        Dormand_Prince Solver(Cortex, Settings);
+        Stimulation.run(0, Time, [&](int t) {
+            Solver.step();
+            Vp_adaptive[t] = get_channel(Cortex, 0);
+        });
+        evaluations = Solver.evaluations();
+    };
+
+    /* Times are given per step of the fixed grid */
+    auto per_step = [Time](Statistics s) {
+        const double scale = double(Steps)/Time;
+        return Statistics{s.median*scale, s.mad*scale, s.min*scale};
+    };
+    const Statistics stats_fixed	= per_step(measure(fixed,	 repeats));
+    const Statistics stats_adaptive	= per_step(measure(adaptive, repeats));
+
+    double deviation = 0;
+    for (int t=0; t < Time; ++t) {
+        deviation = std::max(deviation, std::abs(Vp_fixed[t] - Vp_adaptive[t]));
+    }
+    std::cout << "deterministic " << set << ": speedup " << std::setprecision(1)
+              << stats_fixed.median/stats_adaptive.median << ", " << evaluations
+              << " evaluations instead of " << 4*Time << ", maximal deviation of Vp "
+              << std::scientific << std::setprecision(2) << deviation << " mV at tolerance "
+              << Settings.tolerance << std::fixed << "\n";
+    return {Result{"srk4_noise_free", set, stats_fixed},
+            Result{"dormand_prince", set, stats_adaptive}};
+}
+
+/******************************************************************************/
+/*								Result files								  */
+/******************************************************************************/
+static void write_results(const std::string& path, const std::vector<Result>& results,
+                          unsigned repeats) {
+    std::ofstream file(path);
+    file << "case,parameters,backend,steps,repeats,median_ns,mad_ns,min_ns,steps_per_s\n";
+    file << std::setprecision(6);
+    for (auto& r : results) {
+        file << r.name << "," << r.parameters << "," << MATH_BACKEND_NAME << ","
+             << Steps << "," << repeats << "," << r.stats.median << "," << r.stats.mad << ","
+             << r.stats.min << "," << 1E9/r.stats.median << "\n";
+    }
+}
+
+static bool read_results(const std::string& path, std::map<std::string, Statistics>& results) {
+    std::ifstream file(path);
+    std::string line;
+    if (!std::getline(file, line)) {
+        return false;
+    }
+    while (std::getline(file, line)) {
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, ',')) {
+            fields.push_back(field);
+        }
+        if (fields.size() != 9) {
+            return false;
+        }
+        results[fields[0] + " " + fields[1]] = Statistics{std::atof(fields[5].c_str()),
+                                                          std::atof(fields[6].c_str()),
+                                                          std::atof(fields[7].c_str())};
+    }
+    return true;
+}
+
+static int compare(const std::string& baseline, const std::string& current, double threshold) {
+    std::map<std::string, Statistics> base, cur;
+    if (!read_results(baseline, base) || !read_results(current, cur)) {
+        std::cerr << "could not read " << baseline << " or " << current << "\n";
+        return 2;
+    }
+
+    unsigned regressions = 0;
+    for (auto& entry : cur) {
+        auto old = base.find(entry.first);
+        if (old == base.end()) {
+            std::cout << std::left << std::setw(20) << entry.first << " new\n";
+            continue;
+        }
+        const double change	= entry.second.median/old->second.median - 1;
+        const double noise	= 3*std::max(entry.second.mad, old->second.mad);
+        const bool regression = change > threshold &&
+                                entry.second.median - old->second.median > noise;
+        regressions += regression;
+        std::cout << std::left << std::setw(20) << entry.first << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(10) << old->second.median << " -> "
+                  << std::setw(10) << entry.second.median << " ns/step "
+                  << std::showpos << std::setprecision(1) << std::setw(7) << 100*change
+                  << std::noshowpos << "%" << (regression ? "  REGRESSION" : "") << "\n";
+    }
+    std::cout << regressions << " regression(s) beyond " << 100*threshold << "%\n";
+    return regressions ? 1 : 0;
+}
+
+/******************************************************************************/
+/*										Main								  */
+/******************************************************************************/
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "compare") {
+        if (argc < 4) {
+            std::cerr << "usage: " << argv[0] << " compare baseline.csv results.csv [threshold]\n";
+            return 2;
+        }
+        return compare(argv[2], argv[3], argc > 4 ? std::atof(argv[4]) : 0.05);
+    }
+    const std::string path	= argc > 1 ? argv[1] : "benchmark.csv";
+    const unsigned repeats	= argc > 2 ? std::atoi(argv[2]) : 15;
+
+    /* Parameter sets of Figures/Data_Time_Series.m with noise */
+    std::cout << "math backend " << MATH_BACKEND_NAME << ", " << Steps << " steps, "
+              << repeats << " repeats\n";
+    std::vector<Result> results = run_cases("N2", {4.6, 1.33, 2.0}, repeats);
+    std::vector<Result> N3		= run_cases("N3", {6.5, 2.0,  2.0}, repeats);
+    results.insert(results.end(), N3.begin(), N3.end());
+    for (auto& set : std::vector<std::pair<std::string, std::vector<double>>>{
+             {"N2", {4.6, 1.33, 0}}, {"N3", {6.5, 2.0, 0}}}) {
+        std::vector<Result> adaptive = run_adaptive(set.first, set.second, repeats);
+        results.insert(results.end(), adaptive.begin(), adaptive.end());
+    }
+
+    write_results(path, results, repeats);
+    std::cout << "results written to " << path << "\n";
+    return 0;
+}
@@ -0,0 +1,34 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+TARGET = benchmark
+
+SOURCES +=  Benchmark.cpp       \
+			Cortex_Model.cpp    \
+			Cortical_Column.cpp \
+			Dormand_Prince.cpp
+
+HEADERS +=  Cortex_Model.h      \
+			Cortical_Column.h   \
+			Cortical_Column_Batch.h \
+			Data_Storage.h      \
+			Dormand_Prince.h    \
+			Event_Detection.h   \
+			Instrumentation.h   \
+			Math_Backend.h      \
+			Random_Stream.h     \
+			Simulation_Settings.h \
+			SPSC_Queue.h        \
+			SRK4.h              \
+			Stimulation.h       \
+			Trace_Writer.h
+
+QMAKE_CXXFLAGS += -std=c++11
+QMAKE_CXXFLAGS_RELEASE -= -O1
+QMAKE_CXXFLAGS_RELEASE -= -O2
+QMAKE_CXXFLAGS_RELEASE *= -O3
+
+# Backend under test, see Math_Backend.h
+DEFINES += MATH_BACKEND=0
@@ -0,0 +1,127 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*						Functions of the simulation session					  */
+/******************************************************************************/
+#include <algorithm>
+
+#include "Column_Session.h"
+#include "Data_Storage.h"
+#include "Warm_Start.h"
+
+Column_Session::Column_Session(const std::vector<double>& Param_Cortex,
+                               const std::vector<double>& var_stim,
+                               uint64_t seed, uint32_t id,
+                               const Simulation_Settings& Settings)
+    : Settings (Settings)
+    , Param (Param_Cortex)
+    , seed (seed)
+    , id (id)
+    , Cortex (Param.data(), Settings, seed, id)
+{
+    set_stimulation(var_stim);
+}
+
+std::vector<double> Column_Session::advance(double T, const std::vector<double*>& data) {
+    const int onset	= Settings.onset*Settings.res;
+    const int red	= Settings.red;
+
+    /* The onset is part of the first call */
+    if (!started) {
+        t		= warm_start(Cortex, Settings, seed, id);
+        started	= true;
+        restart();
+    }
+
+    std::vector<double*> dataPointer = data;
+    const int end = std::max(t, onset) + samples(T)*red;
+    int count = 0;
+    Stimulation->run(t, end, [&](int step) {
+        if (adaptive) {
+            Solver->step();
+        } else {
+            Cortex.iterate_ODE();
+        }
+        if (step >= onset && step%red == 0) {
+            get_data(count, Cortex, dataPointer);
+            ++count;
+        }
+    });
+    t = end;
+
+    /* Marker in samples as returned by Cortex_mex */
+    std::vector<double> marker;
+    const std::vector<int>& markers = Stimulation->markers();
+    for (; reported < markers.size(); ++reported) {
+        marker.push_back(markers[reported]/red);
+    }
+    return marker;
+}
+
+void Column_Session::set_parameters(const std::vector<double>& Param_Cortex) {
+    Param = Param_Cortex;
+    Cortex.set_parameters(Param.data());
+    restart();
+}
+
+void Column_Session::set_stimulation(const std::vector<double>& var_stim) {
+    /* A running stimulus of the old protocol is switched off */
+    Var_stim = var_stim;
+    Var_stim.resize(std::max<size_t>(Var_stim.size(), 8), 0.0);
+    Cortex.set_input(0.0);
+    Stimulation.reset(new Stim(Cortex, Var_stim.data(), Settings, seed + id));
+    reported = 0;
+    if (started) {
+        Stimulation->trigger(t);
+    }
+}
+
+Column_Session::State Column_Session::get_state(void) const {
+    return State{Cortex.get_state(), Param, Var_stim, Stimulation->get_state(), t, reported, started};
+}
+
+/* The noise streams of column and stimulation follow the seed of the state.
+ * The parameters are set first, so that the noise of the column has the
+ * standard deviation of the state */
+void Column_Session::set_state(const State& state) {
+    seed		= state.column.seed;
+    id			= state.column.id;
+    Param		= state.Param_Cortex;
+    Cortex.set_parameters(Param.data());
+    Var_stim	= state.var_stim;
+    Var_stim.resize(std::max<size_t>(Var_stim.size(), 8), 0.0);
+    Stimulation.reset(new Stim(Cortex, Var_stim.data(), Settings, seed + id));
+    Stimulation->set_state(state.stimulation);
+    Cortex.set_state(state.column);
+    t			= state.time;
+    reported	= state.reported;
+    started		= state.started;
+    restart();
+}
+
+void Column_Session::restart(void) {
+    adaptive = Dormand_Prince::applicable(Cortex, Settings);
+    Solver.reset(new Dormand_Prince(Cortex, Settings));
+}
@@ -0,0 +1,105 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*					Simulation that is continued in chunks					  */
+/*																			  */
+/*	A session keeps the column, its noise streams, the stimulation protocol	  */
+/*	and the adaptive integrator between calls of advance. The first call	  */
+/*	also simulates the onset (or takes it from the warm start cache), so a	  */
+/*	session advanced by T1, T2, ... seconds returns the same samples and	  */
+/*	markers as one call of Cortex_mex with T1 + T2 + ... and the same seed.	  */
+/*																			  */
+/*	set_parameters takes effect with the next step. set_stimulation starts	  */
+/*	the new protocol at the current time as Stim::trigger does for forked	  */
+/*	trials. Used by the session commands of Cortex_mex.						  */
+/******************************************************************************/
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Cortical_Column.h"
+#include "Dormand_Prince.h"
+#include "Simulation_Settings.h"
+#include "Stimulation.h"
+
+class Column_Session {
+public:
+    /* Noise streams as in Cortex_mex: the column uses (seed, id), the
+     * stimulation seed + id */
+    Column_Session(const std::vector<double>& Param_Cortex, const std::vector<double>& var_stim,
+                   uint64_t seed, uint32_t id = 0,
+                   const Simulation_Settings& Settings = Simulation_Settings());
+
+    Column_Session(const Column_Session&) = delete;
+    Column_Session& operator=(const Column_Session&) = delete;
+
+    /* Samples of the next T seconds */
+    int		samples		(double T) const {return (int) (T*Settings.res)/Settings.red;}
+
+    /* Simulates T seconds and writes samples(T) samples of the six channels of
+     * Cortex_mex to data. Returns the markers of this call in samples since
+     * the end of the onset */
+    std::vector<double>	advance	(double T, const std::vector<double*>& data);
+
+    void	set_parameters	(const std::vector<double>& Param_Cortex);
+    void	set_stimulation	(const std::vector<double>& var_stim);
+
+    /* State of the column and the stimulation, restoring it continues at the
+     * same time step with the same parameters, protocol and markers */
+    struct State {
+        Cortical_Column::State	column;
+        std::vector<double>		Param_Cortex;
+        std::vector<double>		var_stim;
+        Stim::State				stimulation;
+        int						time;		/* Time steps including the onset	*/
+        unsigned				reported;	/* Markers returned by advance		*/
+        bool					started;	/* Whether the onset is done		*/
+    };
+    State	get_state		(void) const;
+    void	set_state		(const State& state);
+
+    /* Time steps simulated so far, including the onset */
+    int		time			(void) const {return t;}
+private:
+    /* The adaptive integrator starts from the current state of the column */
+    void	restart			(void);
+
+    Simulation_Settings				Settings;
+    std::vector<double>				Param;
+    uint64_t						seed;
+    uint32_t						id;
+
+    Cortical_Column					Cortex;
+    std::vector<double>				Var_stim;
+    std::unique_ptr<Stim>			Stimulation;
+    std::unique_ptr<Dormand_Prince>	Solver;
+    bool							adaptive;
+
+    /* Next time step and markers of the protocol that were returned */
+    int								t			= 0;
+    unsigned						reported	= 0;
+    bool							started		= false;
+};
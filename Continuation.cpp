@@ -0,0 +1,828 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ *
+ *	Based on:	Characterization of K-Complexes and Slow Wave Activity in a Neural Mass Model
+ *				A Weigenand, M Schellenberger Costa, H-VV Ngo, JC Claussen, T Martinetz
+ *				PLoS Computational Biology. 2014;10:e1003923
+ */
+
+/******************************************************************************/
+/*						Functions of the continuation						  */
+/******************************************************************************/
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <limits>
+#include <thread>
+
+#include "Continuation.h"
+
+constexpr unsigned Continuation::N;
+
+typedef std::vector<double> Vector;
+
+/******************************************************************************/
+/*								Linear algebra								  */
+/*	Dense matrices are stored row major. The systems have at most 13		  */
+/*	unknowns, so Gaussian elimination with partial pivoting is sufficient.	  */
+/******************************************************************************/
+/* Solves A x = b in place of b, returns false if A is singular */
+static bool solve(Vector A, Vector& b, unsigned n) {
+    for (unsigned k=0; k < n; ++k) {
+        unsigned pivot = k;
+        for (unsigned i=k+1; i < n; ++i) {
+            if (std::abs(A[i*n+k]) > std::abs(A[pivot*n+k])) {
+                pivot = i;
+            }
+        }
+        if (A[pivot*n+k] == 0) {
+            return false;
+        }
+        if (pivot != k) {
+            std::swap_ranges(&A[k*n], &A[k*n] + n, &A[pivot*n]);
+            std::swap(b[k], b[pivot]);
+        }
+        for (unsigned i=k+1; i < n; ++i) {
+            const double factor = A[i*n+k] / A[k*n+k];
+            for (unsigned j=k; j < n; ++j) {
+                A[i*n+j] -= factor * A[k*n+j];
+            }
+            b[i] -= factor * b[k];
+        }
+    }
+    for (unsigned k=n; k-- > 0;) {
+        for (unsigned j=k+1; j < n; ++j) {
+            b[k] -= A[k*n+j] * b[j];
+        }
+        b[k] /= A[k*n+k];
+    }
+    for (double value : b) {
+        if (!std::isfinite(value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Eigenvalues of a general real matrix: balancing, reduction to Hessenberg
+ * form by elimination and the shifted QR algorithm (Numerical Recipes, 3rd
+ * edition, chapter 11.6/11.7) */
+static void eigenvalues(Vector a, unsigned n, double* re, double* im) {
+    const double radix	= std::numeric_limits<double>::radix;
+    const double eps	= std::numeric_limits<double>::epsilon();
+
+    /* Balancing */
+    bool done = false;
+    while (!done) {
+        done = true;
+        for (unsigned i=0; i < n; ++i) {
+            double r = 0, c = 0;
+            for (unsigned j=0; j < n; ++j) {
+                if (j != i) {
+                    c += std::abs(a[j*n+i]);
+                    r += std::abs(a[i*n+j]);
+                }
+            }
+            if (c != 0 && r != 0) {
+                double g = r/radix, f = 1;
+                const double s = c + r;
+                while (c < g) {
+                    f *= radix;
+                    c *= radix*radix;
+                }
+                g = r*radix;
+                while (c > g) {
+                    f /= radix;
+                    c /= radix*radix;
+                }
+                if ((c + r)/f < 0.95*s) {
+                    done = false;
+                    for (unsigned j=0; j < n; ++j) {
+                        a[i*n+j] /= f;
+                        a[j*n+i] *= f;
+                    }
+                }
+            }
+        }
+    }
+
+    /* Hessenberg form */
+    for (unsigned m=1; m+1 < n; ++m) {
+        double x = 0;
+        unsigned i = m;
+        for (unsigned j=m; j < n; ++j) {
+            if (std::abs(a[j*n+m-1]) > std::abs(x)) {
+                x = a[j*n+m-1];
+                i = j;
+            }
+        }
+        if (i != m) {
+            for (unsigned j=m-1; j < n; ++j) {
+                std::swap(a[i*n+j], a[m*n+j]);
+            }
+            for (unsigned j=0; j < n; ++j) {
+                std::swap(a[j*n+i], a[j*n+m]);
+            }
+        }
+        if (x != 0) {
+            for (i=m+1; i < n; ++i) {
+                double y = a[i*n+m-1];
+                if (y != 0) {
+                    y /= x;
+                    a[i*n+m-1] = y;
+                    for (unsigned j=m; j < n; ++j) {
+                        a[i*n+j] -= y*a[m*n+j];
+                    }
+                    for (unsigned j=0; j < n; ++j) {
+                        a[j*n+m] += y*a[j*n+i];
+                    }
+                }
+            }
+        }
+    }
+    for (unsigned i=2; i < n; ++i) {
+        for (unsigned j=0; j+1 < i; ++j) {
+            a[i*n+j] = 0;
+        }
+    }
+
+    /* QR iteration */
+    double anorm = 0;
+    for (unsigned i=0; i < n; ++i) {
+        for (unsigned j=(i > 0 ? i-1 : 0); j < n; ++j) {
+            anorm += std::abs(a[i*n+j]);
+        }
+    }
+    auto A = [&a, n](int i, int j) -> double& {return a[i*n+j];};
+    int nn = n-1;
+    double t = 0;
+    while (nn >= 0) {
+        int its = 0, l;
+        do {
+            for (l=nn; l > 0; --l) {
+                double s = std::abs(A(l-1,l-1)) + std::abs(A(l,l));
+                if (s == 0) {
+                    s = anorm;
+                }
+                if (std::abs(A(l,l-1)) <= eps*s) {
+                    A(l,l-1) = 0;
+                    break;
+                }
+            }
+            double x = A(nn,nn);
+            if (l == nn) {
+                re[nn] = x + t;
+                im[nn--] = 0;
+            } else {
+                double y = A(nn-1,nn-1);
+                double w = A(nn,nn-1)*A(nn-1,nn);
+                if (l == nn-1) {
+                    const double p = 0.5*(y-x);
+                    const double q = p*p + w;
+                    double z = std::sqrt(std::abs(q));
+                    x += t;
+                    if (q >= 0) {
+                        z = p + (p >= 0 ? z : -z);
+                        re[nn-1] = re[nn] = x + z;
+                        if (z != 0) {
+                            re[nn] = x - w/z;
+                        }
+                        im[nn-1] = im[nn] = 0;
+                    } else {
+                        re[nn-1] = re[nn] = x + p;
+                        im[nn-1] = z;
+                        im[nn] = -z;
+                    }
+                    nn -= 2;
+                } else {
+                    if (its == 60) {
+                        /* No convergence, the remaining values are unknown */
+                        for (int i=0; i <= nn; ++i) {
+                            re[i] = im[i] = std::numeric_limits<double>::quiet_NaN();
+                        }
+                        return;
+                    }
+                    if (its == 10 || its == 20) {
+                        t += x;
+                        for (int i=0; i <= nn; ++i) {
+                            A(i,i) -= x;
+                        }
+                        const double s = std::abs(A(nn,nn-1)) + std::abs(A(nn-1,nn-2));
+                        y = x = 0.75*s;
+                        w = -0.4375*s*s;
+                    }
+                    ++its;
+                    int m;
+                    double p = 0, q = 0, r = 0, z;
+                    for (m=nn-2; m >= l; --m) {
+                        z = A(m,m);
+                        r = x - z;
+                        double s = y - z;
+                        p = (r*s - w)/A(m+1,m) + A(m,m+1);
+                        q = A(m+1,m+1) - z - r - s;
+                        r = A(m+2,m+1);
+                        s = std::abs(p) + std::abs(q) + std::abs(r);
+                        p /= s;
+                        q /= s;
+                        r /= s;
+                        if (m == l) {
+                            break;
+                        }
+                        const double u = std::abs(A(m,m-1))*(std::abs(q) + std::abs(r));
+                        const double v = std::abs(p)*(std::abs(A(m-1,m-1)) + std::abs(z) + std::abs(A(m+1,m+1)));
+                        if (u <= eps*v) {
+                            break;
+                        }
+                    }
+                    for (int i=m; i < nn-1; ++i) {
+                        A(i+2,i) = 0;
+                        if (i != m) {
+                            A(i+2,i-1) = 0;
+                        }
+                    }
+                    for (int k=m; k < nn; ++k) {
+                        if (k != m) {
+                            p = A(k,k-1);
+                            q = A(k+1,k-1);
+                            r = 0;
+                            if (k+1 != nn) {
+                                r = A(k+2,k-1);
+                            }
+                            x = std::abs(p) + std::abs(q) + std::abs(r);
+                            if (x != 0) {
+                                p /= x;
+                                q /= x;
+                                r /= x;
+                            }
+                        }
+                        double s = std::sqrt(p*p + q*q + r*r);
+                        s = p >= 0 ? s : -s;
+                        if (s != 0) {
+                            if (k == m) {
+                                if (l != m) {
+                                    A(k,k-1) = -A(k,k-1);
+                                }
+                            } else {
+                                A(k,k-1) = -s*x;
+                            }
+                            p += s;
+                            x = p/s;
+                            y = q/s;
+                            z = r/s;
+                            q /= p;
+                            r /= p;
+                            for (int j=k; j <= nn; ++j) {
+                                p = A(k,j) + q*A(k+1,j);
+                                if (k+1 != nn) {
+                                    p += r*A(k+2,j);
+                                    A(k+2,j) -= p*z;
+                                }
+                                A(k+1,j) -= p*y;
+                                A(k,j) -= p*x;
+                            }
+                            const int mmin = nn < k+3 ? nn : k+3;
+                            for (int i=l; i <= mmin; ++i) {
+                                p = x*A(i,k) + y*A(i,k+1);
+                                if (k+1 != nn) {
+                                    p += z*A(i,k+2);
+                                    A(i,k+2) -= p*r;
+                                }
+                                A(i,k+1) -= p*q;
+                                A(i,k) -= p;
+                            }
+                        }
+                    }
+                }
+            }
+        } while (l+1 < nn);
+    }
+}
+
+static double norm_inf(const Vector& v) {
+    double norm = 0;
+    for (double value : v) {
+        norm = std::max(norm, std::abs(value));
+    }
+    return norm;
+}
+
+/******************************************************************************/
+/*								Equilibria									  */
+/******************************************************************************/
+Continuation::State Continuation::guess(const Parameters& par, double Vp, double Vi) const {
+    typedef Cortex_Model CC;
+    const double Qp = CC::Qp_max / (1 + std::exp(-CC::C1 * (Vp - CC::theta_p) / par[SIGMA_P]));
+    const double Qi = CC::Qi_max / (1 + std::exp(-CC::C1 * (Vi - CC::theta_i) / CC::sigma_i));
+
+    /* Na balances the influx by the pump, found by bisection */
+    auto pump = [](double Na) {
+        return CC::R_pump*(Na*Na*Na/(Na*Na*Na+3375) - CC::Na_eq*CC::Na_eq*CC::Na_eq/(CC::Na_eq*CC::Na_eq*CC::Na_eq+3375));
+    };
+    double lower = 1E-3, upper = 1E3;
+    for (unsigned i=0; i < 100; ++i) {
+        const double Na = 0.5*(lower + upper);
+        (pump(Na) < CC::alpha_Na * Qp ? lower : upper) = Na;
+    }
+
+    const double drive = par[INPUT]/dt;
+    return State{{Vp, Vi, 0.5*(lower + upper),
+                  CC::N_pp * Qp + drive, CC::N_ip * Qp + drive, CC::N_pi * Qi, CC::N_ii * Qi,
+                  0, 0, 0, 0}};
+}
+
+bool Continuation::equilibrium(const Parameters& par, State& y) const {
+    Vector F(N), J(N*N), J_par(3*N);
+    auto residual_norm = [&](const State& x) {
+        Cortex_Model::vector_field(x.data(), F.data(), par[SIGMA_P], par[G_KNA], par[INPUT], dt);
+        return std::isfinite(norm_inf(F)) ? norm_inf(F) : std::numeric_limits<double>::infinity();
+    };
+
+    double norm = residual_norm(y);
+    for (unsigned it=0; it < 100; ++it) {
+        Cortex_Model::jacobian(y.data(), J.data(), J_par.data(), par[SIGMA_P], par[G_KNA], dt);
+        Vector dy(F);
+        if (!solve(J, dy, N)) {
+            return false;
+        }
+
+        /* Damped step, the residual has to decrease */
+        double lambda = 1;
+        State next;
+        double norm_next;
+        do {
+            for (unsigned i=0; i < N; ++i) {
+                next[i] = y[i] - lambda*dy[i];
+            }
+            norm_next = next[2] > 0 ? residual_norm(next) : std::numeric_limits<double>::infinity();
+            lambda /= 2;
+        } while (norm_next >= norm && lambda > 1E-6);
+
+        double step = 0, size = 0;
+        for (unsigned i=0; i < N; ++i) {
+            step = std::max(step, std::abs(next[i] - y[i]));
+            size = std::max(size, std::abs(next[i]));
+        }
+        y		= next;
+        norm	= residual_norm(y);
+        if (step <= tolerance*(1 + size)) {
+            return std::isfinite(norm);
+        }
+    }
+    return false;
+}
+
+void Continuation::eigenvalues(const Parameters& par, const State& y,
+                               std::array<double, N>& re, std::array<double, N>& im) const {
+    Vector J(N*N), J_par(3*N);
+    Cortex_Model::jacobian(y.data(), J.data(), J_par.data(), par[SIGMA_P], par[G_KNA], dt);
+    ::eigenvalues(J, N, re.data(), im.data());
+}
+
+Continuation::Point Continuation::classify(const Parameters& par, const State& y) const {
+    std::array<double, N> re, im;
+    eigenvalues(par, y, re, im);
+    bool stable = true;
+    for (double value : re) {
+        stable = stable && value < 0;
+    }
+    return Point{y, par, stable, REGULAR};
+}
+
+/* Both test functions are evaluated from the eigenvalues. The Jacobian has
+ * entries of order one and eigenvalues down to 1E-3, so the determinants
+ * computed by elimination would be dominated by rounding errors */
+double Continuation::test_function(Label label, const Parameters& par, const State& y) const {
+    std::array<double, N> re, im;
+    eigenvalues(par, y, re, im);
+    std::complex<double> product = 1;
+    if (label == FOLD) {
+        for (unsigned i=0; i < N; ++i) {
+            product *= std::complex<double>(re[i], im[i]);
+        }
+    } else {
+        for (unsigned i=1; i < N; ++i) {
+            for (unsigned j=0; j < i; ++j) {
+                product *= std::complex<double>(re[i] + re[j], im[i] + im[j]);
+            }
+        }
+    }
+    return product.real();
+}
+
+/******************************************************************************/
+/*							Extended system									  */
+/******************************************************************************/
+Continuation::Parameters Continuation::parameters(const System& S, const Vector& u) const {
+    Parameters par = S.par;
+    par[S.p] = u[N];
+    if (S.label != REGULAR) {
+        par[S.q] = u[N+1];
+    }
+    return par;
+}
+
+void Continuation::residual(const System& S, const Vector& u, Vector& F) const {
+    const Parameters par = parameters(S, u);
+    F.resize(S.equations());
+    Cortex_Model::vector_field(u.data(), F.data(), par[SIGMA_P], par[G_KNA], par[INPUT], dt);
+    if (S.label != REGULAR) {
+        State y;
+        std::copy(u.begin(), u.begin() + N, y.begin());
+        F[N] = test_function(S.label, par, y) / S.scale;
+    }
+}
+
+void Continuation::residual_jacobian(const System& S, const Vector& u, Vector& A) const {
+    const Parameters par = parameters(S, u);
+    const unsigned size = S.size();
+    Vector J(N*N), J_par(3*N);
+    Cortex_Model::jacobian(u.data(), J.data(), J_par.data(), par[SIGMA_P], par[G_KNA], dt);
+
+    A.assign(S.equations()*size, 0.0);
+    for (unsigned i=0; i < N; ++i) {
+        std::copy(&J[i*N], &J[i*N] + N, &A[i*size]);
+        A[i*size+N] = J_par[i*3+S.p];
+        if (S.label != REGULAR) {
+            A[i*size+N+1] = J_par[i*3+S.q];
+        }
+    }
+
+    /* Gradient of the test function by central differences */
+    if (S.label != REGULAR) {
+        for (unsigned j=0; j < size; ++j) {
+            const double h = 1E-6*(1 + std::abs(u[j]));
+            Vector up(u), down(u);
+            up[j]	+= h;
+            down[j]	-= h;
+            State y_up, y_down;
+            std::copy(up.begin(), up.begin() + N, y_up.begin());
+            std::copy(down.begin(), down.begin() + N, y_down.begin());
+            A[N*size+j] = (test_function(S.label, parameters(S, up), y_up) -
+                           test_function(S.label, parameters(S, down), y_down)) / (2*h*S.scale);
+        }
+    }
+}
+
+/******************************************************************************/
+/*							Pseudo-arclength continuation					  */
+/******************************************************************************/
+bool Continuation::tangent(const System& S, const Vector& u, const Vector& previous, Vector& t) const {
+    const unsigned size = S.size();
+    Vector A;
+    residual_jacobian(S, u, A);
+
+    /* The null vector of A is bordered with the previous tangent, or with a
+     * coordinate direction if that is (nearly) orthogonal */
+    std::vector<Vector> borders(1, previous);
+    for (unsigned k=size; k-- > 0;) {
+        Vector e(size, 0.0);
+        e[k] = 1;
+        borders.push_back(e);
+    }
+    for (auto& border : borders) {
+        Vector B(A);
+        B.insert(B.end(), border.begin(), border.end());
+        t.assign(size, 0.0);
+        t[size-1] = 1;
+        if (solve(B, t, size)) {
+            double norm = 0, direction = 0;
+            for (unsigned i=0; i < size; ++i) {
+                norm		+= t[i]*t[i];
+                direction	+= t[i]*previous[i];
+            }
+            norm = std::sqrt(norm);
+            if (direction < 0) {
+                norm = -norm;
+            }
+            for (auto& value : t) {
+                value /= norm;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Continuation::correct(const System& S, Vector& u, const Vector& t, unsigned& iterations) const {
+    const unsigned size = S.size();
+    const Vector predicted(u);
+    Vector F, A;
+    for (iterations=1; iterations <= 10; ++iterations) {
+        residual(S, u, F);
+        residual_jacobian(S, u, A);
+        double arclength = 0;
+        for (unsigned i=0; i < size; ++i) {
+            arclength += t[i]*(u[i] - predicted[i]);
+        }
+        F.push_back(arclength);
+        A.insert(A.end(), t.begin(), t.end());
+        if (!solve(A, F, size)) {
+            return false;
+        }
+        for (unsigned i=0; i < size; ++i) {
+            u[i] -= F[i];
+        }
+        if (u[2] <= 0 || !std::isfinite(norm_inf(u))) {
+            return false;
+        }
+        if (norm_inf(F) <= tolerance*(1 + norm_inf(u))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<Vector> Continuation::follow(const System& S, Vector u, Vector t,
+                                         const std::array<double, 4>& range) const {
+    std::vector<Vector> points;
+    double ds = ds_initial;
+    while (points.size() < max_points) {
+        Vector next(u);
+        for (unsigned i=0; i < u.size(); ++i) {
+            next[i] += ds*t[i];
+        }
+        unsigned iterations;
+        Vector t_next;
+        bool accepted = correct(S, next, t, iterations) && tangent(S, next, t, t_next);
+
+        /* Sharp turns are resolved with smaller steps, so that the
+         * continuation does not jump between branches */
+        if (accepted) {
+            double cosine = 0;
+            for (unsigned i=0; i < t.size(); ++i) {
+                cosine += t[i]*t_next[i];
+            }
+            accepted = cosine > 0.9 || ds <= 2*ds_min;
+        }
+        if (!accepted) {
+            ds /= 2;
+            if (ds < ds_min) {
+                break;
+            }
+            continue;
+        }
+
+        points.push_back(next);
+        u = next;
+        t = t_next;
+
+        /* Stop outside of the range or when a closed curve is complete */
+        if (u[N] < range[0] || u[N] > range[1]) {
+            break;
+        }
+        if (S.label != REGULAR && (u[N+1] < range[2] || u[N+1] > range[3])) {
+            break;
+        }
+        if (points.size() > 10) {
+            Vector distance(u);
+            for (unsigned i=0; i < u.size(); ++i) {
+                distance[i] -= points[0][i];
+            }
+            if (norm_inf(distance) < ds) {
+                break;
+            }
+        }
+        if (iterations <= 3) {
+            ds = std::min(1.3*ds, ds_max);
+        } else if (iterations >= 6) {
+            ds /= 1.5;
+        }
+    }
+    return points;
+}
+
+Continuation::Point Continuation::make_point(const System& S, const Vector& u) const {
+    State y;
+    std::copy(u.begin(), u.begin() + N, y.begin());
+    Point point = classify(parameters(S, u), y);
+    point.label = S.label;
+    return point;
+}
+
+/******************************************************************************/
+/*								Branches									  */
+/******************************************************************************/
+std::vector<Continuation::Point> Continuation::branch(const Point& start, Parameter p,
+                                                      double p_min, double p_max) const {
+    const System S{start.par, p, p, REGULAR, 1};
+    Vector u(start.y.begin(), start.y.end());
+    u.push_back(start.par[p]);
+
+    Vector e(N+1, 0.0), t;
+    e[N] = 1;
+    std::vector<Point> points;
+    if (!tangent(S, u, e, t)) {
+        return points;
+    }
+
+    /* Both directions from the start */
+    std::vector<Vector> forward		= follow(S, u, t, {{p_min, p_max, 0, 0}});
+    for (auto& value : t) {
+        value = -value;
+    }
+    std::vector<Vector> backward	= follow(S, u, t, {{p_min, p_max, 0, 0}});
+    std::vector<Vector> path(backward.rbegin(), backward.rend());
+    path.push_back(u);
+    path.insert(path.end(), forward.begin(), forward.end());
+
+    /* Test functions along the branch, special points are located between
+     * sign changes by bisection along the arclength */
+    auto test = [this, &S](const Vector& v, Label label) {
+        State y;
+        std::copy(v.begin(), v.begin() + N, y.begin());
+        return test_function(label, parameters(S, v), y);
+    };
+    for (unsigned k=0; k < path.size(); ++k) {
+        points.push_back(make_point(S, path[k]));
+        if (k+1 == path.size()) {
+            break;
+        }
+        for (Label label : {FOLD, HOPF}) {
+            if (test(path[k], label) * test(path[k+1], label) >= 0) {
+                continue;
+            }
+            Vector chord(path[k+1]), t_k;
+            for (unsigned i=0; i < chord.size(); ++i) {
+                chord[i] -= path[k][i];
+            }
+            if (!tangent(S, path[k], chord, t_k)) {
+                continue;
+            }
+            double lower = 0, upper = 0;
+            for (unsigned i=0; i < chord.size(); ++i) {
+                upper += t_k[i]*chord[i];
+            }
+            const double sign = test(path[k], label);
+            Vector located = path[k];
+            bool found = false;
+            for (unsigned it=0; it < 60 && upper - lower > 1E-12; ++it) {
+                const double s = 0.5*(lower + upper);
+                Vector v(path[k]);
+                for (unsigned i=0; i < v.size(); ++i) {
+                    v[i] += s*t_k[i];
+                }
+                unsigned iterations;
+                if (!correct(S, v, t_k, iterations)) {
+                    break;
+                }
+                located	= v;
+                found	= true;
+                (test(v, label) * sign > 0 ? lower : upper) = s;
+            }
+            if (!found) {
+                continue;
+            }
+
+            /* Hopf points need a pair of imaginary eigenvalues, otherwise it
+             * is a neutral saddle */
+            Point point = make_point(S, located);
+            point.label = label;
+            if (label == HOPF) {
+                std::array<double, N> re, im;
+                eigenvalues(point.par, point.y, re, im);
+                bool pair = false;
+                for (unsigned i=0; i < N; ++i) {
+                    pair = pair || (im[i] > 0 && std::abs(re[i]) < 1E-4*im[i]);
+                }
+                if (!pair) {
+                    continue;
+                }
+            }
+            points.push_back(point);
+        }
+    }
+    return points;
+}
+
+std::vector<Continuation::Point> Continuation::curve(const Point& start, Parameter p, Parameter q,
+                                                     double p_min, double p_max,
+                                                     double q_min, double q_max) const {
+    System S{start.par, p, q, start.label, 1};
+    Vector u(start.y.begin(), start.y.end());
+    u.push_back(start.par[p]);
+    u.push_back(start.par[q]);
+    std::vector<Point> points;
+    if (start.label == REGULAR) {
+        return points;
+    }
+
+    /* The test function is scaled to a gradient of unit length */
+    Vector A;
+    residual_jacobian(S, u, A);
+    double gradient = 0;
+    for (unsigned j=0; j < S.size(); ++j) {
+        gradient += A[N*S.size()+j]*A[N*S.size()+j];
+    }
+    S.scale = std::sqrt(gradient);
+    if (!(S.scale > 0)) {
+        return points;
+    }
+
+    Vector e(N+2, 0.0), t;
+    e[N+1] = 1;
+    if (!tangent(S, u, e, t)) {
+        return points;
+    }
+    const std::array<double, 4> range = {{p_min, p_max, q_min, q_max}};
+    std::vector<Vector> forward		= follow(S, u, t, range);
+    for (auto& value : t) {
+        value = -value;
+    }
+    std::vector<Vector> backward	= follow(S, u, t, range);
+    for (auto it=backward.rbegin(); it != backward.rend(); ++it) {
+        points.push_back(make_point(S, *it));
+    }
+    points.push_back(make_point(S, u));
+    for (auto& v : forward) {
+        points.push_back(make_point(S, v));
+    }
+    return points;
+}
+
+/******************************************************************************/
+/*								Parallel branches							  */
+/******************************************************************************/
+std::vector<std::vector<Continuation::Point>> compute_branches(const Continuation& C,
+                                                               const std::vector<Continuation::Point>& starts,
+                                                               Continuation::Parameter p,
+                                                               double p_min, double p_max,
+                                                               unsigned threads) {
+    std::vector<std::vector<Continuation::Point>> branches(starts.size());
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::max(1u, std::min<unsigned>(threads, starts.size()));
+
+    /* Branches differ a lot in length, so they are taken one at a time */
+    std::atomic<unsigned> next(0);
+    auto work = [&]() {
+        for (unsigned i = next++; i < starts.size(); i = next++) {
+            branches[i] = C.branch(starts[i], p, p_min, p_max);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned i=1; i < threads; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return branches;
+}
+
+/******************************************************************************/
+/*								Data output									  */
+/******************************************************************************/
+bool write_diagram(const std::string& path,
+                   const std::vector<std::vector<Continuation::Point>>& branches,
+                   Continuation::Parameter p) {
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    for (unsigned b=0; b < branches.size(); ++b) {
+        for (auto& point : branches[b]) {
+            std::fprintf(file, "%g %g %g %d %u \n", point.par[p], point.y[0], point.y[0],
+                         point.stable ? 1 : 2, b+1);
+        }
+    }
+    return std::fclose(file) == 0;
+}
+
+bool write_diagram(const std::string& path,
+                   const std::vector<std::vector<Continuation::Point>>& curves,
+                   Continuation::Parameter p, Continuation::Parameter q) {
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    for (unsigned c=0; c < curves.size(); ++c) {
+        for (auto& point : curves[c]) {
+            std::fprintf(file, "%g %g %g %d %u \n", point.par[p], point.par[q], point.par[q], 2, c+1);
+        }
+    }
+    return std::fclose(file) == 0;
+}
@@ -0,0 +1,166 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ *
+ *	Based on:	Characterization of K-Complexes and Slow Wave Activity in a Neural Mass Model
+ *				A Weigenand, M Schellenberger Costa, H-VV Ngo, JC Claussen, T Martinetz
+ *				PLoS Computational Biology. 2014;10:e1003923
+ */
+
+/******************************************************************************/
+/*				Continuation of equilibria and their bifurcations			  */
+/*																			  */
+/*	Equilibria of the noise free column are found with Newton's method on	  */
+/*	Cortex_Model::vector_field and its analytic Jacobian. Branches of		  */
+/*	equilibria in one of the parameters sigma_p, g_KNa or input are followed */
+/*	by pseudo-arclength continuation. Along a branch the stability is taken	  */
+/*	from the eigenvalues of the Jacobian and two test functions are			  */
+/*	monitored: the product of the eigenvalues vanishes at folds and the		  */
+/*	product of all sums lambda_i + lambda_j at Hopf points (and at neutral	  */
+/*	saddles, which are discarded). Sign changes are located by bisection	  */
+/*	along the arclength.													  */
+/*																			  */
+/*	Starting from a fold or Hopf point, the curve of such points in two		  */
+/*	parameters is continued with the test function as additional equation.	  */
+/*																			  */
+/*	write_diagram stores branches in the column layout of the diagrams of	  */
+/*	XPPAUT in Figures/Data, so that they can be plotted with plotxppaut.m.	  */
+/******************************************************************************/
+#pragma once
+#include <array>
+#include <string>
+#include <vector>
+
+#include "Cortical_Column.h"
+#include "Simulation_Settings.h"
+
+class Continuation {
+public:
+    enum Parameter {SIGMA_P = 0, G_KNA = 1, INPUT = 2};
+    enum Label {REGULAR = 0, FOLD = 1, HOPF = 2};
+
+    static constexpr unsigned	N = Cortical_Column::numStates;
+    typedef std::array<double, N>	State;
+    typedef std::array<double, 3>	Parameters;		/* sigma_p, g_KNa, input	*/
+
+    struct Point {
+        State			y;
+        Parameters		par;
+        bool			stable;
+        Label			label;
+    };
+
+    /* The settings define dt, which scales the input (see set_input) */
+    explicit Continuation(const Simulation_Settings& Settings = Simulation_Settings())
+    : dt (Settings.dt) {}
+
+    /* Initial guess with the given voltages, all other variables are set to
+     * their values at an equilibrium with these voltages */
+    State	guess		(const Parameters& par, double Vp, double Vi) const;
+
+    /* Refines y to an equilibrium, returns false if Newton does not converge */
+    bool	equilibrium	(const Parameters& par, State& y) const;
+
+    /* Stability and test functions of the equilibrium y */
+    Point	classify	(const Parameters& par, const State& y) const;
+
+    /* Branch of equilibria in parameter p through start in both directions,
+     * until p leaves [p_min, p_max]. Folds and Hopf points are labeled */
+    std::vector<Point>	branch	(const Point& start, Parameter p,
+                                 double p_min, double p_max) const;
+
+    /* Curve of the fold or Hopf point start in the parameters p and q, until
+     * one of them leaves its range */
+    std::vector<Point>	curve	(const Point& start, Parameter p, Parameter q,
+                                 double p_min, double p_max,
+                                 double q_min, double q_max) const;
+
+    /* Eigenvalues of the Jacobian at y as real and imaginary parts */
+    void	eigenvalues	(const Parameters& par, const State& y,
+                         std::array<double, N>& re, std::array<double, N>& im) const;
+
+    /* Step size control along the arclength and accuracy of Newton's method */
+    double		ds_initial	= 1E-2;
+    double		ds_min		= 1E-7;
+    double		ds_max		= 5E-2;
+    double		tolerance	= 1E-9;
+    unsigned	max_points	= 10000;
+private:
+    /* Unknowns of the continuation: the state followed by one or two
+     * parameters */
+    typedef std::vector<double> Vector;
+
+    /* Extended system, for a curve the test function of label is added */
+    struct System {
+        Parameters		par;
+        Parameter		p;
+        Parameter		q;
+        Label			label;		/* REGULAR for branches of equilibria	*/
+        double			scale;		/* Of the test function					*/
+        unsigned		size		(void) const {return label == REGULAR ? N+1 : N+2;}
+        unsigned		equations	(void) const {return size()-1;}
+    };
+
+    Parameters	parameters	(const System& S, const Vector& u) const;
+
+    /* Residual and its Jacobian (equations x size, row major) */
+    void	residual		(const System& S, const Vector& u, Vector& F) const;
+    void	residual_jacobian(const System& S, const Vector& u, Vector& A) const;
+
+    /* Test functions for folds and Hopf points */
+    double	test_function	(Label label, const Parameters& par, const State& y) const;
+
+    /* Tangent of the curve at u, oriented along previous */
+    bool	tangent			(const System& S, const Vector& u, const Vector& previous, Vector& t) const;
+
+    /* Newton's method with the arclength condition t.(u - u_pred) = 0 */
+    bool	correct			(const System& S, Vector& u, const Vector& t, unsigned& iterations) const;
+
+    /* Continuation in one direction from u along t */
+    std::vector<Vector>	follow	(const System& S, Vector u, Vector t,
+                                 const std::array<double, 4>& range) const;
+
+    Point	make_point		(const System& S, const Vector& u) const;
+
+    /* Duration of a time step in ms */
+    const double	dt;
+};
+
+/* Branches of equilibria in p for every start point (e.g. slices in another
+ * parameter), computed in parallel. A thread number of 0 uses all cores */
+std::vector<std::vector<Continuation::Point>> compute_branches	(const Continuation& C,
+                                                                 const std::vector<Continuation::Point>& starts,
+                                                                 Continuation::Parameter p,
+                                                                 double p_min, double p_max,
+                                                                 unsigned threads = 0);
+
+/* Writes the branches in the layout of XPPAUT: p, max(Vp), min(Vp), 1 for
+ * stable and 2 for unstable equilibria, branch number (counting from 1) */
+bool write_diagram	(const std::string& path,
+                     const std::vector<std::vector<Continuation::Point>>& branches,
+                     Continuation::Parameter p);
+
+/* Writes curves of bifurcations as XPPAUT does for two parameters: p, q, q,
+ * 2, curve number (counting from 1) */
+bool write_diagram	(const std::string& path,
+                     const std::vector<std::vector<Continuation::Point>>& curves,
+                     Continuation::Parameter p, Continuation::Parameter q);
@@ -29,40 +29,790 @@
 /******************************************************************************/
 /*                  Main file for compilation and runtime tests				  */
 /******************************************************************************/
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <iostream>
+#include <iterator>
 #include <chrono>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include "Column_Session.h"
 #include "Cortical_Column.h"
+#include "Cortical_Column_Batch.h"
+#include "Cortical_Network.h"
+#include "Cortical_Sheet.h"
+#include "Continuation.h"
+#include "Data_Storage.h"
+#include "Dormand_Prince.h"
+#include "Monte_Carlo.h"
+#include "Parameter_Fit.h"
+#include "Parameter_Sweep.h"
+#include "Probe.h"
+#include "Real_Time.h"
+#include "Trial_Fork.h"
+#include "Warm_Start.h"
 
 /******************************************************************************/
 /*                          Fixed simulation settings						  */
 /******************************************************************************/
 typedef std::chrono::high_resolution_clock::time_point timer;
-extern const int T      = 30;		/* Time until data is stored in  s		  */
-extern const int res 	= 1E4;		/* Number of iteration steps per s		  */
-extern const double dt 	= 1E3/res;	/* Duration of a time step in ms		  */
-extern const double h	= sqrt(dt); /* Square root of dt for SRK iteration	  */
+const Simulation_Settings Settings;	/* Resolution, onset and reduction		  */
+const int res 			= Settings.res;
+const unsigned Columns	= 256;		/* Number of columns in the ensemble test */
+const int T_batch		= 2;		/* Duration of the ensemble test in s	  */
+const unsigned Net_size	= 1E4;		/* Columns of the network test			  */
+const unsigned Net_edges= 100;		/* Afferent edges per column			  */
+const int T_net			= 20;		/* Duration of the network test in ms	  */
+const unsigned Sheet_size= 256;		/* Width and height of the sheet test	  */
+const int T_sheet		= 20;		/* Duration of the sheet test in ms		  */
+
+/******************************************************************************/
+/*							Random network for the tests					  */
+/*	Columns on a ring receive edges from their neighborhood with delays of	  */
+/*	1 to 20 ms growing with the distance. The labels are shuffled, so that	  */
+/*	the locality has to be recovered by the reordering.						  */
+/******************************************************************************/
+struct Network_Graph {
+    std::vector<unsigned>	offsets, sources;
+    std::vector<double>		weights, delays;
+};
+
+Network_Graph random_graph(unsigned N, unsigned E, double weight) {
+    std::mt19937 generator(1);
+    std::vector<unsigned> label(N);
+    for (unsigned i=0; i < N; ++i) {
+        label[i] = i;
+    }
+    std::shuffle(label.begin(), label.end(), generator);
+
+    const unsigned range = std::min(N-1, 4*E);
+    std::uniform_int_distribution<unsigned> distance(1, range);
+    Network_Graph G;
+    G.offsets.assign(N+1, 0);
+    std::vector<std::vector<unsigned>> afferent(N);
+    std::vector<std::vector<double>> afferent_delay(N);
+    for (unsigned i=0; i < N; ++i) {
+        for (unsigned e=0; e < E; ++e) {
+            const unsigned d = distance(generator);
+            const unsigned j = (generator() % 2) ? (i + d) % N : (i + N - d) % N;
+            afferent[label[i]].push_back(label[j]);
+            afferent_delay[label[i]].push_back(1 + 19.0*d/range);
+        }
+    }
+    for (unsigned i=0; i < N; ++i) {
+        G.offsets[i+1] = G.offsets[i] + afferent[i].size();
+        G.sources.insert(G.sources.end(), afferent[i].begin(), afferent[i].end());
+        G.delays.insert(G.delays.end(), afferent_delay[i].begin(), afferent_delay[i].end());
+    }
+    G.weights.assign(G.sources.size(), weight);
+    return G;
+}
 
 /******************************************************************************/
 /*                              Main simulation routine						  */
 /******************************************************************************/
 int main(void) {
-    /* Initializing the populations */
-    std::vector<double> input = {6, 1.33, 1E-3};
-    Cortical_Column Cortex = Cortical_Column(input.data());
-
-    /* Take the time of the simulation */
+    /* Timing of the single column and its parts is done by Benchmark.cpp */
     timer start,end;
 
-    /* Simulation */
+    /* Ensemble of columns with varying parameters */
+    std::vector<double> Par_batch;
+    for (unsigned i=0; i < Columns; ++i) {
+        Par_batch.push_back(4.6 + 1.9*i/Columns);
+        Par_batch.push_back(1.33 + 0.67*i/Columns);
+        Par_batch.push_back(1E-3);
+    }
+
+    /* Scalar columns, the seeds are set so that both ensembles are equal */
+    std::vector<Cortical_Column> Cortices;
+    Cortices.reserve(Columns);
+    for (unsigned i=0; i < Columns; ++i) {
+        Cortices.emplace_back(&Par_batch[3*i], Settings, 1, i);
+    }
+    start = std::chrono::high_resolution_clock::now();
+    for (auto& C : Cortices) {
+        for (int t=0; t < T_batch*res; ++t) {
+            C.iterate_ODE();
+        }
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double dif_scalar = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+
+    /* Batched columns */
+    Cortical_Column_Batch Batch(Columns, Par_batch.data(), Settings, 1);
+    start = std::chrono::high_resolution_clock::now();
+    for (int t=0; t < T_batch*res; ++t) {
+        Batch.iterate_ODE();
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double dif_batch = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+
+    /* Compare the final states of both ensembles */
+    double max_dif = 0;
+    std::vector<double> state_scalar(6), state_batch(6);
+    std::vector<double*> ptr_scalar, ptr_batch;
+    for (unsigned j=0; j < 6; ++j) {
+        ptr_scalar.push_back(&state_scalar[j]);
+        ptr_batch.push_back(&state_batch[j]);
+    }
+    for (unsigned i=0; i < Columns; ++i) {
+        get_data(0, Cortices[i], ptr_scalar);
+        get_data(0, Batch, i, ptr_batch);
+        for (unsigned j=0; j < 6; ++j) {
+            max_dif = std::max(max_dif, std::abs(state_scalar[j] - state_batch[j]));
+        }
+    }
+
+    std::cout << "ensemble of " << Columns << " columns\n";
+    std::cout << "scalar: " << Columns*T_batch*res/dif_scalar << " steps per second\n";
+    std::cout << "batch:  " << Columns*T_batch*res/dif_batch  << " steps per second\n";
+    std::cout << "maximal difference: " << max_dif << "\n";
+
+    /* Noise generation, Mersenne Twister against blocks of Philox numbers */
+    const unsigned numNormals = 1<<24;
+    double sum = 0;
+    randomStreamNormal MTRand(0.0, 1.0, 1);
+    start = std::chrono::high_resolution_clock::now();
+    for (unsigned i=0; i < numNormals; ++i) {
+        sum += MTRand();
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double dif_MT = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+
+    randomStreamPhilox Philox(1, 0, 0);
+    std::vector<double> block(256);
+    start = std::chrono::high_resolution_clock::now();
+    for (unsigned i=0; i < numNormals; i += block.size()) {
+        Philox.fill(block.data(), block.size());
+        for (double z : block) {
+            sum += z;
+        }
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double dif_Philox = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+
+    std::cout << "noise generation (checksum " << sum << ")\n";
+    std::cout << "mt19937_64: " << numNormals/dif_MT << " normals per second, "
+              << 4*sizeof(randomStreamNormal) << " bytes per column\n";
+    std::cout << "philox:     " << numNormals/dif_Philox << " normals per second, "
+              << 4*sizeof(randomStreamPhilox) << " bytes per column and "
+              << 4*Cortical_Column::Noise_block*sizeof(double) << " bytes of noise block\n";
+
+    /* Parallel sweep over stimulation strengths with a short onset */
+    const Simulation_Settings Settings_sweep(1, 1E4, 1E2);
+    std::vector<std::vector<double>> Params = {{4.6, 1.33, 2.0}, {6.5, 2.0, 2.0}};
+    std::vector<std::vector<double>> Stims;
+    for (unsigned i=1; i <= 16; ++i) {
+        Stims.push_back({1, 10.0*i, 100, 7, 2, 1, 0, 0});
+    }
+    std::vector<Sweep_Job> jobs = create_grid(1, Params, Stims, 1);
+
+    /* Overhead of the online spectral estimate against storing the data */
+    Sweep_Job job_psd = jobs[0];
+    job_psd.T = 60;
+    Sweep_Result result_psd;
+    result_psd.data.resize(6*job_psd.T*Settings_sweep.res/Settings_sweep.red);
+    start = std::chrono::high_resolution_clock::now();
+    run_simulation(job_psd, Settings_sweep, result_psd);
+    end = std::chrono::high_resolution_clock::now();
+    double dif_store = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+
+    Welch_PSD PSD(Settings_sweep.res/Settings_sweep.red, 1024, 0.5);
+    start = std::chrono::high_resolution_clock::now();
+    run_simulation(job_psd, Settings_sweep, PSD, 0);
+    end = std::chrono::high_resolution_clock::now();
+    double dif_psd = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+    std::cout << "online PSD: " << dif_psd/dif_store << " of the time with stored data, "
+              << "slow oscillation power " << PSD.band_power(0.5, 1.5) << " mV^2\n";
+
+    /* Online detection of down states against storing the data */
+    Event_Detector Detector(Settings_sweep.res/Settings_sweep.red);
+    start = std::chrono::high_resolution_clock::now();
+    run_simulation(job_psd, Settings_sweep, Detector);
+    end = std::chrono::high_resolution_clock::now();
+    double dif_event = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+    std::cout << "event detection: " << dif_event/dif_store << " of the time with stored data, "
+              << Detector.events().size() << " events in " << Detector.events().size()*sizeof(Event)
+              << " bytes instead of " << result_psd.data.size()*sizeof(double) << " bytes\n";
+
+    double dif_single = 0;
+    std::cout << "sweep of " << jobs.size() << " simulations\n";
+    for (unsigned threads=1; threads <= 64; threads *= 2) {
+        start = std::chrono::high_resolution_clock::now();
+        run_sweep(jobs, Settings_sweep, threads);
+        end = std::chrono::high_resolution_clock::now();
+        double dif_sweep = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+        if (threads == 1) {
+            dif_single = dif_sweep;
+        }
+        std::cout << threads << " threads: " << jobs.size()/dif_sweep << " simulations per second, speedup "
+                  << dif_single/dif_sweep << "\n";
+    }
+
+    /* Uncoupled network reproduces the scalar columns of the ensemble test */
+    Network_Graph G_test = random_graph(Columns, 8, 0.0);
+    Cortical_Network Network_test(Columns, Par_batch.data(), G_test.offsets, G_test.sources,
+                                  G_test.weights, G_test.delays, Settings, 1, 4);
+    Network_test.iterate_ODE(T_batch*res);
+    double max_dif_net = 0;
+    for (unsigned i=0; i < Columns; ++i) {
+        max_dif_net = std::max(max_dif_net, std::abs(Network_test.Vp(i) - get_channel(Cortices[i], 0)));
+    }
+    std::cout << "uncoupled network against scalar columns, maximal difference: " << max_dif_net << "\n";
+
+    /* Strong scaling: fixed network, increasing number of threads */
+    const int Steps_net = T_net*res/1000;
+    std::vector<double> Par_large;
+    for (unsigned i=0; i < Net_size; ++i) {
+        Par_large.insert(Par_large.end(), {6.5, 2.0, 2.0});
+    }
+    Network_Graph G = random_graph(Net_size, Net_edges, 10.0/Net_edges);
+    std::cout << "network of " << Net_size << " columns and " << G.sources.size() << " edges\n";
+    for (int reorder=0; reorder < 2; ++reorder) {
+        Cortical_Network Network(Net_size, Par_large.data(), G.offsets, G.sources, G.weights,
+                                 G.delays, Settings, 1, 1, reorder);
+        start = std::chrono::high_resolution_clock::now();
+        Network.iterate_ODE(Steps_net);
+        end = std::chrono::high_resolution_clock::now();
+        double dif_net = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+        std::cout << (reorder ? "reordered: " : "original order: ") << Steps_net/dif_net
+                  << " steps per second, " << 1E-6*Steps_net*G.sources.size()/dif_net
+                  << " million edges per second\n";
+    }
+    double dif_net_single = 0;
+    for (unsigned threads=1; threads <= 8; threads *= 2) {
+        Cortical_Network Network(Net_size, Par_large.data(), G.offsets, G.sources, G.weights,
+                                 G.delays, Settings, 1, threads);
+        start = std::chrono::high_resolution_clock::now();
+        Network.iterate_ODE(Steps_net);
+        end = std::chrono::high_resolution_clock::now();
+        double dif_net = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+        if (threads == 1) {
+            dif_net_single = dif_net;
+        }
+        std::cout << "strong scaling, " << Network.threads() << " threads: " << Steps_net/dif_net
+                  << " steps per second, speedup " << dif_net_single/dif_net << "\n";
+    }
+
+    /* Weak scaling: fixed number of columns per thread */
+    for (unsigned threads=1; threads <= 8; threads *= 2) {
+        const unsigned N_weak = threads*Net_size/8;
+        Network_Graph G_weak = random_graph(N_weak, Net_edges, 10.0/Net_edges);
+        Cortical_Network Network(N_weak, Par_large.data(), G_weak.offsets, G_weak.sources,
+                                 G_weak.weights, G_weak.delays, Settings, 1, threads);
+        start = std::chrono::high_resolution_clock::now();
+        Network.iterate_ODE(Steps_net);
+        end = std::chrono::high_resolution_clock::now();
+        double dif_net = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+        if (threads == 1) {
+            dif_net_single = dif_net;
+        }
+        std::cout << "weak scaling, " << N_weak << " columns, " << Network.threads() << " threads: "
+                  << "efficiency " << dif_net_single/dif_net << "\n";
+    }
+
+    /* Uncoupled sheet reproduces the scalar columns of the ensemble test */
+    Cortical_Sheet Sheet_test(16, Columns/16, Par_batch.data(), 0.0, Settings, 1, 4);
+    Sheet_test.iterate_ODE(T_batch*res);
+    double max_dif_sheet = 0;
+    for (unsigned i=0; i < Columns; ++i) {
+        max_dif_sheet = std::max(max_dif_sheet, std::abs(Sheet_test.Vp(i%16, i/16) - get_channel(Cortices[i], 0)));
+    }
+    std::cout << "uncoupled sheet against scalar columns, maximal difference: " << max_dif_sheet << "\n";
+
+    /* Coupled sheet with a stimulated spot, the result must not depend on the
+     * number of threads */
+    const int Steps_sheet = T_sheet*res/1000;
+    std::vector<double> Par_sheet;
+    for (unsigned i=0; i < Sheet_size*Sheet_size; ++i) {
+        Par_sheet.insert(Par_sheet.end(), {6.5, 2.0, 2.0});
+    }
+    std::vector<double> frame_single;
+    double dif_sheet_single = 0;
+    for (unsigned threads=1; threads <= 8; threads *= 2) {
+        Cortical_Sheet Sheet(Sheet_size, Sheet_size, Par_sheet.data(), 1.0, Settings, 1, threads);
+        Sheet.set_input(Sheet_size/2, Sheet_size/2, 0.1);
+        std::vector<double> frame(Sheet.frame_size());
+        start = std::chrono::high_resolution_clock::now();
+        for (int t=0; t < Steps_sheet; t += Settings.red) {
+            Sheet.iterate_ODE(Settings.red);
+            Sheet.get_frame(frame.data());
+        }
+        end = std::chrono::high_resolution_clock::now();
+        double dif_sheet = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+        double max_dif_threads = 0;
+        if (threads == 1) {
+            dif_sheet_single = dif_sheet;
+            frame_single = frame;
+        }
+        for (unsigned i=0; i < frame.size(); ++i) {
+            max_dif_threads = std::max(max_dif_threads, std::abs(frame[i] - frame_single[i]));
+        }
+        std::cout << "sheet of " << Sheet_size << "x" << Sheet_size << ", " << Sheet.threads()
+                  << " threads: " << 1E-3*T_sheet/dif_sheet << " times real time, speedup "
+                  << dif_sheet_single/dif_sheet << ", difference to 1 thread " << max_dif_threads << "\n";
+    }
+
+    /* A restored checkpoint continues the simulation exactly */
+    double Par_N2[3] = {4.6, 1.33, 2.0};
+    Cortical_Column Original(Par_N2, Settings, 3, 7);
+    for (int t=0; t < res + 37; ++t) {
+        Original.iterate_ODE();
+    }
+    Cortical_Column Restored(Par_N2, Settings, 99, 5);
+    Restored.set_state(Original.get_state());
+    double max_dif_state = 0;
+    for (int t=0; t < res; ++t) {
+        Original.iterate_ODE();
+        Restored.iterate_ODE();
+        max_dif_state = std::max(max_dif_state, std::abs(get_channel(Original, 0) - get_channel(Restored, 0)));
+    }
+    std::cout << "restored checkpoint, maximal difference: " << max_dif_state << "\n";
+
+    /* The adaptive integrator falls back to iterate_ODE instead of shrinking
+     * the step forever when the error is not finite */
+    double Par_NaN[3] = {4.6, 1.33, 0.0};
+    Cortical_Column Broken(Par_NaN, Settings, 3);
+    Cortical_Column::State state_NaN = Broken.get_state();
+    state_NaN.y[Cortex_Model::Vp] = std::nan("");
+    Broken.set_state(state_NaN);
+    Dormand_Prince Solver_NaN(Broken, Settings);
+    for (int t=0; t < 10; ++t) {
+        Solver_NaN.step();
+    }
+    std::cout << "adaptive integration of a non finite state: " << Solver_NaN.fallbacks()
+              << " of 10 steps fell back to SRK4\n";
+
+    /* Repeated short runs as in Data_Stimulation.m, noise free columns start
+     * from the cached state without decorrelation */
+    std::vector<Sweep_Job> jobs_warm = create_grid(4, {{4.6, 1.33, 0.0}, {6.5, 2.0, 0.0}},
+                                                   std::vector<std::vector<double>>(15, {1, 100, 100, 7, 2, 1, 0, 0}), 1);
+    Simulation_Settings Settings_warm = Settings;
+    Settings_warm.warm_start = 0;
+    start = std::chrono::high_resolution_clock::now();
+    std::vector<Sweep_Result> results_cold = run_sweep(jobs_warm, Settings, 1);
+    end = std::chrono::high_resolution_clock::now();
+    double dif_cold = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+    start = std::chrono::high_resolution_clock::now();
+    std::vector<Sweep_Result> results_warm = run_sweep(jobs_warm, Settings_warm, 1);
+    end = std::chrono::high_resolution_clock::now();
+    double dif_warm = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+    double max_dif_warm = 0;
+    for (unsigned j=0; j < jobs_warm.size(); ++j) {
+        for (unsigned i=0; i < results_cold[j].data.size()/6; ++i) {
+            max_dif_warm = std::max(max_dif_warm, std::abs(results_cold[j].data[i] - results_warm[j].data[i]));
+        }
+    }
+    std::cout << "warm start of " << jobs_warm.size() << " noise free runs: speedup " << dif_cold/dif_warm
+              << ", " << Warm_Start_Cache::shared().misses() << " transients computed, maximal difference of Vp "
+              << max_dif_warm << " mV\n";
+
+    /* Noisy columns decorrelate for 1 s after the cached onset */
+    for (auto& job : jobs_warm) {
+        job.Param_Cortex[2] = 2.0;
+    }
+    Settings_warm.warm_start = 1;
+    start = std::chrono::high_resolution_clock::now();
+    run_sweep(jobs_warm, Settings, 1);
+    end = std::chrono::high_resolution_clock::now();
+    dif_cold = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+    start = std::chrono::high_resolution_clock::now();
+    run_sweep(jobs_warm, Settings_warm, 1);
+    end = std::chrono::high_resolution_clock::now();
+    dif_warm = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+    std::cout << "warm start of " << jobs_warm.size() << " noisy runs with 1 s decorrelation: speedup "
+              << dif_cold/dif_warm << "\n";
+
+    /* States on disk are found again after the memory cache is cleared */
+    Warm_Start_Cache::shared().set_directory(".");
+    Cortical_Column Disk(Par_N2, Settings, 1);
+    Warm_Start_Cache::shared().clear();
+    start = std::chrono::high_resolution_clock::now();
+    Cortical_Column::State state_memory = Warm_Start_Cache::shared().get(Disk, Settings);
+    end = std::chrono::high_resolution_clock::now();
+    double dif_transient = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+    Warm_Start_Cache::shared().clear();
     start = std::chrono::high_resolution_clock::now();
-    for (unsigned t=0; t < T*res; ++t) {
-        Cortex.iterate_ODE();
+    Cortical_Column::State state_disk = Warm_Start_Cache::shared().get(Disk, Settings);
+    end = std::chrono::high_resolution_clock::now();
+    double dif_disk = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+    std::cout << "transient: " << 1E3*dif_transient << " ms, from disk: " << 1E3*dif_disk
+              << " ms, difference of Vp " << std::abs(state_memory.y[0] - state_disk.y[0]) << " mV\n";
+
+    /* Analytic Jacobian against central differences */
+    const unsigned n = Cortical_Column::numStates;
+    std::vector<double> J(n*n), J_par(3*n), F_up(n), F_down(n);
+    Cortex_Model::jacobian(state_disk.y.data(), J.data(), J_par.data(), 4.6, 1.33, Settings.dt);
+    double max_dif_jacobian = 0;
+    for (unsigned j=0; j < n; ++j) {
+        std::array<double, n> y_up = state_disk.y, y_down = state_disk.y;
+        const double h = 1E-6*(1 + std::abs(y_up[j]));
+        y_up[j]		+= h;
+        y_down[j]	-= h;
+        Cortex_Model::vector_field(y_up.data(), F_up.data(), 4.6, 1.33, 0, Settings.dt);
+        Cortex_Model::vector_field(y_down.data(), F_down.data(), 4.6, 1.33, 0, Settings.dt);
+        for (unsigned i=0; i < n; ++i) {
+            const double dif = (F_up[i] - F_down[i])/(2*h) - J[i*n+j];
+            max_dif_jacobian = std::max(max_dif_jacobian, std::abs(dif)/(1 + std::abs(J[i*n+j])));
+        }
     }
+    std::cout << "analytic Jacobian, maximal relative difference to finite differences: " << max_dif_jacobian << "\n";
+
+    /* A noise free simulation started at an equilibrium stays there, up to
+     * the second noise term of the SRK4 scheme that does not scale with dphi */
+    Continuation Bifurcation(Settings);
+    Continuation::Parameters par_eq = {{3, 1.0, 0}};
+    Continuation::State y_eq = Bifurcation.guess(par_eq, -66, -66);
+    const bool converged = Bifurcation.equilibrium(par_eq, y_eq);
+    double Par_eq[3] = {3, 1.0, 0};
+    Cortical_Column Settled(Par_eq, Settings);
+    Cortical_Column::State state_eq = Settled.get_state();
+    state_eq.y = y_eq;
+    Settled.set_state(state_eq);
+    double max_dif_eq = 0;
+    for (int t=0; t < 10*res; ++t) {
+        Settled.iterate_ODE();
+        max_dif_eq = std::max(max_dif_eq, std::abs(y_eq[0] - get_channel(Settled, 0)));
+    }
+    std::cout << "equilibrium " << (converged ? "" : "not ") << "found, stable: "
+              << Bifurcation.classify(par_eq, y_eq).stable << ", drift of Vp in 10 s of simulation "
+              << max_dif_eq << " mV\n";
+
+    /* Branch of the A-diagram */
+    par_eq[Continuation::G_KNA] = 0;
+    y_eq = Bifurcation.guess(par_eq, -45, -45);
+    Bifurcation.equilibrium(par_eq, y_eq);
+    start = std::chrono::high_resolution_clock::now();
+    std::vector<Continuation::Point> branch = Bifurcation.branch(Bifurcation.classify(par_eq, y_eq),
+                                                                 Continuation::G_KNA, 0, 10);
     end = std::chrono::high_resolution_clock::now();
+    std::cout << "branch of " << branch.size() << " equilibria for sigma_p = 3 in "
+              << 1E3*1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count() << " ms:";
+    for (auto& point : branch) {
+        if (point.label != Continuation::REGULAR) {
+            std::cout << (point.label == Continuation::HOPF ? " Hopf" : " fold") << " at g_KNa = "
+                      << point.par[Continuation::G_KNA];
+        }
+    }
+    std::cout << "\n";
 
-    /* Time consumed by the simulation */
-    double dif = 1E-3*std::chrono::duration_cast<std::chrono::milliseconds>( end - start ).count();
-    std::cout << "simulation done!\n";
-    std::cout << "took " << dif 	<< " seconds" << "\n";
+    /* Closed loop at 10 kHz with 1 kHz output, a client switches the
+     * stimulus every 50 ms and reads the samples for 2 s */
+    Real_Time_Column Loop(Par_N2, Settings, 10, 10, 1);
+    Loop.start();
+    std::vector<Real_Time_Column::Sample> received(256);
+    Latency_Histogram latency_client;
+    const int64_t loop_start = Real_Time_Column::now();
+    int64_t next_command = loop_start;
+    bool stimulus = false;
+    while (Real_Time_Column::now() - loop_start < 2000000000) {
+        const size_t n = Loop.receive(received.data(), received.size());
+        const int64_t arrival = Real_Time_Column::now();
+        for (size_t i=0; i < n; ++i) {
+            latency_client.add(arrival - received[i].time);
+        }
+        if (arrival >= next_command) {
+            stimulus = !stimulus;
+            stimulus ? Loop.stimulus_on(0.06) : Loop.stimulus_off();
+            next_command += 50000000;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    Loop.stop();
+    auto print_latency = [](const std::string& name, const Latency_Histogram& latency) {
+        std::cout << "  " << name << ": " << latency.count() << " values, median " << latency.quantile(0.5)
+                  << " us, 99% " << latency.quantile(0.99) << " us, maximum " << latency.max() << " us\n";
+    };
+    std::cout << "real time loop: " << Loop.blocks() << " blocks of 1 ms in 2 s, "
+              << Loop.deadline_misses() << " deadline misses, " << Loop.dropped_samples() << " dropped samples\n";
+    print_latency("command to input", Loop.command_latency());
+    print_latency("state to sample ", Loop.sample_latency());
+    print_latency("state to client ", latency_client);
+    /* Eight protocols forked at the first trough after the onset, compared
+     * with complete runs of the same protocols and noise */
+    Fork_Job fork{4, {6.5, 2.0, 2.0}, {}, 0, true, -72, 1, 3};
+    for (int k=0; k < 8; ++k) {
+        fork.Stims.push_back({2, 10.0*(k+1), 100, 5, 0, 1, 0, 50.0*k});
+    }
+    start = std::chrono::high_resolution_clock::now();
+    Fork_Result forked = run_forks(fork, Settings, 1);
+    end = std::chrono::high_resolution_clock::now();
+    double dif_fork = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+    if (forked.branch_step < 0) {
+        std::cout << "forked trials: no trough found\n";
+    } else {
+        const int T_full = forked.first_sample*Settings.red/res + fork.T + 1;
+        std::vector<Sweep_Job> jobs_fork;
+        for (auto& var_stim : fork.Stims) {
+            jobs_fork.push_back(Sweep_Job{T_full, fork.Param_Cortex, var_stim, fork.seed, fork.id});
+        }
+        start = std::chrono::high_resolution_clock::now();
+        std::vector<Sweep_Result> results_full = run_sweep(jobs_fork, Settings, 1);
+        end = std::chrono::high_resolution_clock::now();
+        double dif_full = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+        double max_dif_fork = 0;
+        bool same_marker = true;
+        for (unsigned j=0; j < jobs_fork.size(); ++j) {
+            Sweep_Result& branch = forked.branches[j];
+            const unsigned samples = branch.data.size()/6;
+            for (unsigned c=0; c < 6; ++c) {
+                for (unsigned i=0; i < samples; ++i) {
+                    max_dif_fork = std::max(max_dif_fork, std::abs(branch.channel(c)[i] -
+                                            results_full[j].channel(c)[forked.first_sample + i]));
+                }
+            }
+            std::vector<double> marker;
+            for (auto& elem : results_full[j].marker) {
+                if (elem >= forked.first_sample - 1 && elem < forked.first_sample + (int) samples) {
+                    marker.push_back(elem);
+                }
+            }
+            same_marker = same_marker && marker == branch.marker;
+        }
+        std::cout << "forked trials: branch at " << (double) forked.branch_step/res - Settings.onset
+                  << " s, " << fork.Stims.size() << " branches in " << dif_fork << " s, complete runs "
+                  << dif_full << " s, maximal difference " << max_dif_fork
+                  << (same_marker ? ", same" : ", different") << " markers\n";
+    }
+
+    /* Responses to semi-periodic stimuli averaged over trials until the
+     * confidence interval in the first 0.5 s after the stimulus is below
+     * 4 mV, with one and two threads and from the stored trials */
+    Monte_Carlo_Job trials;
+    trials.trial		= Sweep_Job{8, {6.5, 2.0, 2.0}, {1, 60, 100, 2, 0, 1, 0, 0}, 1, 0};
+    trials.aligned		= true;
+    trials.max_trials	= 30;
+    trials.width		= 4;
+    trials.stop_end		= 0.5;
+    trials.hist_bins	= 200;
+    start = std::chrono::high_resolution_clock::now();
+    Monte_Carlo_Result mc = run_trials(trials, Settings, 1);
+    end = std::chrono::high_resolution_clock::now();
+    double dif_mc = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+    Monte_Carlo_Result mc_parallel = run_trials(trials, Settings, 2);
+    std::vector<Sweep_Job> jobs_mc;
+    for (unsigned k=0; k < mc.trials; ++k) {
+        jobs_mc.push_back(trials.trial);
+        jobs_mc.back().id += k;
+    }
+    std::vector<Sweep_Result> results_mc = run_sweep(jobs_mc, Settings, 1);
+    const Running_Statistics& stat = mc.statistics;
+    const int pre_mc = -mc.t0/mc.dt + 0.5;
+    double max_dif_mc = 0;
+    bool same_parallel = mc_parallel.trials == mc.trials;
+    for (unsigned i=0; i < stat.bins(); ++i) {
+        double sum = 0;
+        unsigned epochs = 0;
+        for (auto& trial : results_mc) {
+            for (double marker : trial.marker) {
+                const int begin = (int) marker - pre_mc;
+                if (begin >= 0 && begin + stat.bins() <= trial.data.size()/6) {
+                    sum += trial.channel(0)[begin + i];
+                    ++epochs;
+                }
+            }
+        }
+        max_dif_mc = std::max(max_dif_mc, std::abs(sum/epochs - stat.mean(i)));
+        same_parallel = same_parallel && mc_parallel.statistics.mean(i) == stat.mean(i)
+                                      && mc_parallel.statistics.variance(i) == stat.variance(i);
+    }
+    const unsigned bin_mc = pre_mc + 0.3/mc.dt;
+    std::cout << "monte carlo trials: " << mc.trials << " trials, " << stat.count() << " epochs in "
+              << dif_mc << " s, " << (mc.converged ? "converged" : "not converged")
+              << ", Vp at 0.3 s " << stat.mean(bin_mc) << " +- " << stat.ci_width(bin_mc)/2
+              << " mV, median " << stat.quantile(bin_mc, 0.5) << " mV, maximal difference "
+              << max_dif_mc << (same_parallel ? ", same" : ", different") << " with two threads\n";
+
+    /* Fit of sigma_p and g_KNa to the features of a reference, once in one
+     * go and once interrupted after half of the generations */
+    Fit_Job fit;
+    fit.T			= 20;
+    fit.var_stim	= {1, 60, 100, 4, 0, 1, 0, 0};
+    fit.population	= 10;
+    fit.generations	= 6;
+    fit.target		= fit_features(fit, Settings, {5.5, 1.8, 2.0}, 1);
+    start = std::chrono::high_resolution_clock::now();
+    Fit_Result fitted = fit_parameters(fit, Settings, 1);
+    end = std::chrono::high_resolution_clock::now();
+    double dif_fit = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+    fit.checkpoint	= "fit_checkpoint.bin";
+    fit.generations	= 3;
+    fit_parameters(fit, Settings, 1);
+    fit.generations	= 6;
+    Fit_Result resumed = fit_parameters(fit, Settings, 1);
+    fit.seed		= 2;
+    fit.generations	= 0;
+    const bool rejected = fit_parameters(fit, Settings, 1).evaluations == fit.population;
+    std::remove(fit.checkpoint.c_str());
+    bool rejected_bounds = false;
+    try {
+        fit.lower = {7.0, 1.0, 2.0};
+        fit.upper = {4.0, 2.5, 2.0};
+        fit_parameters(fit, Settings, 1);
+    } catch (const std::invalid_argument&) {
+        rejected_bounds = true;
+    }
+    std::cout << "parameter fit: " << fitted.evaluations << " candidates in " << dif_fit << " s, sigma_p "
+              << fitted.parameters[0] << ", g_KNa " << fitted.parameters[1] << ", score "
+              << fitted.history.front() << " -> " << fitted.score << ", resumed "
+              << (resumed.parameters == fitted.parameters && resumed.history == fitted.history ? "same" : "different")
+              << " after " << resumed.evaluations << " candidates, checkpoint of another seed "
+              << (rejected ? "rejected" : "continued") << ", swapped bounds "
+              << (rejected_bounds ? "rejected" : "accepted") << "\n";
+
+    /* A session advanced in chunks of 0.5 s against a single simulation, a
+     * second session continues from the state of the first after 2 s */
+    Sweep_Job job_session{6, {6.5, 2.0, 2.0}, {2, 60, 100, 2, 0, 1, 0, 300}, 5, 2};
+    Sweep_Result single;
+    single.data.resize(6 * job_session.T*res/Settings.red);
+    run_simulation(job_session, Settings, single);
+    Column_Session Session(job_session.Param_Cortex, job_session.var_stim, job_session.seed,
+                           job_session.id, Settings);
+    std::unique_ptr<Column_Session> Resumed;
+    const int chunk = Session.samples(0.5);
+    std::vector<double> chunks(6*chunk), marker_session;
+    std::vector<double*> ptr_chunks;
+    for (unsigned c=0; c < 6; ++c) {
+        ptr_chunks.push_back(&chunks[c*chunk]);
+    }
+    double max_dif_session = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (int k=0; k < 2*job_session.T; ++k) {
+        for (double m : Session.advance(0.5, ptr_chunks)) {
+            marker_session.push_back(m);
+        }
+        for (unsigned c=0; c < 6; ++c) {
+            for (int i=0; i < chunk; ++i) {
+                max_dif_session = std::max(max_dif_session, std::abs(chunks[c*chunk+i] - single.channel(c)[k*chunk+i]));
+            }
+        }
+        if (k == 3) {
+            Session.set_parameters(job_session.Param_Cortex);
+            Resumed.reset(new Column_Session(job_session.Param_Cortex, job_session.var_stim,
+                                             job_session.seed, job_session.id, Settings));
+            Resumed->set_state(Session.get_state());
+        }
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double dif_session = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+    std::vector<double> rest(6 * (job_session.T - 2)*res/Settings.red);
+    std::vector<double*> ptr_rest;
+    for (unsigned c=0; c < 6; ++c) {
+        ptr_rest.push_back(&rest[c*rest.size()/6]);
+    }
+    const std::vector<double> marker_resumed = Resumed->advance(job_session.T - 2, ptr_rest);
+    double max_dif_resumed = 0;
+    for (unsigned c=0; c < 6; ++c) {
+        for (unsigned i=0; i < rest.size()/6; ++i) {
+            max_dif_resumed = std::max(max_dif_resumed, std::abs(ptr_rest[c][i] - single.channel(c)[4*chunk+i]));
+        }
+    }
+    std::vector<double> marker_rest;
+    std::copy_if(single.marker.begin(), single.marker.end(), std::back_inserter(marker_rest),
+                 [chunk](double m) {return m >= 4*chunk;});
+    std::cout << "session: " << 2*job_session.T << " chunks in " << dif_session << " s, maximal difference "
+              << max_dif_session << (marker_session == single.marker ? ", same" : ", different")
+              << " markers, resumed after 2 s " << max_dif_resumed
+              << (marker_resumed == marker_rest ? ", same" : ", different") << " markers\n";
+
+    /* A state taken after set_parameters carries the new parameters into a
+     * session that was created with different ones */
+    Column_Session Changed(job_session.Param_Cortex, job_session.var_stim, job_session.seed,
+                           job_session.id, Settings);
+    Changed.advance(0.5, ptr_chunks);
+    Changed.advance(0.5, ptr_chunks);
+    Changed.set_parameters({5.5, 1.8, 3.0});
+    Changed.advance(0.5, ptr_chunks);
+    Column_Session Receiver({4.6, 1.33, 1.0}, job_session.var_stim, 1, 0, Settings);
+    Receiver.set_state(Changed.get_state());
+    std::vector<double> continued(6*chunk);
+    std::vector<double*> ptr_continued;
+    for (unsigned c=0; c < 6; ++c) {
+        ptr_continued.push_back(&continued[c*chunk]);
+    }
+    Changed.advance(0.5, ptr_chunks);
+    Receiver.advance(0.5, ptr_continued);
+    double max_dif_changed = 0;
+    for (int i=0; i < 6*chunk; ++i) {
+        max_dif_changed = std::max(max_dif_changed, std::abs(chunks[i] - continued[i]));
+    }
+    std::cout << "session state after set_params, resumed with other parameters: maximal difference "
+              << max_dif_changed << "\n";
+
+    /* Sessions with semi-periodic stimulation, fixed and random intervals,
+     * resumed from a state taken in the middle of the first stimulus */
+    for (auto var_stim : {std::vector<double>{1, 60, 100, 1, 0, 1, 0, 0},
+                          std::vector<double>{1, 60, 100, 2, 1, 1, 0, 0}}) {
+        Sweep_Job job_pulse{10, {6.5, 2.0, 2.0}, var_stim, 5, 2};
+        Sweep_Result whole;
+        whole.data.resize(6 * job_pulse.T*res/Settings.red);
+        run_simulation(job_pulse, Settings, whole);
+        Column_Session First(job_pulse.Param_Cortex, job_pulse.var_stim, job_pulse.seed, job_pulse.id, Settings);
+        const int before	= whole.marker.front() + var_stim[2]/2000*res/Settings.red;
+        const int after		= whole.data.size()/6 - before;
+        auto duration = [](int samples) {return (samples + 0.5)*Settings.red/res;};
+        std::vector<double> part(6*after);
+        std::vector<double*> ptr_part;
+        for (unsigned c=0; c < 6; ++c) {
+            ptr_part.push_back(&part[c*after]);
+        }
+        std::vector<double> marker_pulse = First.advance(duration(before), ptr_part);
+        const Column_Session::State state_pulse = First.get_state();
+        assert(state_pulse.column.input != 0);
+        Column_Session Second(job_pulse.Param_Cortex, {0, 0, 0, 0, 0, 0, 0, 0}, 1, 0, Settings);
+        Second.set_state(state_pulse);
+        for (double m : Second.advance(duration(after), ptr_part)) {
+            marker_pulse.push_back(m);
+        }
+        double max_dif_pulse = 0;
+        for (unsigned c=0; c < 6; ++c) {
+            for (int i=0; i < after; ++i) {
+                max_dif_pulse = std::max(max_dif_pulse, std::abs(part[c*after+i] - whole.channel(c)[before+i]));
+            }
+        }
+        std::cout << "session resumed during a stimulus, ISI range " << var_stim[4] << " s: split at "
+                  << before << " samples, input " << state_pulse.column.input << ", maximal difference " << max_dif_pulse
+                  << (marker_pulse == whole.marker ? ", same " : ", different ") << whole.marker.size()
+                  << " markers\n";
+    }
+
+    /* Probes of Vp at the rate of get_data and of Na, Qp, I_KNa and the input
+     * at 10 Hz, compared with the six channels of run_simulation */
+    const int samples_probe = job_session.T*res/Settings.red;
+    const int windows_probe = job_session.T*10;
+    std::vector<double> Vp_probe(samples_probe), summary(5*windows_probe);
+    Probe_Recorder Recorder({Probe(Cortex_Model::Vp, Settings.red, Probe::Sample, Vp_probe.data(), samples_probe),
+                             Probe(Cortex_Model::Vp, res/10, Probe::Min,  &summary[0], windows_probe, 5),
+                             Probe(Cortex_Model::Vp, res/10, Probe::Mean, &summary[1], windows_probe, 5),
+                             Probe(Cortex_Model::Vp, res/10, Probe::Max,  &summary[2], windows_probe, 5),
+                             Probe(Probe::I_KNa,	 res/10, Probe::Mean, &summary[3], windows_probe, 5),
+                             Probe(Probe::Input,	 res/10, Probe::Max,  &summary[4], windows_probe, 5)});
+    start = std::chrono::high_resolution_clock::now();
+    std::vector<double> marker_probe = run_simulation(job_session, Settings, Recorder);
+    end = std::chrono::high_resolution_clock::now();
+    double dif_probe = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+    double max_dif_probe = 0;
+    for (int i=0; i < samples_probe; ++i) {
+        max_dif_probe = std::max(max_dif_probe, std::abs(Vp_probe[i] - single.channel(0)[i]));
+    }
+    bool rejected_probe = false;
+    try {
+        Probe(Probe::Input + 1);
+    } catch (const std::invalid_argument&) {
+        rejected_probe = true;
+    }
+    bool ordered = true;
+    unsigned stimulated = 0;
+    for (int k=0; k < windows_probe; ++k) {
+        ordered = ordered && summary[5*k] <= summary[5*k+1] && summary[5*k+1] <= summary[5*k+2];
+        stimulated += summary[5*k+4] > 0;
+    }
+    std::cout << "probes: " << Recorder.count(0) << " samples of Vp and " << Recorder.count(1)
+              << " windows in " << dif_probe << " s, maximal difference " << max_dif_probe
+              << (marker_probe == single.marker ? ", same" : ", different") << " markers, "
+              << (ordered ? "ordered" : "unordered") << " min/mean/max, " << stimulated
+              << " windows with input, unknown quantity " << (rejected_probe ? "rejected" : "accepted") << "\n";
     std::cout << "end\n";
 }
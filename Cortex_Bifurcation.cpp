@@ -0,0 +1,155 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+
+/******************************************************************************/
+/*						Bifurcation diagrams nm_bifurcation					  */
+/*																			  */
+/*	Recomputes the diagrams in Figures/Data with Continuation.h. Usage:		  */
+/*		nm_bifurcation output_directory [threads]							  */
+/*	A-, B- and C-diagram.dat are the equilibria in g_KNa for sigma_p = 3, 5	  */
+/*	and 9, Hopf- and Saddle-diagram.dat the curves of Hopf points and folds	  */
+/*	in g_KNa and sigma_p. Periodic orbits are not continued.				  */
+/******************************************************************************/
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include "Continuation.h"
+#include "Simulation_Settings.h"
+
+const Simulation_Settings Settings;
+
+typedef std::vector<Continuation::Point> Branch;
+
+/* Ranges of the diagrams */
+const double g_min		= 0,	g_max		= 10;
+const double g_min_2D	= 0,	g_max_2D	= 8.2;
+const double sigma_min	= 0.1,	sigma_max	= 10.5;
+
+/* True if the branch passes through the equilibrium start */
+static bool contains(const Branch& branch, const Continuation::Point& start) {
+    const double g = start.par[Continuation::G_KNA];
+    for (unsigned k=1; k < branch.size(); ++k) {
+        const double g0 = branch[k-1].par[Continuation::G_KNA];
+        const double g1 = branch[k].par[Continuation::G_KNA];
+        if ((g - g0) * (g - g1) <= 0 && g0 != g1) {
+            const double Vp = branch[k-1].y[0] + (g - g0)/(g1 - g0) * (branch[k].y[0] - branch[k-1].y[0]);
+            if (std::abs(Vp - start.y[0]) < 0.1) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "usage: " << argv[0] << " output_directory [threads]\n";
+        return 1;
+    }
+    const std::string output	= argv[1];
+    const unsigned threads		= argc == 3 ? std::atoi(argv[2]) : 0;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    /* Every slice is started at the upper equilibrium for small g_KNa and the
+     * lower one for large g_KNa, which covers all branches of the figures */
+    const Continuation C(Settings);
+    const double sigma[3]	= {3, 5, 9};
+    const char* names[3]	= {"A", "B", "C"};
+    std::vector<Continuation::Point> starts;
+    std::vector<unsigned> slice;
+    for (unsigned s=0; s < 3; ++s) {
+        for (auto guess : {std::make_pair(g_min, -45.), std::make_pair(g_max, -75.)}) {
+            const Continuation::Parameters par = {{sigma[s], guess.first, 0}};
+            Continuation::State y = C.guess(par, guess.second, guess.second);
+            if (C.equilibrium(par, y)) {
+                starts.push_back(C.classify(par, y));
+                slice.push_back(s);
+            }
+        }
+    }
+    auto branches = compute_branches(C, starts, Continuation::G_KNA, g_min, g_max, threads);
+
+    bool failed = false;
+    Continuation::Point hopf, fold;
+    hopf.label = fold.label = Continuation::REGULAR;
+    for (unsigned s=0; s < 3; ++s) {
+        std::vector<Branch> diagram;
+        for (unsigned b=0; b < branches.size(); ++b) {
+            if (slice[b] != s) {
+                continue;
+            }
+            bool known = false;
+            for (auto& branch : diagram) {
+                known = known || contains(branch, starts[b]);
+            }
+            if (known) {
+                continue;
+            }
+            diagram.push_back(branches[b]);
+            for (auto& point : branches[b]) {
+                if (point.label == Continuation::REGULAR) {
+                    continue;
+                }
+                Continuation::Point& first = point.label == Continuation::HOPF ? hopf : fold;
+                if (first.label == Continuation::REGULAR) {
+                    first = point;
+                }
+                std::cout << names[s] << ": " << (point.label == Continuation::HOPF ? "Hopf" : "fold")
+                          << " at g_KNa = " << point.par[Continuation::G_KNA]
+                          << ", Vp = " << point.y[0] << "\n";
+            }
+        }
+        const std::string path = output + "/" + names[s] + "-diagram.dat";
+        if (!write_diagram(path, diagram, Continuation::G_KNA)) {
+            std::cerr << "could not write " << path << "\n";
+            failed = true;
+        }
+    }
+
+    /* Curves of the first Hopf point and fold in g_KNa and sigma_p */
+    const std::pair<const char*, Continuation::Point*> curves[2] = {{"Hopf", &hopf}, {"Saddle", &fold}};
+    for (auto& curve : curves) {
+        if (curve.second->label == Continuation::REGULAR) {
+            std::cerr << "no " << curve.first << " point found\n";
+            failed = true;
+            continue;
+        }
+        std::vector<Branch> diagram(1, C.curve(*curve.second, Continuation::G_KNA, Continuation::SIGMA_P,
+                                               g_min_2D, g_max_2D, sigma_min, sigma_max));
+        const std::string path = output + "/" + curve.first + "-diagram.dat";
+        if (!write_diagram(path, diagram, Continuation::G_KNA, Continuation::SIGMA_P)) {
+            std::cerr << "could not write " << path << "\n";
+            failed = true;
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "diagrams computed in "
+              << 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count()
+              << " s\n";
+    return failed ? 1 : 0;
+}
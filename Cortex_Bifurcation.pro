@@ -0,0 +1,29 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+TARGET = nm_bifurcation
+
+SOURCES +=  Cortex_Bifurcation.cpp \
+			Continuation.cpp    \
+			Cortex_Model.cpp    \
+			Cortical_Column.cpp
+
+HEADERS +=  Continuation.h      \
+			Cortex_Model.h      \
+			Cortical_Column.h   \
+			Math_Backend.h      \
+			Random_Stream.h     \
+			Simulation_Settings.h \
+			SRK4.h
+
+QMAKE_CXXFLAGS += -std=c++11 -pthread
+LIBS += -pthread
+QMAKE_CXXFLAGS_RELEASE -= -O1
+QMAKE_CXXFLAGS_RELEASE -= -O2
+QMAKE_CXXFLAGS_RELEASE *= -O3
+
+# Implementation of exp and pow, see Math_Backend.h
+# 0 == libm, 1 == polynomial (vectorized), 2 == table
+DEFINES += MATH_BACKEND=0
@@ -0,0 +1,97 @@
+/*
+ *	Copyright (c) 2014 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ *
+ *	Based on:	Characterization of K-Complexes and Slow Wave Activity in a Neural Mass Model
+ *				A Weigenand, M Schellenberger Costa, H-VV Ngo, JC Claussen, T Martinetz
+ *				PLoS Computational Biology. 2014;10:e1003923
+ */
+
+/******************************************************************************/
+/*						Functions of the vector field						  */
+/******************************************************************************/
+#include <algorithm>
+
+#include "Cortex_Model.h"
+
+// std::array needs to be defined here
+constexpr Cortex_Model::State Cortex_Model::initial;
+constexpr std::array<unsigned, Cortex_Model::numNoise> Cortex_Model::noise_states;
+constexpr std::array<double, Cortex_Model::numNoise> Cortex_Model::noise_gain;
+
+/******************************************************************************/
+/*                          Jacobian of the vector field                      */
+/******************************************************************************/
+void Cortex_Model::jacobian(const double* y, double* J, double* J_par, double sigma_p,
+                            double g_KNa, double dt) {
+    const double Vp_ = y[0], Vi_ = y[1], Na_ = y[2];
+    const double sep = y[3], sei = y[4], sgp = y[5], sgi = y[6];
+    const unsigned n = numStates;
+    std::fill(J, J + n*n, 0.0);
+    std::fill(J_par, J_par + 3*n, 0.0);
+
+    /* Derivatives of the sigmoids with respect to the voltage and sigma_p */
+    const double Qp		= Qp_max / (1 + math_exp(-C1 * (Vp_ - theta_p) / sigma_p));
+    const double Qi		= Qi_max / (1 + math_exp(-C1 * (Vi_ - theta_i) / sigma_i));
+    const double dQp	= Qp * (1 - Qp/Qp_max) * C1 / sigma_p;
+    const double dQi	= Qi * (1 - Qi/Qi_max) * C1 / sigma_i;
+    const double dQp_s	= -Qp * (1 - Qp/Qp_max) * C1 * (Vp_ - theta_p) / (sigma_p*sigma_p);
+
+    /* KNa activation and pump with respect to Na */
+    const double u		= math_pow_35(38.7/Na_);
+    const double w_KNa	= 0.37/(1+u);
+    const double dw_KNa	= 0.37 * 3.5 * u / (Na_ * (1+u) * (1+u));
+    const double dpump	= R_pump * 3 * Na_*Na_ * 3375 / ((Na_*Na_*Na_+3375) * (Na_*Na_*Na_+3375));
+
+    J[0*n+0]	= -(g_L + g_AMPA * sep + g_GABA * sgp)/tau_p - g_KNa * w_KNa;
+    J[0*n+2]	= -g_KNa * dw_KNa * (Vp_ - E_K);
+    J[0*n+3]	= -g_AMPA * (Vp_ - E_AMPA)/tau_p;
+    J[0*n+5]	= -g_GABA * (Vp_ - E_GABA)/tau_p;
+    J[1*n+1]	= -(g_L + g_AMPA * sei + g_GABA * sgi)/tau_i;
+    J[1*n+4]	= -g_AMPA * (Vi_ - E_AMPA)/tau_i;
+    J[1*n+6]	= -g_GABA * (Vi_ - E_GABA)/tau_i;
+    J[2*n+0]	= alpha_Na * dQp/tau_Na;
+    J[2*n+2]	= -dpump/tau_Na;
+    for (unsigned i=3; i < 7; ++i) {
+        J[i*n+i+4] = 1;
+    }
+    J[7*n+0]	= gamma_e*gamma_e * N_pp * dQp;
+    J[7*n+3]	= -gamma_e*gamma_e;
+    J[7*n+7]	= -2 * gamma_e;
+    J[8*n+0]	= gamma_e*gamma_e * N_ip * dQp;
+    J[8*n+4]	= -gamma_e*gamma_e;
+    J[8*n+8]	= -2 * gamma_e;
+    J[9*n+1]	= gamma_g*gamma_g * N_pi * dQi;
+    J[9*n+5]	= -gamma_g*gamma_g;
+    J[9*n+9]	= -2 * gamma_g;
+    J[10*n+1]	= gamma_g*gamma_g * N_ii * dQi;
+    J[10*n+6]	= -gamma_g*gamma_g;
+    J[10*n+10]	= -2 * gamma_g;
+
+    /* Parameters sigma_p, g_KNa and input */
+    J_par[2*3+0]	= alpha_Na * dQp_s/tau_Na;
+    J_par[7*3+0]	= gamma_e*gamma_e * N_pp * dQp_s;
+    J_par[8*3+0]	= gamma_e*gamma_e * N_ip * dQp_s;
+    J_par[0*3+1]	= -w_KNa * (Vp_ - E_K);
+    J_par[7*3+2]	= gamma_e*gamma_e / dt;
+    J_par[8*3+2]	= gamma_e*gamma_e / dt;
+}
@@ -0,0 +1,250 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ *
+ *	Based on:	Characterization of K-Complexes and Slow Wave Activity in a Neural Mass Model
+ *				A Weigenand, M Schellenberger Costa, H-VV Ngo, JC Claussen, T Martinetz
+ *				PLoS Computational Biology. 2014;10:e1003923
+ */
+
+/******************************************************************************/
+/*						Vector field of a cortical module					  */
+/*																			  */
+/*	The physiology of Cortical_Column independent of the integration scheme. */
+/*	Integrators (see SRK4.h) rely on the following description:				  */
+/*		numStates, State		fixed size state, ordered as in Variable	  */
+/*		initial					state in which a column starts				  */
+/*		operator()				noise free right hand side without input	  */
+/*		numNoise, noise_states	noise input m (and the stimulation) drives	  */
+/*		and noise_gain			the derivative of state noise_states[m]		  */
+/*								with the gain noise_gain[m]					  */
+/*																			  */
+/*	The right hand side itself is written once in derivatives, a template	  */
+/*	over the scalar type that is evaluated per column by operator() and per	  */
+/*	lane by the vectorized Cortical_Column_Batch.							  */
+/******************************************************************************/
+#pragma once
+#include <array>
+#include <cmath>
+
+#include "Math_Backend.h"
+
+struct Cortex_Model {
+    /* Parameters that differ between columns */
+    double	sigma_p;
+    double	g_KNa;
+
+    /* Description of the state */
+    enum Variable {
+        Vp,		/* excitatory membrane voltage						*/
+        Vi,		/* inhibitory membrane voltage						*/
+        Na,		/* Na concentration									*/
+        s_ep,	/* PostSP from excitatory to excitatory population	*/
+        s_ei,	/* PostSP from excitatory to inhibitory population	*/
+        s_gp,	/* PostSP from inhibitory to excitatory population	*/
+        s_gi,	/* PostSP from inhibitory to inhibitory population	*/
+        x_ep,	/* derivative of s_ep								*/
+        x_ei,	/* derivative of s_ei								*/
+        x_gp,	/* derivative of s_gp								*/
+        x_gi	/* derivative of s_gi								*/
+    };
+    static constexpr unsigned			numStates	= 11;
+    typedef std::array<double, numStates>	State;
+
+    /* Declaration and Initialization of parameters */
+    /* Membrane time in ms */
+    static constexpr double 	tau_p 		= 30;
+    static constexpr double 	tau_i 		= 30;
+
+    /* Maximum firing rate in ms^-1 */
+    static constexpr double 	Qp_max		= 30.E-3;
+    static constexpr double 	Qi_max		= 60.E-3;
+
+    /* Sigmoid threshold in mV */
+    static constexpr double 	theta_p		= -58.5;
+    static constexpr double 	theta_i		= -58.5;
+
+    /* Sigmoid gain in mV */
+    static constexpr double 	sigma_i		= 6;
+
+    /* Scaling parameter for sigmoidal mapping (dimensionless) */
+    static constexpr double 	C1          = (M_PI/sqrt(3));
+
+    /* Parameters of the firing adaption */
+    static constexpr double 	alpha_Na	= 2.;			/* Sodium influx per spike  in mM ms 	*/
+    static constexpr double 	tau_Na		= 1.;			/* Sodium time constant	    in ms 	*/
+
+    static constexpr double 	R_pump   	= 0.09;        	/* Na-K pump constant	    in mM/ms 	*/
+    static constexpr double 	Na_eq    	= 9.5;         	/* Na-eq concentration	    in mM 	*/
+
+    /* PSP rise time in ms^-1 */
+    static constexpr double 	gamma_e		= 70E-3;
+    static constexpr double 	gamma_g		= 58.6E-3;
+
+    /* Conductivities */
+    /* Leak  in aU*/
+    static constexpr double 	g_L    		= 1.;
+
+    /* Synaptic conductivity in ms */
+    static constexpr double 	g_AMPA 		= 1.;
+    static constexpr double 	g_GABA 		= 1.;
+
+    /* Reversal potentials in mV */
+    /* Synaptic */
+    static constexpr double 	E_AMPA  	= 0;
+    static constexpr double 	E_GABA  	= -70;
+
+    /* Leak */
+    static constexpr double 	E_L_p 		= -66;
+    static constexpr double 	E_L_i 		= -64;
+
+    /* Potassium */
+    static constexpr double 	E_K    		= -100;
+
+    /* Connectivities (dimensionless) */
+    static constexpr double 	N_pp		= 120;
+    static constexpr double 	N_ip		= 72;
+    static constexpr double 	N_pi		= 90;
+    static constexpr double 	N_ii		= 90;
+
+    /* Resting state */
+    static constexpr State		initial		= {{E_L_p, E_L_i, Na_eq, 0, 0, 0, 0, 0, 0, 0, 0}};
+
+    /* Noise drives the excitatory synapses */
+    static constexpr unsigned	numNoise	= 2;
+    static constexpr std::array<unsigned, numNoise>	noise_states	= {{x_ep, x_ei}};
+    static constexpr std::array<double, numNoise>	noise_gain		= {{gamma_e*gamma_e, gamma_e*gamma_e}};
+
+    /* Noise free right hand side without input */
+    void	operator()	(const double* y, double* dydt) const;
+
+    /* Firing rates in ms^-1, KNa activation and sodium dependent potassium
+     * current in mV/ms */
+    double			Qp		(const double* y) const;
+    static double	Qi		(const double* y);
+    static double	w_KNa	(const double* y);
+    double			I_KNa	(const double* y) const;
+
+    /* The state variables of a column as members, Na has the slow type S */
+    template <typename T, typename S = T>
+    struct Variables {
+        T	Vp, Vi;
+        S	Na;
+        T	s_ep, s_ei, s_gp, s_gi, x_ep, x_ei, x_gp, x_gi;
+    };
+
+    /* Noise free right hand side in the types T and S, given the firing rates
+     * Q_p and Q_i, the KNa activation w_KNa and the firing rate afferent that
+     * reaches s_ep and s_ei from other columns. The constants are rounded to
+     * T, except the ones of the sodium dynamics */
+    template <typename T, typename S>
+    static Variables<T, S>	derivatives	(const Variables<T, S>& y, T Q_p, T Q_i, T w_KNa,
+                                         T g_KNa, T afferent);
+
+    /* Right hand side for explicit parameters, with input in the units of
+     * Cortical_Column::set_input. Per SRK4 step the input adds gamma_e^2 *
+     * input to x_ep and x_ei, which is a rate of gamma_e^2 * input/dt */
+    static void	vector_field	(const double* y, double* dydt, double sigma_p, double g_KNa,
+                                 double input, double dt);
+
+    /* Analytic Jacobian of vector_field with respect to the state (row major,
+     * numStates x numStates) and to the parameters sigma_p, g_KNa and input
+     * (row major, numStates x 3) */
+    static void	jacobian		(const double* y, double* J, double* J_par, double sigma_p,
+                                 double g_KNa, double dt);
+};
+
+/******************************************************************************/
+/*							Function definitions							  */
+/******************************************************************************/
+inline double Cortex_Model::Qp(const double* y) const {
+    return Qp_max / (1 + math_exp(-C1 * (y[Vp] - theta_p) / sigma_p));
+}
+
+inline double Cortex_Model::Qi(const double* y) {
+    return Qi_max / (1 + math_exp(-C1 * (y[Vi] - theta_i) / sigma_i));
+}
+
+inline double Cortex_Model::w_KNa(const double* y) {
+    return 0.37/(1+math_pow_35(38.7/y[Na]));
+}
+
+inline double Cortex_Model::I_KNa(const double* y) const {
+    return g_KNa * w_KNa(y) * (y[Vp] - E_K);
+}
+
+template <typename T, typename S>
+inline Cortex_Model::Variables<T, S> Cortex_Model::derivatives(const Variables<T, S>& y, T Q_p, T Q_i,
+                                                               T w_KNa, T g_KNa, T afferent) {
+    /* Potassium pump */
+    const S pump_eq	= S(Na_eq)*S(Na_eq)*S(Na_eq)/(S(Na_eq)*S(Na_eq)*S(Na_eq)+3375);
+    const S pump	= S(R_pump)*(y.Na*y.Na*y.Na/(y.Na*y.Na*y.Na+3375) - pump_eq);
+
+    /* Currents */
+    const T I_L_p	= T(g_L) * (y.Vp - T(E_L_p));
+    const T I_ep	= T(g_AMPA) * y.s_ep * (y.Vp - T(E_AMPA));
+    const T I_gp	= T(g_GABA) * y.s_gp * (y.Vp - T(E_GABA));
+    const T I_KNa	= g_KNa * w_KNa * (y.Vp - T(E_K));
+    const T I_L_i	= T(g_L) * (y.Vi - T(E_L_i));
+    const T I_ei	= T(g_AMPA) * y.s_ei * (y.Vi - T(E_AMPA));
+    const T I_gi	= T(g_GABA) * y.s_gi * (y.Vi - T(E_GABA));
+
+    const T g_e = gamma_e, g_g = gamma_g;
+    Variables<T, S> dydt;
+    dydt.Vp		= -(I_L_p + I_ep + I_gp)/T(tau_p) - I_KNa;
+    dydt.Vi		= -(I_L_i + I_ei + I_gi)/T(tau_i);
+    dydt.Na		= (S(alpha_Na) * Q_p - pump)/S(tau_Na);
+    dydt.s_ep	= y.x_ep;
+    dydt.s_ei	= y.x_ei;
+    dydt.s_gp	= y.x_gp;
+    dydt.s_gi	= y.x_gi;
+    dydt.x_ep	= g_e*g_e * (T(N_pp) * Q_p + afferent - y.s_ep) - 2 * g_e * y.x_ep;
+    dydt.x_ei	= g_e*g_e * (T(N_ip) * Q_p + afferent - y.s_ei) - 2 * g_e * y.x_ei;
+    dydt.x_gp	= g_g*g_g * (T(N_pi) * Q_i - y.s_gp) - 2 * g_g * y.x_gp;
+    dydt.x_gi	= g_g*g_g * (T(N_ii) * Q_i - y.s_gi) - 2 * g_g * y.x_gi;
+    return dydt;
+}
+
+inline void Cortex_Model::operator() (const double* y, double* dydt) const {
+    const Variables<double> v = {y[Vp], y[Vi], y[Na], y[s_ep], y[s_ei], y[s_gp], y[s_gi],
+                                 y[x_ep], y[x_ei], y[x_gp], y[x_gi]};
+    const Variables<double> d = derivatives(v, Qp(y), Qi(y), w_KNa(y), g_KNa, 0.0);
+    dydt[Vp]	= d.Vp;
+    dydt[Vi]	= d.Vi;
+    dydt[Na]	= d.Na;
+    dydt[s_ep]	= d.s_ep;
+    dydt[s_ei]	= d.s_ei;
+    dydt[s_gp]	= d.s_gp;
+    dydt[s_gi]	= d.s_gi;
+    dydt[x_ep]	= d.x_ep;
+    dydt[x_ei]	= d.x_ei;
+    dydt[x_gp]	= d.x_gp;
+    dydt[x_gi]	= d.x_gi;
+}
+
+inline void Cortex_Model::vector_field(const double* y, double* dydt, double sigma_p, double g_KNa,
+                                       double input, double dt) {
+    Cortex_Model{sigma_p, g_KNa}(y, dydt);
+    for (unsigned m=0; m < numNoise; ++m) {
+        dydt[noise_states[m]] += noise_gain[m] * input / dt;
+    }
+}
@@ -0,0 +1,93 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+
+/******************************************************************************/
+/*							Native batch runner nm_cortex					  */
+/*																			  */
+/*	Runs all jobs of a job file (see Job_File.h) in one process without		  */
+/*	MATLAB. Usage:															  */
+/*		nm_cortex job_file output_directory [threads]						  */
+/*	The result of the n-th job (counting from 0) is written to				  */
+/*	output_directory/job_n.bin and can be read with read_result.m			  */
+/******************************************************************************/
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+
+#include "Instrumentation.h"
+#include "Job_File.h"
+#include "Parameter_Sweep.h"
+#include "Simulation_Settings.h"
+
+/******************************************************************************/
+/*                          Fixed simulation settings						  */
+/*				onset = 10 s, res = 1E4 steps per s, red = 1E2				  */
+/******************************************************************************/
+const Simulation_Settings Settings;
+
+int main(int argc, char* argv[]) {
+    if (argc < 3 || argc > 4) {
+        std::cerr << "usage: " << argv[0] << " job_file output_directory [threads]\n";
+        return 1;
+    }
+    const std::string output	= argv[2];
+    const unsigned threads		= argc == 4 ? std::atoi(argv[3]) : 0;
+
+    /* Read the jobs */
+    std::vector<Job_Entry> entries;
+    std::string error;
+    if (!read_job_file(argv[1], entries, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    std::vector<Sweep_Job> jobs;
+    jobs.reserve(entries.size());
+    for (auto& entry : entries) {
+        jobs.push_back(entry.job);
+    }
+
+    /* Results are written as soon as a job is finished */
+    std::mutex report;
+    unsigned failed = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    run_sweep(jobs, Settings, [&](unsigned job, Sweep_Result& result) {
+        const std::string path = output + "/job_" + std::to_string(job) + ".bin";
+        if (!write_job_result(path, entries[job], result)) {
+            std::lock_guard<std::mutex> guard(report);
+            std::cerr << "could not write " << path << "\n";
+            ++failed;
+        }
+    }, threads);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << jobs.size() - failed << " of " << jobs.size() << " jobs finished in "
+              << 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count()
+              << " s\n";
+#if INSTRUMENTATION
+    std::cout << Instrumentation::report();
+#endif
+    return failed == 0 ? 0 : 1;
+}
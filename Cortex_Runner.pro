@@ -0,0 +1,49 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+TARGET = nm_cortex
+
+SOURCES +=  Cortex_Runner.cpp   \
+			Cortex_Model.cpp    \
+			Cortical_Column.cpp \
+			Dormand_Prince.cpp  \
+			Job_File.cpp        \
+			Parameter_Sweep.cpp \
+			Spectral_Analysis.cpp \
+			Trace_Writer.cpp    \
+			Warm_Start.cpp
+
+HEADERS +=  Cortex_Model.h      \
+			Cortical_Column.h   \
+			Cortical_Column_Batch.h \
+			Data_Storage.h      \
+			Dormand_Prince.h    \
+			Event_Detection.h   \
+			Instrumentation.h   \
+			Job_File.h          \
+			Math_Backend.h      \
+			Parameter_Sweep.h   \
+			Probe.h             \
+			Random_Stream.h     \
+			Simulation_Settings.h \
+			Spectral_Analysis.h \
+			SPSC_Queue.h        \
+			SRK4.h              \
+			Stimulation.h       \
+			Trace_Writer.h      \
+			Warm_Start.h
+
+QMAKE_CXXFLAGS += -std=c++11 -pthread
+LIBS += -pthread
+QMAKE_CXXFLAGS_RELEASE -= -O1
+QMAKE_CXXFLAGS_RELEASE -= -O2
+QMAKE_CXXFLAGS_RELEASE *= -O3
+
+# Implementation of exp and pow, see Math_Backend.h
+# 0 == libm, 1 == polynomial (vectorized), 2 == table
+DEFINES += MATH_BACKEND=0
+
+# Cycle counters of the step loop, see Instrumentation.h
+DEFINES += INSTRUMENTATION=0
@@ -29,28 +29,53 @@
 /******************************************************************************/
 /* Implementation of the simulation as MATLAB routine (mex compiler)		  */
 /* mex command is given by:													  */
-/* mex CXXFLAGS="\$CXXFLAGS -std=c++11 -O3" Cortex_mex.cpp Cortical_Column.cpp*/
+/* mex CXXFLAGS="\$CXXFLAGS -std=c++11 -O3" Cortex_mex.cpp Column_Session.cpp Cortex_Model.cpp Cortical_Column.cpp Dormand_Prince.cpp Warm_Start.cpp */
+/* Add -DINSTRUMENTATION=1 for a summary of the step loop after every call  */
+/*																			  */
+/* Optional inputs: warm, the decorrelation time in s after a cached onset	  */
+/* (see Warm_Start.h), and a directory that keeps the cached states between */
+/* MATLAB sessions. The memory cache lives until "clear Cortex_mex"		  */
+/*																			  */
+/* Sessions keep a simulation between calls (see Column_Session.h):			  */
+/*	h = Cortex_mex('create', Param_Cortex, var_stim, seed, id)				  */
+/*	[Vp, Vi, s_ep, s_ei, s_gp, s_gi, marker] = Cortex_mex('advance', h, T)	  */
+/*	Cortex_mex('set_params', h, Param_Cortex)								  */
+/*	Cortex_mex('set_stim', h, var_stim)										  */
+/*	state = Cortex_mex('get_state', h)										  */
+/*	Cortex_mex('set_state', h, state)										  */
+/*	Cortex_mex('destroy', h), or Cortex_mex('destroy') for all sessions		  */
+/* seed and id are optional, the seed is random by default and is read	  */
+/* exactly when passed as uint64. The state contains the progress of the	  */
+/* stimulation protocol. The mex file is locked while sessions exist.		  */
 /******************************************************************************/
 #include "mex.h"
 #include "matrix.h"
 
+#include <algorithm>
 #include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
 #include <vector>
 
+#include "Column_Session.h"
 #include "Cortical_Column.h"
 #include "Data_Storage.h"
+#include "Dormand_Prince.h"
+#include "Instrumentation.h"
+#include "Simulation_Settings.h"
 #include "Stimulation.h"
+#include "Warm_Start.h"
 mxArray* SetMexArray(int N, int M);
 mxArray* get_marker(Stim &stim);
+void session_command(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
 
 /******************************************************************************/
 /*                          Fixed simulation settings						  */
+/*				onset = 10 s, res = 1E4 steps per s, red = 1E2				  */
 /******************************************************************************/
-extern const int onset	= 10;		/* Time until data is stored in  s		  */
-extern const int res 	= 1E4;		/* Number of iteration steps per s		  */
-extern const int red 	= 1E2;		/* Number of iterations steps not saved	  */
-extern const double dt 	= 1E3/res;	/* Duration of a time step in ms		  */
-extern const double h	= sqrt(dt); /* Square root of dt for SRK iteration	  */
+const Simulation_Settings Settings;
 
 /******************************************************************************/
 /*                              Simulation routine	 						  */
@@ -58,26 +83,56 @@ extern const double h	= sqrt(dt); /* Square root of dt for SRK iteration	  */
 /*								rhs defines inputs							  */
 /******************************************************************************/
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
-    /* Set the seed */
-    srand(time(NULL));
+    /* Commands of the sessions */
+    if (nrhs > 0 && mxIsChar(prhs[0])) {
+        session_command(nlhs, plhs, nrhs, prhs);
+        return;
+    }
+
+    /* Set the seed, calls within the same second get different ones */
+    srand(std::random_device()());
+
+#if INSTRUMENTATION
+    /* Only report the current call */
+    Instrumentation::reset();
+#endif
 
     /* Fetch inputs */
+    const int onset			= Settings.onset;
+    const int res			= Settings.res;
+    const int red			= Settings.red;
     const int T				= (int) (mxGetScalar(prhs[0]));	/* Duration of simulation in s 			*/
     const int Time 			= (T+onset)*res;				/* Total number of iteration steps 		*/
     double* Param_Cortex	= mxGetPr (prhs[1]);			/* Parameters of cortical module 		*/
     double* var_stim	 	= mxGetPr (prhs[2]);			/* Parameters of stimulation protocol 	*/
 
+    /* Optional warm start of this call */
+    Simulation_Settings Settings_warm = Settings;
+    Settings_warm.warm_start = nrhs > 3 ? mxGetScalar(prhs[3]) : -1;
+    if (nrhs > 4) {
+        char* directory = mxArrayToString(prhs[4]);
+        Warm_Start_Cache::shared().set_directory(directory);
+        mxFree(directory);
+    }
+
     /* Initialize the population */
-    Cortical_Column Cortex(Param_Cortex);
+    Cortical_Column Cortex(Param_Cortex, Settings);
 
     /* Initialize the stimulation protocol */
-    Stim Stimulation(Cortex, var_stim);
+    Stim Stimulation(Cortex, var_stim, Settings);
+
+    /* Skip the onset if a cached state can be used */
+    const int t_start = warm_start(Cortex, Settings_warm, rand());
+
+    /* Noise free columns are integrated adaptively */
+    const bool adaptive = Dormand_Prince::applicable(Cortex, Settings);
+    Dormand_Prince Solver(Cortex, Settings);
 
     /* Data container in MATLAB format */
     std::vector<mxArray*> dataArray;
     dataArray.reserve(6);
     dataArray.push_back(SetMexArray(1, T*res/red));	// Vp
-    dataArray.push_back(SetMexArray(1, T*res/red));	// Na
+    dataArray.push_back(SetMexArray(1, T*res/red));	// Vi
     dataArray.push_back(SetMexArray(1, T*res/red));	// s_ep
     dataArray.push_back(SetMexArray(1, T*res/red));	// s_ei
     dataArray.push_back(SetMexArray(1, T*res/red));	// s_gp
@@ -90,16 +145,19 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
         dataPointer.push_back(mxGetPr(dataptr));
     }
 
-    /* Simulation */
+    /* Simulation, the stimulation is only checked at its events */
     int count = 0;
-    for (unsigned t=0; t < Time; ++t) {
-        Cortex.iterate_ODE();
-        Stimulation.check_stim(t);
+    Stimulation.run(t_start, Time, [&](int t) {
+        if (adaptive) {
+            Solver.step();
+        } else {
+            Cortex.iterate_ODE();
+        }
         if(t >= onset*res && t%red == 0){
             get_data(count, Cortex, dataPointer);
             ++count;
         }
-    }
+    });
 
     /* Return the data containers */
     size_t numOutputs = 0;
@@ -107,6 +165,10 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
         plhs[numOutputs++] = dataptr;
     }
     plhs[numOutputs] = get_marker(Stimulation);
+
+#if INSTRUMENTATION
+    mexPrintf("%s", Instrumentation::report().c_str());
+#endif
     return;
 }
 
@@ -122,7 +184,7 @@ mxArray* SetMexArray(int N, int M) {
 }
 
 mxArray* get_marker(Stim &stim) {
-    extern const int red;
+    const int red = stim.Settings.red;
     mxArray* marker	= mxCreateDoubleMatrix(0, 0, mxREAL);
     mxSetM(marker, 1);
     mxSetN(marker, stim.marker_stimulation.size());
@@ -135,3 +197,256 @@ mxArray* get_marker(Stim &stim) {
     }
     return marker;
 }
+
+/******************************************************************************/
+/*								Sessions									  */
+/*	The handles are positive integers that are never reused within a MATLAB  */
+/*	session, so a stale handle is detected.									  */
+/******************************************************************************/
+static std::map<uint64_t, std::unique_ptr<Column_Session>> Sessions;
+static uint64_t next_handle = 1;
+
+static void clear_sessions(void) {
+    Sessions.clear();
+}
+
+/* Real double vector with [min, max] elements */
+static std::vector<double> get_vector(const mxArray* array, const char* name, size_t min, size_t max) {
+    const size_t n = mxGetNumberOfElements(array);
+    if (!mxIsDouble(array) || mxIsComplex(array) || n < min || n > max) {
+        if (min == max) {
+            mexErrMsgIdAndTxt("Cortex_mex:input", "%s needs %d real double values", name, (int) min);
+        } else {
+            mexErrMsgIdAndTxt("Cortex_mex:input", "%s needs at most %d real double values", name, (int) max);
+        }
+    }
+    const double* data = mxGetPr(array);
+    return std::vector<double>(data, data + n);
+}
+
+/* Parameters (sigma_p, g_KNa, dphi) and the stimulation protocol */
+static std::vector<double> get_param(const mxArray* array) {
+    return get_vector(array, "Param_Cortex", 3, 3);
+}
+
+static std::vector<double> get_stim(const mxArray* array) {
+    return get_vector(array, "var_stim", 0, 8);
+}
+
+static Column_Session& get_session(int nrhs, const mxArray *prhs[]) {
+    if (nrhs < 2) {
+        mexErrMsgIdAndTxt("Cortex_mex:handle", "Session handle missing");
+    }
+    auto it = Sessions.find((uint64_t) mxGetScalar(prhs[1]));
+    if (it == Sessions.end()) {
+        mexErrMsgIdAndTxt("Cortex_mex:handle", "Unknown session handle");
+    }
+    return *it->second;
+}
+
+/* The seed does not fit into a double, so it is stored as uint64 */
+static mxArray* get_uint64(uint64_t value) {
+    mxArray* array = mxCreateNumericMatrix(1, 1, mxUINT64_CLASS, mxREAL);
+    *(uint64_t*) mxGetData(array) = value;
+    return array;
+}
+
+template <typename Iterator>
+static mxArray* get_row(Iterator begin, Iterator end) {
+    mxArray* array = mxCreateDoubleMatrix(1, std::distance(begin, end), mxREAL);
+    std::copy(begin, end, mxGetPr(array));
+    return array;
+}
+
+static mxArray* get_state(const Stim::State& state) {
+    const char* fields[] = {"started", "minimum_found", "paused", "count", "time_to_stimuli", "time_off",
+                            "time_next_stimulus", "time_pause_end", "offsets", "crossed", "Vp_old",
+                            "minimum", "draws", "markers"};
+    mxArray* S = mxCreateStructMatrix(1, 1, 14, fields);
+    mxSetField(S, 0, "started",				mxCreateDoubleScalar(state.started));
+    mxSetField(S, 0, "minimum_found",		mxCreateDoubleScalar(state.minimum_found));
+    mxSetField(S, 0, "paused",				mxCreateDoubleScalar(state.paused));
+    mxSetField(S, 0, "count",				mxCreateDoubleScalar(state.count));
+    mxSetField(S, 0, "time_to_stimuli",		mxCreateDoubleScalar(state.time_to_stimuli));
+    mxSetField(S, 0, "time_off",			mxCreateDoubleScalar(state.time_off));
+    mxSetField(S, 0, "time_next_stimulus",	mxCreateDoubleScalar(state.time_next_stimulus));
+    mxSetField(S, 0, "time_pause_end",		mxCreateDoubleScalar(state.time_pause_end));
+    mxSetField(S, 0, "offsets",				get_row(state.offsets.begin(), state.offsets.end()));
+    mxSetField(S, 0, "crossed",				mxCreateDoubleScalar(state.crossed));
+    mxSetField(S, 0, "Vp_old",				mxCreateDoubleScalar(state.Vp_old));
+    mxSetField(S, 0, "minimum",				mxCreateDoubleScalar(state.minimum));
+    mxSetField(S, 0, "draws",				get_uint64(state.draws));
+    mxSetField(S, 0, "markers",				get_row(state.markers.begin(), state.markers.end()));
+    return S;
+}
+
+static mxArray* get_state(const Column_Session::State& state) {
+    const char* fields[] = {"y", "input", "seed", "id", "position", "noise_count", "rand_vars", "time",
+                            "param", "var_stim", "stimulation", "reported", "started"};
+    mxArray* S = mxCreateStructMatrix(1, 1, 13, fields);
+    mxSetField(S, 0, "y",			get_row(state.column.y.begin(), state.column.y.end()));
+    mxSetField(S, 0, "input",		mxCreateDoubleScalar(state.column.input));
+    mxSetField(S, 0, "seed",		get_uint64(state.column.seed));
+    mxSetField(S, 0, "id",			mxCreateDoubleScalar(state.column.id));
+    mxSetField(S, 0, "position",	get_uint64(state.column.position));
+    mxSetField(S, 0, "noise_count",	mxCreateDoubleScalar(state.column.Noise_count));
+    mxSetField(S, 0, "rand_vars",	get_row(state.column.Rand_vars.begin(), state.column.Rand_vars.end()));
+    mxSetField(S, 0, "time",		mxCreateDoubleScalar(state.time));
+    mxSetField(S, 0, "param",		get_row(state.Param_Cortex.begin(), state.Param_Cortex.end()));
+    mxSetField(S, 0, "var_stim",	get_row(state.var_stim.begin(), state.var_stim.end()));
+    mxSetField(S, 0, "stimulation",	get_state(state.stimulation));
+    mxSetField(S, 0, "reported",	mxCreateDoubleScalar(state.reported));
+    mxSetField(S, 0, "started",		mxCreateDoubleScalar(state.started));
+    return S;
+}
+
+/* Field of a state struct with the given class and number of elements, a
+ * number of 0 accepts any */
+static const mxArray* get_field(const mxArray* S, const char* name, mxClassID type, size_t n) {
+    const mxArray* F = mxIsStruct(S) ? mxGetField(S, 0, name) : nullptr;
+    if (!F || mxGetClassID(F) != type || (n && mxGetNumberOfElements(F) != n)) {
+        mexErrMsgIdAndTxt("Cortex_mex:state", "Invalid field %s of the state", name);
+    }
+    return F;
+}
+
+static Stim::State set_stim_state(const mxArray* S) {
+    auto scalar = [S](const char* name) {
+        return mxGetScalar(get_field(S, name, mxDOUBLE_CLASS, 1));
+    };
+    Stim::State state;
+    state.started				= scalar("started") != 0;
+    state.minimum_found			= scalar("minimum_found") != 0;
+    state.paused				= scalar("paused") != 0;
+    state.count					= (int) scalar("count");
+    state.time_to_stimuli		= (int) scalar("time_to_stimuli");
+    state.time_off				= (int) scalar("time_off");
+    state.time_next_stimulus	= (int) scalar("time_next_stimulus");
+    state.time_pause_end		= (int) scalar("time_pause_end");
+    const double* offsets		= mxGetPr(get_field(S, "offsets", mxDOUBLE_CLASS, state.offsets.size()));
+    std::copy(offsets, offsets + state.offsets.size(), state.offsets.begin());
+    state.crossed				= scalar("crossed") != 0;
+    state.Vp_old				= scalar("Vp_old");
+    state.minimum				= scalar("minimum");
+    state.draws					= *(uint64_t*) mxGetData(get_field(S, "draws", mxUINT64_CLASS, 1));
+    const mxArray* markers		= get_field(S, "markers", mxDOUBLE_CLASS, 0);
+    state.markers.assign(mxGetPr(markers), mxGetPr(markers) + mxGetNumberOfElements(markers));
+    return state;
+}
+
+static Column_Session::State set_state(const mxArray* S) {
+    auto field = [S](const char* name, mxClassID type, size_t n) {
+        return get_field(S, name, type, n);
+    };
+    Column_Session::State state;
+    const double* y		= mxGetPr(field("y", mxDOUBLE_CLASS, state.column.y.size()));
+    const double* rand	= mxGetPr(field("rand_vars", mxDOUBLE_CLASS, state.column.Rand_vars.size()));
+    std::copy(y, y + state.column.y.size(), state.column.y.begin());
+    std::copy(rand, rand + state.column.Rand_vars.size(), state.column.Rand_vars.begin());
+    state.column.input		 = mxGetScalar(field("input", mxDOUBLE_CLASS, 1));
+    state.column.seed		 = *(uint64_t*) mxGetData(field("seed", mxUINT64_CLASS, 1));
+    state.column.id			 = (uint32_t) mxGetScalar(field("id", mxDOUBLE_CLASS, 1));
+    state.column.position	 = *(uint64_t*) mxGetData(field("position", mxUINT64_CLASS, 1));
+    state.column.Noise_count = (unsigned) mxGetScalar(field("noise_count", mxDOUBLE_CLASS, 1));
+    state.time				 = (int) mxGetScalar(field("time", mxDOUBLE_CLASS, 1));
+    state.Param_Cortex		 = get_param(field("param", mxDOUBLE_CLASS, 3));
+    state.var_stim			 = get_stim(field("var_stim", mxDOUBLE_CLASS, 0));
+    state.stimulation		 = set_stim_state(field("stimulation", mxSTRUCT_CLASS, 1));
+    state.reported			 = (unsigned) mxGetScalar(field("reported", mxDOUBLE_CLASS, 1));
+    state.started			 = mxGetScalar(field("started", mxDOUBLE_CLASS, 1)) != 0;
+    if (state.column.Noise_count < 1 || state.column.Noise_count > Cortical_Column::Noise_block
+        || state.column.position < Cortical_Column::Noise_block) {
+        mexErrMsgIdAndTxt("Cortex_mex:state", "Invalid noise position of the state");
+    }
+    if (state.reported > state.stimulation.markers.size()) {
+        mexErrMsgIdAndTxt("Cortex_mex:state", "More markers are reported than stored in the state");
+    }
+    return state;
+}
+
+void session_command(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+    char* name = mxArrayToString(prhs[0]);
+    const std::string command = name;
+    mxFree(name);
+
+    if (command == "create") {
+        if (nrhs < 3) {
+            mexErrMsgIdAndTxt("Cortex_mex:create", "Parameters and stimulation protocol missing");
+        }
+        /* Seeds above 2^53 have to be passed as uint64 */
+        uint64_t seed = ((uint64_t) std::random_device()() << 32) | std::random_device()();
+        if (nrhs > 3) {
+            seed = mxIsUint64(prhs[3]) ? *(uint64_t*) mxGetData(prhs[3]) : (uint64_t) mxGetScalar(prhs[3]);
+        }
+        const uint32_t id	= nrhs > 4 ? (uint32_t) mxGetScalar(prhs[4]) : 0;
+
+        /* Inputs are checked before the mex file is locked */
+        const std::vector<double> Param_Cortex	= get_param(prhs[1]);
+        const std::vector<double> var_stim		= get_stim(prhs[2]);
+        if (Sessions.empty()) {
+            mexLock();
+            mexAtExit(clear_sessions);
+        }
+        const uint64_t handle = next_handle++;
+        Sessions[handle].reset(new Column_Session(Param_Cortex, var_stim, seed, id, Settings));
+        plhs[0] = mxCreateDoubleScalar(handle);
+    } else if (command == "advance") {
+        Column_Session& Session = get_session(nrhs, prhs);
+        const double T = nrhs > 2 ? mxGetScalar(prhs[2]) : 1;
+
+#if INSTRUMENTATION
+        Instrumentation::reset();
+#endif
+        /* The samples are written directly into the outputs */
+        std::vector<mxArray*> dataArray;
+        std::vector<double*> dataPointer;
+        for (unsigned i=0; i < 6; ++i) {
+            dataArray.push_back(SetMexArray(1, Session.samples(T)));
+            dataPointer.push_back(mxGetPr(dataArray.back()));
+        }
+        const std::vector<double> marker = Session.advance(T, dataPointer);
+        for (unsigned i=0; i < 6; ++i) {
+            if ((int) i < std::max(nlhs, 1)) {
+                plhs[i] = dataArray[i];
+            } else {
+                mxDestroyArray(dataArray[i]);
+            }
+        }
+        if (nlhs > 6) {
+            plhs[6] = mxCreateDoubleMatrix(1, marker.size(), mxREAL);
+            std::copy(marker.begin(), marker.end(), mxGetPr(plhs[6]));
+        }
+#if INSTRUMENTATION
+        mexPrintf("%s", Instrumentation::report().c_str());
+#endif
+    } else if (command == "set_params") {
+        if (nrhs < 3) {
+            mexErrMsgIdAndTxt("Cortex_mex:set_params", "Parameters missing");
+        }
+        get_session(nrhs, prhs).set_parameters(get_param(prhs[2]));
+    } else if (command == "set_stim") {
+        if (nrhs < 3) {
+            mexErrMsgIdAndTxt("Cortex_mex:set_stim", "Stimulation protocol missing");
+        }
+        get_session(nrhs, prhs).set_stimulation(get_stim(prhs[2]));
+    } else if (command == "get_state") {
+        plhs[0] = get_state(get_session(nrhs, prhs).get_state());
+    } else if (command == "set_state") {
+        if (nrhs < 3) {
+            mexErrMsgIdAndTxt("Cortex_mex:set_state", "State missing");
+        }
+        get_session(nrhs, prhs).set_state(set_state(prhs[2]));
+    } else if (command == "destroy") {
+        if (nrhs > 1) {
+            get_session(nrhs, prhs);
+            Sessions.erase((uint64_t) mxGetScalar(prhs[1]));
+        } else {
+            Sessions.clear();
+        }
+        if (Sessions.empty() && mexIsLocked()) {
+            mexUnlock();
+        }
+    } else {
+        mexErrMsgIdAndTxt("Cortex_mex:command", "Unknown command %s", command.c_str());
+    }
+}
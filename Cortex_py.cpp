@@ -0,0 +1,305 @@
+/*
+ *	Copyright (c) 2014 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ *
+ *	Based on:	Characterization of K-Complexes and Slow Wave Activity in a Neural Mass Model
+ *				A Weigenand, M Schellenberger Costa, H-VV Ngo, JC Claussen, T Martinetz
+ *				PLoS Computational Biology. 2014;10:e1003923
+ */
+
+/******************************************************************************/
+/* Implementation of the simulation as Python module (CPython + NumPy)		  */
+/* Build with: python setup.py build_ext --inplace							  */
+/*																			  */
+/*	import nm_cortex														  */
+/*	Vp, Vi, s_ep, s_ei, s_gp, s_gi, marker = nm_cortex.simulate(T, Param, var)*/
+/*																			  */
+/* The outputs are the same as the ones of Cortex_mex. The arrays use the	  */
+/* buffers the simulation wrote into, which are freed together with the last */
+/* array referencing them. The GIL is released during the simulation, so	  */
+/* that several simulations run in parallel from a Python thread pool.		  */
+/******************************************************************************/
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <numpy/arrayobject.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "Parameter_Sweep.h"
+#include "Simulation_Settings.h"
+
+/******************************************************************************/
+/*                          Fixed simulation settings						  */
+/*				onset = 10 s, res = 1E4 steps per s, red = 1E2				  */
+/******************************************************************************/
+const Simulation_Settings Settings;
+
+/******************************************************************************/
+/*							Arrays owning the results						  */
+/******************************************************************************/
+static void free_buffer(PyObject* capsule) {
+    delete static_cast<std::vector<double>*>(PyCapsule_GetPointer(capsule, "nm_cortex.buffer"));
+}
+
+/* 1 x N array pointing into buffer, the capsule keeps the buffer alive */
+static PyObject* view_array(double* data, npy_intp N, PyObject* capsule) {
+    npy_intp dims[2] = {1, N};
+    PyObject* array = PyArray_SimpleNewFromData(2, dims, NPY_DOUBLE, data);
+    if (!array) {
+        return nullptr;
+    }
+    Py_INCREF(capsule);
+    if (PyArray_SetBaseObject((PyArrayObject*) array, capsule) < 0) {
+        Py_DECREF(array);
+        return nullptr;
+    }
+    return array;
+}
+
+/* Hands the buffers of a result to Python, result is empty afterwards.
+ * Returns the tuple (Vp, Vi, s_ep, s_ei, s_gp, s_gi, marker) */
+static PyObject* to_tuple(Sweep_Result& result) {
+    const npy_intp samples = result.data.size()/6;
+    const npy_intp markers = result.marker.size();
+    auto data	= new std::vector<double>(std::move(result.data));
+    auto marker	= new std::vector<double>(std::move(result.marker));
+
+    PyObject* data_capsule	 = PyCapsule_New(data,	 "nm_cortex.buffer", free_buffer);
+    PyObject* marker_capsule = PyCapsule_New(marker, "nm_cortex.buffer", free_buffer);
+    if (!data_capsule || !marker_capsule) {
+        if (data_capsule) { Py_DECREF(data_capsule); } else { delete data; }
+        if (marker_capsule) { Py_DECREF(marker_capsule); } else { delete marker; }
+        return nullptr;
+    }
+
+    PyObject* tuple = PyTuple_New(7);
+    for (unsigned i=0; tuple && i < 7; ++i) {
+        PyObject* array = i < 6 ? view_array(data->data() + i*samples, samples, data_capsule)
+                                : view_array(marker->data(), markers, marker_capsule);
+        if (!array) {
+            Py_CLEAR(tuple);
+            break;
+        }
+        PyTuple_SET_ITEM(tuple, i, array);
+    }
+    Py_DECREF(data_capsule);
+    Py_DECREF(marker_capsule);
+    return tuple;
+}
+
+/******************************************************************************/
+/*								Input conversion							  */
+/******************************************************************************/
+/* Reads an array of doubles with rows of the given length. Returns the number
+ * of rows or -1 with a Python exception set */
+static npy_intp get_rows(PyObject* object, npy_intp length, const char* name,
+                         std::vector<double>& values) {
+    PyArrayObject* array = (PyArrayObject*) PyArray_FROMANY(object, NPY_DOUBLE, 1, 2,
+                                                            NPY_ARRAY_IN_ARRAY);
+    if (!array) {
+        return -1;
+    }
+    const npy_intp size = PyArray_SIZE(array);
+    const npy_intp last = PyArray_DIM(array, PyArray_NDIM(array)-1);
+    if (last != length) {
+        PyErr_Format(PyExc_ValueError, "%s needs %d values per row", name, (int) length);
+        Py_DECREF(array);
+        return -1;
+    }
+    const double* data = (const double*) PyArray_DATA(array);
+    values.assign(data, data + size);
+    Py_DECREF(array);
+    return size/length;
+}
+
+static uint64_t get_seed(PyObject* seed) {
+    if (seed == nullptr || seed == Py_None) {
+        std::random_device device;
+        return (uint64_t(device()) << 32) | device();
+    }
+    return PyLong_AsUnsignedLongLong(seed);
+}
+
+/******************************************************************************/
+/*								Module functions							  */
+/******************************************************************************/
+static PyObject* simulate(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"T", "Param", "var_stim", "seed", "warm", nullptr};
+    int T;
+    PyObject *param, *stim, *seed_object = nullptr;
+    Simulation_Settings Settings_warm = Settings;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "iOO|Od", const_cast<char**>(keywords),
+                                     &T, &param, &stim, &seed_object, &Settings_warm.warm_start)) {
+        return nullptr;
+    }
+
+    Sweep_Job job;
+    job.T	= T;
+    job.id	= 0;
+    if (T <= 0) {
+        PyErr_SetString(PyExc_ValueError, "T has to be positive");
+        return nullptr;
+    }
+    if (get_rows(param, 3, "Param", job.Param_Cortex) != 1 ||
+        get_rows(stim,  8, "var_stim", job.var_stim) != 1) {
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_ValueError, "simulate takes a single parameter set");
+        }
+        return nullptr;
+    }
+    job.seed = get_seed(seed_object);
+    if (PyErr_Occurred()) {
+        return nullptr;
+    }
+
+    Sweep_Result result;
+    result.data.resize(6 * T*Settings.res/Settings.red);
+    Py_BEGIN_ALLOW_THREADS
+    run_simulation(job, Settings_warm, result);
+    Py_END_ALLOW_THREADS
+    return to_tuple(result);
+}
+
+static PyObject* simulate_batch(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"T", "Param", "var_stim", "seed", "threads", "warm", nullptr};
+    int T;
+    unsigned threads = 0;
+    PyObject *param, *stim, *seed_object = nullptr;
+    Simulation_Settings Settings_warm = Settings;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "iOO|OId", const_cast<char**>(keywords),
+                                     &T, &param, &stim, &seed_object, &threads,
+                                     &Settings_warm.warm_start)) {
+        return nullptr;
+    }
+    if (T <= 0) {
+        PyErr_SetString(PyExc_ValueError, "T has to be positive");
+        return nullptr;
+    }
+
+    /* Every row of Param is simulated with the matching row of var_stim or
+     * with the only row of it */
+    std::vector<double> Params, Stims;
+    const npy_intp numParams = get_rows(param, 3, "Param", Params);
+    if (numParams < 0) {
+        return nullptr;
+    }
+    const npy_intp numStims = get_rows(stim, 8, "var_stim", Stims);
+    if (numStims < 0) {
+        return nullptr;
+    }
+    if (numStims != 1 && numStims != numParams) {
+        PyErr_SetString(PyExc_ValueError, "var_stim needs one row or one row per parameter set");
+        return nullptr;
+    }
+    const uint64_t seed = get_seed(seed_object);
+    if (PyErr_Occurred()) {
+        return nullptr;
+    }
+
+    /* All jobs share the seed but have different noise streams */
+    std::vector<Sweep_Job> jobs(numParams);
+    for (npy_intp i=0; i < numParams; ++i) {
+        const npy_intp s = numStims == 1 ? 0 : i;
+        jobs[i] = Sweep_Job{T, std::vector<double>(&Params[3*i], &Params[3*i+3]),
+                            std::vector<double>(&Stims[8*s], &Stims[8*s+8]), seed, (uint32_t) i};
+    }
+
+    std::vector<Sweep_Result> results;
+    Py_BEGIN_ALLOW_THREADS
+    results = run_sweep(jobs, Settings_warm, threads);
+    Py_END_ALLOW_THREADS
+
+    PyObject* list = PyList_New(numParams);
+    for (npy_intp i=0; list && i < numParams; ++i) {
+        PyObject* tuple = to_tuple(results[i]);
+        if (!tuple) {
+            Py_CLEAR(list);
+            break;
+        }
+        PyList_SET_ITEM(list, i, tuple);
+    }
+    return list;
+}
+
+/* Time of n simulations in C++ without any Python in between, used by
+ * benchmark_python.py to measure the overhead of the module */
+static PyObject* native_time(PyObject*, PyObject* args) {
+    int T, n;
+    PyObject *param, *stim;
+    if (!PyArg_ParseTuple(args, "iOOi", &T, &param, &stim, &n)) {
+        return nullptr;
+    }
+    Sweep_Job job{T, {}, {}, 1, 0};
+    if (T <= 0 ||
+        get_rows(param, 3, "Param", job.Param_Cortex) != 1 ||
+        get_rows(stim,  8, "var_stim", job.var_stim) != 1) {
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_ValueError, "invalid arguments");
+        }
+        return nullptr;
+    }
+
+    double elapsed;
+    Py_BEGIN_ALLOW_THREADS
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i=0; i < n; ++i) {
+        Sweep_Result result;
+        result.data.resize(6 * T*Settings.res/Settings.red);
+        run_simulation(job, Settings, result);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    elapsed = 1E-6*std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count();
+    Py_END_ALLOW_THREADS
+    return PyFloat_FromDouble(elapsed);
+}
+
+static PyMethodDef methods[] = {
+    {"simulate", (PyCFunction) simulate, METH_VARARGS | METH_KEYWORDS,
+     "simulate(T, Param, var_stim, seed=None, warm=-1)\n\n"
+     "Simulates T seconds of a cortical column with the 3 parameters Param and the 8\n"
+     "stimulation values var_stim. Returns (Vp, Vi, s_ep, s_ei, s_gp, s_gi, marker).\n"
+     "With warm >= 0 the onset starts from a cached state and only warm seconds are\n"
+     "simulated to decorrelate the noise."},
+    {"simulate_batch", (PyCFunction) simulate_batch, METH_VARARGS | METH_KEYWORDS,
+     "simulate_batch(T, Param, var_stim, seed=None, threads=0, warm=-1)\n\n"
+     "Simulates every row of the n x 3 array Param with the matching row of var_stim\n"
+     "(n x 8 or a single row) on threads threads (0 == all cores). Returns a list\n"
+     "with the outputs of simulate for every row."},
+    {"native_time", native_time, METH_VARARGS,
+     "native_time(T, Param, var_stim, n)\n\n"
+     "Time in s of n simulations in C++, for overhead measurements."},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static struct PyModuleDef module = {
+    PyModuleDef_HEAD_INIT, "nm_cortex",
+    "Neural mass model of the cortex (Weigenand et al. 2014)", -1, methods,
+    nullptr, nullptr, nullptr, nullptr
+};
+
+PyMODINIT_FUNC PyInit_nm_cortex(void) {
+    import_array();
+    return PyModule_Create(&module);
+}
@@ -29,143 +29,120 @@
 /******************************************************************************/
 /*							Functions of the cortical module				  */
 /******************************************************************************/
+#include <algorithm>
+
 #include "Cortical_Column.h"
+#include "Instrumentation.h"
 
-// std::array needs to be defined here
-constexpr std::array<double,4> Cortical_Column::A;
-constexpr std::array<double,4> Cortical_Column::B;
+// constexpr members need to be defined here
+constexpr unsigned Cortical_Column::Noise_block;
+constexpr unsigned Cortical_Column::numStates;
 
 /******************************************************************************/
 /*							Initialization of RNG 							  */
 /******************************************************************************/
-void Cortical_Column::set_RNG(void) {
-    extern const double dt;
-    unsigned numRandomVariables = 2;
+void Cortical_Column::set_RNG(uint64_t seed, uint32_t id) {
+    unsigned numRandomVariables = Cortex_Model::numNoise;
 
-    MTRands.reserve(2*numRandomVariables);
-    Rand_vars.reserve(2*numRandomVariables);
+    Streams.reserve(2*numRandomVariables);
     for (unsigned i=0; i < numRandomVariables; ++i){
         /* Add the RNG for I_{l}*/
-        MTRands.emplace_back(0.0, dphi*dt);
+        Streams.emplace_back(seed, id, 2*i);
+        Noise_std[2*i]		= dphi*dt;
 
         /* Add the RNG for I_{l,0} */
-        MTRands.emplace_back(0.0, dt);
-
-        /* Get the random number for the first iteration */
-        Rand_vars.push_back(MTRands[2*i]());
-        Rand_vars.push_back(MTRands[2*i+1]());
+        Streams.emplace_back(seed, id, 2*i+1);
+        Noise_std[2*i+1]	= dt;
     }
-}
-
-/******************************************************************************/
-/*                          RK noise scaling 								  */
-/******************************************************************************/
-double Cortical_Column::noise_xRK(int N, int M) const{
-    return gamma_e * gamma_e * (Rand_vars[2*M] + Rand_vars[2*M+1]/std::sqrt(3))*B[N];
-}
 
-double Cortical_Column::noise_aRK(int M) const{
-    return gamma_e * gamma_e * (Rand_vars[2*M] - Rand_vars[2*M+1]*std::sqrt(3))/4;
-}
-
-/******************************************************************************/
-/*                          Firing Rate functions 							  */
-/******************************************************************************/
-double Cortical_Column::get_Qp	(int N) const{
-    return Qp_max / (1 + exp(-C1 * (Vp[N] - theta_p) / sigma_p));
+    /* Get the random number for the first iteration */
+    fill_noise();
+    for (unsigned i=0; i < Rand_vars.size(); ++i) {
+        Rand_vars[i] = Noise[i*Noise_block] * Noise_std[i];
+    }
+    Noise_count = 1;
 }
 
-double Cortical_Column::get_Qi	(int N) const{
-    return Qi_max / (1 + exp(-C1 * (Vi[N] - theta_i) / sigma_i));
+void Cortical_Column::fill_noise(void) {
+    for (unsigned i=0; i < Streams.size(); ++i) {
+        Streams[i].fill(&Noise[i*Noise_block], Noise_block);
+    }
+    Noise_count = 0;
 }
 
 /******************************************************************************/
-/*							Synaptic currents								  */
+/*								Checkpointing								  */
 /******************************************************************************/
-/* Excitatory input to pyramidal population */
-double Cortical_Column::I_ep (int N) const{
-    return g_AMPA * s_ep[N] * (Vp[N] - E_AMPA);
-}
-
-/* Inhibitory input to pyramidal population */
-double Cortical_Column::I_gp (int N) const{
-    return g_GABA * s_gp[N] * (Vp[N] - E_GABA);
-}
-/* Excitatory input to inhibitory population */
-double Cortical_Column::I_ei (int N) const{
-    return g_AMPA * s_ei[N] * (Vi[N] - E_AMPA);
+Cortical_Column::State Cortical_Column::get_state(void) const {
+    State state;
+    state.y				= Stepper.state();
+    state.input			= input;
+    state.seed			= Streams[0].seed();
+    state.id			= Streams[0].id();
+    state.position		= Streams[0].position();
+    state.Noise_count	= Noise_count;
+    state.Rand_vars		= Rand_vars;
+    return state;
 }
 
-/* Inhibitory input to inhibitory population */
-double Cortical_Column::I_gi (int N) const{
-    return g_GABA * s_gi[N] * (Vi[N] - E_GABA);
-}
+void Cortical_Column::set_state(const State& state) {
+    Stepper.state() = state.y;
+    input = state.input;
 
-/******************************************************************************/
-/*							Intrinsic currents                                */
-/******************************************************************************/
-/* Leak current of pyramidal population */
-double Cortical_Column::I_L_p (int N) const{
-    return g_L * (Vp[N] - E_L_p);
+    /* All streams are at the same position, the last block is drawn again */
+    reseed(state.seed, state.id);
+    for (auto& stream : Streams) {
+        stream.seek(state.position - Noise_block);
+    }
+    fill_noise();
+    Noise_count = state.Noise_count;
+    Rand_vars	= state.Rand_vars;
 }
 
-/* Leak current of inhibitory population */
-double Cortical_Column::I_L_i (int N) const{
-    return g_L * (Vi[N] - E_L_i);
+void Cortical_Column::reseed(uint64_t seed, uint32_t id) {
+    Streams.clear();
+    set_RNG(seed, id);
 }
 
-/* Sodium dependent potassium current */
-double Cortical_Column::I_KNa (int N)  const{
-    double w_KNa  = 0.37/(1+pow(38.7/Na[N], 3.5));
-    return g_KNa * w_KNa * (Vp[N] - E_K);
-}
+void Cortical_Column::set_parameters(const double* Par) {
+    const State state = get_state();
+    const std::array<double, numRandom> Noise_std_old = Noise_std;
+    Model	= Cortex_Model {Par[0], Par[1]};
+    dphi	= Par[2];
+    set_state(state);
 
-/******************************************************************************/
-/*							Potassium pump	 								  */
-/******************************************************************************/
-double Cortical_Column::Na_pump (int N) const{
-    return R_pump*(Na[N]*Na[N]*Na[N]/(Na[N]*Na[N]*Na[N]+3375) -
-                   Na_eq*Na_eq*Na_eq/(Na_eq*Na_eq*Na_eq+3375));
+    /* The noise of the next iteration with the new standard deviation */
+    for (unsigned i=0; i < Rand_vars.size(); ++i) {
+        Rand_vars[i] += Noise[i*Noise_block + Noise_count - 1] * (Noise_std[i] - Noise_std_old[i]);
+    }
 }
 
 /******************************************************************************/
 /*                              SRK iteration                                 */
 /******************************************************************************/
 void Cortical_Column::set_RK (int N) {
-    extern const double dt;
-    Vp	[N+1] = Vp  [0] + A[N] * dt*(-(I_L_p(N) + I_ep(N) + I_gp(N))/tau_p - I_KNa(N));
-    Vi	[N+1] = Vi  [0] + A[N] * dt*(-(I_L_i(N) + I_ei(N) + I_gi(N))/tau_i);
-    Na	[N+1] = Na  [0] + A[N] * dt*(alpha_Na * get_Qp(N) - Na_pump(N))/tau_Na;
-    s_ep[N+1] = s_ep[0] + A[N] * dt*(x_ep[N]);
-    s_ei[N+1] = s_ei[0] + A[N] * dt*(x_ei[N]);
-    s_gp[N+1] = s_gp[0] + A[N] * dt*(x_gp[N]);
-    s_gi[N+1] = s_gi[0] + A[N] * dt*(x_gi[N]);
-    x_ep[N+1] = x_ep[0] + A[N] * dt*(gamma_e*gamma_e * (N_pp * get_Qp(N) - s_ep[N]) - 2 * gamma_e * x_ep[N]) + noise_xRK(N, 0);
-    x_ei[N+1] = x_ei[0] + A[N] * dt*(gamma_e*gamma_e * (N_ip * get_Qp(N) - s_ei[N]) - 2 * gamma_e * x_ei[N]) + noise_xRK(N, 1)	;
-    x_gp[N+1] = x_gp[0] + A[N] * dt*(gamma_g*gamma_g * (N_pi * get_Qi(N) - s_gp[N]) - 2 * gamma_g * x_gp[N]);
-    x_gi[N+1] = x_gi[0] + A[N] * dt*(gamma_g*gamma_g * (N_ii * get_Qi(N) - s_gi[N]) - 2 * gamma_g * x_gi[N]);
+    INSTRUMENT_SCOPE(Instrumentation::SET_RK_0 + N);
+    Stepper.stage(Model, N, dt, Rand_vars.data());
 }
 
 void Cortical_Column::add_RK(void) {
-    add_RK(Vp);
-    add_RK(Vi);
-    add_RK(Na);
-    add_RK(s_ep);
-    add_RK(s_ei);
-    add_RK(s_gp);
-    add_RK(s_gi);
-    add_RK_noise(x_ep, 0);
-    add_RK_noise(x_ei, 1);
-    add_RK(x_gp);
-    add_RK(x_gi);
+    INSTRUMENT_SCOPE(Instrumentation::ADD_RK);
+    Stepper.combine(Rand_vars.data());
 
     /* Generate noise for the next iteration */
+    if (Noise_count == Noise_block) {
+        INSTRUMENT_SCOPE(Instrumentation::NOISE);
+        fill_noise();
+    }
     for (unsigned i=0; i<Rand_vars.size(); ++i) {
-        Rand_vars[i] = MTRands[i]() + input;
+        Rand_vars[i] = Noise[i*Noise_block + Noise_count] * Noise_std[i] + input;
     }
+    ++Noise_count;
 }
 
 void Cortical_Column::iterate_ODE(void) {
+    INSTRUMENT_SCOPE(Instrumentation::STEP);
+
     /* First calculating every ith RK moment. This has to be in order, 1th
      * moment first
      */
@@ -174,3 +151,11 @@ void Cortical_Column::iterate_ODE(void) {
     }
     add_RK();
 }
+
+/******************************************************************************/
+/*                          Deterministic vector field                        */
+/******************************************************************************/
+/* Same equations as the SRK4 stages without noise */
+void Cortical_Column::derivatives(const double* y, double* dydt) const {
+    Cortex_Model::vector_field(y, dydt, Model.sigma_p, Model.g_KNa, input, dt);
+}
@@ -32,153 +32,115 @@
 #pragma once
 #include <array>
 #include <cmath>
+#include <cstdint>
+#include <cstdlib>
 #include <vector>
 
+#include "Cortex_Model.h"
 #include "Random_Stream.h"
+#include "SRK4.h"
+#include "Simulation_Settings.h"
+
+class Dormand_Prince;
+class Trace_Writer;
 
 class Cortical_Column {
 public:
-    Cortical_Column(double* Par)
-    : sigma_p (Par[0])
-    , g_KNa (Par[1])
+    /* The noise is determined by the global seed and the id of the column */
+    Cortical_Column(double* Par, const Simulation_Settings& Settings = Simulation_Settings(),
+                    uint64_t seed = rand(), uint32_t id = 0)
+    : Model {Par[0], Par[1]}
     , dphi (Par[2])
+    , dt (Settings.dt)
     {
-        set_RNG();
+        set_RNG(seed, id);
     }
 
     void	set_input	(double I) {input = I;}
     void	iterate_ODE	(void);
-private:
-    void 	set_RNG		(void);
-
-    /* Firing rates */
-    double 	get_Qp		(int) const;
-    double 	get_Qi		(int) const;
-
-    /* Currents */
-    double 	I_ep		(int) const;
-    double 	I_ei		(int) const;
-    double 	I_gp		(int) const;
-    double 	I_gi		(int) const;
-    double 	I_L_p		(int) const;
-    double 	I_L_i		(int) const;
-    double 	I_KNa		(int) const;
 
-    /* Potassium pump */
-    double 	Na_pump		(int) const;
-
-    /* Noise function */
-    double 	noise_xRK 	(int, int) const;
-    double 	noise_aRK 	(int) const;
+    /* Number of iterations for which noise is generated at once */
+    static constexpr unsigned	Noise_block	= 32;
+
+    /* Number of state variables, ordered as in Cortex_Model::Variable */
+    static constexpr unsigned	numStates	= Cortex_Model::numStates;
+
+    /* Complete state of the column between two iterations. Restoring it into
+     * a column with the same parameters and dt continues the simulation
+     * exactly. The current block of noise is recomputed from the position of
+     * the streams, so it is not stored */
+    struct State {
+        std::array<double, numStates>	y;
+        double							input;
+        uint64_t						seed;		/* Key of the noise streams		*/
+        uint32_t						id;
+        uint64_t						position;	/* Normals drawn per stream		*/
+        unsigned						Noise_count;
+        std::array<double, 4>			Rand_vars;
+    };
+    State	get_state	(void) const;
+    void	set_state	(const State& state);
+
+    /* Restarts the noise with a new seed and id as if the column had been
+     * created with them, the state variables and the input are kept */
+    void	reseed		(uint64_t seed, uint32_t id = 0);
+
+    /* Changes sigma_p, g_KNa and dphi from the next iteration on, state and
+     * noise streams are kept */
+    void	set_parameters	(const double* Par);
+private:
+    void 	set_RNG		(uint64_t, uint32_t);
+    void 	fill_noise	(void);
 
     /* ODE functions */
     void 	set_RK		(int);
-    void 	add_RK	 	(void);
+    void 	add_RK		(void);
 
-    /* Helper functions */
-    inline std::vector<double> init (double value)
-    {
-        return {value, 0.0, 0.0, 0.0, 0.0};
-    }
+    /* Noise free right hand side for the adaptive integrator, with the state
+     * ordered as in State */
+    void	derivatives	(const double* y, double* dydt) const;
 
-    inline void add_RK (std::vector<double>& var) {
-        var[0] = (-3*var[0] + 2*var[1] + 4*var[2] + 2*var[3] + var[4])/6;
-    }
-
-    inline void add_RK_noise (std::vector<double>& var, unsigned noise) {
-        var[0] = (-3*var[0] + 2*var[1] + 4*var[2] + 2*var[3] + var[4])/6 + noise_aRK(noise);
-    }
+    /* Two noise variables per noise input of the model, I_l and I_l,0 */
+    static constexpr unsigned	numRandom	= 2*Cortex_Model::numNoise;
 
     /* Random number generators */
-    std::vector<randomStreamNormal> MTRands;
-
-    /* Container for noise */
-    std::vector<double>	Rand_vars;
-
-    /* Declaration and Initialization of parameters */
-    /* Membrane time in ms */
-    static constexpr double 	tau_p 		= 30;
-    static constexpr double 	tau_i 		= 30;
-
-    /* Maximum firing rate in ms^-1 */
-    static constexpr double 	Qp_max		= 30.E-3;
-    static constexpr double 	Qi_max		= 60.E-3;
+    std::vector<randomStreamPhilox> Streams;
 
-    /* Sigmoid threshold in mV */
-    static constexpr double 	theta_p		= -58.5;
-    static constexpr double 	theta_i		= -58.5;
+    /* Block of standard normal numbers, Noise[j*Noise_block+k] is draw k of
+     * stream j, and the standard deviation of every stream */
+    std::array<double, numRandom*Noise_block>	Noise;
+    std::array<double, numRandom>				Noise_std;
+    unsigned									Noise_count	= 0;
 
-    /* Sigmoid gain in mV */
-    const double                sigma_p		= 4;
-    static constexpr double 	sigma_i		= 6;
-
-    /* Scaling parameter for sigmoidal mapping (dimensionless) */
-    static constexpr double 	C1          = (M_PI/sqrt(3));
-
-    /* Parameters of the firing adaption */
-    static constexpr double 	alpha_Na	= 2.;			/* Sodium influx per spike  in mM ms 	*/
-    static constexpr double 	tau_Na		= 1.;			/* Sodium time constant	    in ms 	*/
-
-    static constexpr double 	R_pump   	= 0.09;        	/* Na-K pump constant	    in mM/ms 	*/
-    static constexpr double 	Na_eq    	= 9.5;         	/* Na-eq concentration	    in mM 	*/
-
-    /* PSP rise time in ms^-1 */
-    static constexpr double 	gamma_e		= 70E-3;
-    static constexpr double 	gamma_g		= 58.6E-3;
-
-    /* Conductivities */
-    /* Leak  in aU*/
-    static constexpr double 	g_L    		= 1.;
-
-    /* Synaptic conductivity in ms */
-    static constexpr double 	g_AMPA 		= 1.;
-    static constexpr double 	g_GABA 		= 1.;
-
-    /* KNa in mS/cm^-2 */
-    const double                g_KNa		= 1.33;
-
-    /* Reversal potentials in mV */
-    /* Synaptic */
-    static constexpr double 	E_AMPA  	= 0;
-    static constexpr double 	E_GABA  	= -70;
-
-    /* Leak */
-    static constexpr double 	E_L_p 		= -66;
-    static constexpr double 	E_L_i 		= -64;
+    /* Container for noise */
+    std::array<double, numRandom>				Rand_vars;
 
-    /* Potassium */
-    static constexpr double 	E_K    		= -100;
+    /* Physiology and integration scheme */
+    Cortex_Model				Model;
+    SRK4<Cortex_Model>			Stepper;
 
     /* Noise parameters in ms^-1 */
-    static constexpr double 	mphi		= 0.0;
-    const double                dphi		= 20E-1;
+    double                      dphi		= 20E-1;
     double                      input		= 0.0;
 
-    /* Connectivities (dimensionless) */
-    static constexpr double 	N_pp		= 120;
-    static constexpr double 	N_ip		= 72;
-    static constexpr double 	N_pi		= 90;
-    static constexpr double 	N_ii		= 90;
-
-    /* Interation parameters for SRK4 */
-    static constexpr std::array<double,4> A = {0.5, 0.5, 1.0, 1.0};
-    static constexpr std::array<double,4> B = {0.75, 0.75, 0.0, 0.0};
-
-    /* Population variables */
-    std::vector<double> Vp	= init(E_L_p), /* excitatory membrane voltage						*/
-                        Vi	= init(E_L_i),	/* inhibitory membrane voltage						*/
-                        Na	= init(Na_eq),	/* Na concentration									*/
-                        s_ep= init(0.0),	/* PostSP from excitatory to excitatory population	*/
-                        s_ei= init(0.0),	/* PostSP from excitatory to inhibitory population	*/
-                        s_gp= init(0.0),	/* PostSP from inhibitory to excitatory population	*/
-                        s_gi= init(0.0),	/* PostSP from inhibitory to inhibitory population	*/
-                        x_ep= init(0.0),	/* derivative of s_ep								*/
-                        x_ei= init(0.0),	/* derivative of s_ei								*/
-                        x_gp= init(0.0),	/* derivative of s_gp				 				*/
-                        x_gi= init(0.0);	/* derivative of s_gi	 							*/
+    /* Duration of a time step in ms */
+    const double				dt;
+
     /* Data storage  access */
     friend void get_data (unsigned, Cortical_Column&, std::vector<double*>&);
+    friend void get_data (Cortical_Column&, Trace_Writer&);
+    friend double get_channel (const Cortical_Column&, unsigned);
+    friend class Probe_Recorder;
 
     /* Stimulation protocol access */
     friend class Stim;
+
+    /* Access to the stages of a step */
+    friend class Benchmark;
+
+    /* Deterministic integration */
+    friend class Dormand_Prince;
+
+    /* Cached transients are identified by the parameters */
+    friend class Warm_Start_Cache;
 };
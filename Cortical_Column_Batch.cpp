@@ -0,0 +1,280 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ *
+ *	Based on:	Characterization of K-Complexes and Slow Wave Activity in a Neural Mass Model
+ *				A Weigenand, M Schellenberger Costa, H-VV Ngo, JC Claussen, T Martinetz
+ *				PLoS Computational Biology. 2014;10:e1003923
+ */
+
+/******************************************************************************/
+/*				Functions of the ensemble of cortical modules				  */
+/******************************************************************************/
+#include "Cortical_Column_Batch.h"
+#include "Instrumentation.h"
+
+/******************************************************************************/
+/*								Constructor									  */
+/******************************************************************************/
+template <typename Precision>
+Cortical_Column_Batch_T<Precision>::Cortical_Column_Batch_T(unsigned Number, double* Par,
+                                                            const Simulation_Settings& Settings,
+                                                            uint64_t seed,
+                                                            const std::vector<uint32_t>& ids)
+    : N (Number)
+    , dt (Settings.dt)
+    , sigma_p (Number)
+    , g_KNa (Number)
+    , dphi (Number)
+    , input (Number, T(0))
+    , coupling (Number, T(0))
+    , Qp (Number)
+    , Qi (Number)
+    , w_KNa (Number)
+{
+    for (unsigned i=0; i < N; ++i) {
+        sigma_p[i] 	= Par[3*i+0];
+        g_KNa[i]	= Par[3*i+1];
+        dphi[i]		= Par[3*i+2];
+    }
+    set_RNG(seed, ids);
+}
+
+/******************************************************************************/
+/*							Initialization of RNG 							  */
+/******************************************************************************/
+template <typename Precision>
+void Cortical_Column_Batch_T<Precision>::set_RNG(uint64_t seed, const std::vector<uint32_t>& ids) {
+    const unsigned numRandomVariables = 2;
+
+    /* The streams of column i are the ones of a Cortical_Column with its id */
+    Streams.reserve(2*numRandomVariables*N);
+    Noise_std.resize(2*numRandomVariables*N);
+    for (unsigned i=0; i < N; ++i) {
+        const uint32_t id = ids.empty() ? i : ids[i];
+        for (unsigned j=0; j < numRandomVariables; ++j){
+            /* Add the RNG for I_{l}*/
+            Streams.emplace_back(seed, id, 2*j);
+            Noise_std[(2*j)*N+i]	= dphi[i]*dt;
+
+            /* Add the RNG for I_{l,0} */
+            Streams.emplace_back(seed, id, 2*j+1);
+            Noise_std[(2*j+1)*N+i]	= dt;
+        }
+    }
+    Noise.resize(2*numRandomVariables*Noise_block*N);
+    Rand_vars.resize(2*numRandomVariables*N);
+
+    /* Get the random number for the first iteration */
+    fill_noise(0, N);
+    for (unsigned j=0; j < 2*numRandomVariables; ++j) {
+        for (unsigned i=0; i < N; ++i) {
+            Rand_vars[j*N+i] = Noise[j*Noise_block*N+i] * Noise_std[j*N+i];
+        }
+    }
+    Noise_count = 1;
+}
+
+template <typename Precision>
+void Cortical_Column_Batch_T<Precision>::fill_noise(unsigned begin, unsigned end) {
+    const unsigned numNoise = Streams.size()/N;
+    T block[Noise_block];
+    for (unsigned i=begin; i < end; ++i) {
+        for (unsigned j=0; j < numNoise; ++j) {
+            Streams[numNoise*i+j].fill(block, Noise_block);
+            for (unsigned k=0; k < Noise_block; ++k) {
+                Noise[(j*Noise_block+k)*N+i] = block[k];
+            }
+        }
+    }
+}
+
+/******************************************************************************/
+/*                          Nonlinear functions 							  */
+/******************************************************************************/
+template <typename Precision>
+void Cortical_Column_Batch_T<Precision>::set_rates (int K, unsigned begin, unsigned end) {
+    const T* __restrict__ vp = &Vp[K*N];
+    const T* __restrict__ vi = &Vi[K*N];
+    const S* __restrict__ na = &Na[K*N];
+
+    /* Arguments of the transcendental functions */
+    for (unsigned i=begin; i < end; ++i) {
+        Qp[i]	= -C1 * (vp[i] - theta_p) / sigma_p[i];
+        Qi[i]	= -C1 * (vi[i] - theta_i) / sigma_i;
+        w_KNa[i]= S(38.7)/na[i];
+    }
+
+    /* The whole range is passed so that vectorized backends can be used */
+    math_exp	(&Qp[begin],	&Qp[begin],		end-begin);
+    math_exp	(&Qi[begin],	&Qi[begin],		end-begin);
+    math_pow_35	(&w_KNa[begin],	&w_KNa[begin],	end-begin);
+
+    for (unsigned i=begin; i < end; ++i) {
+        Qp[i]	= Qp_max / (1 + Qp[i]);
+        Qi[i]	= Qi_max / (1 + Qi[i]);
+        w_KNa[i]= T(0.37)/(1+w_KNa[i]);
+    }
+}
+
+/******************************************************************************/
+/*                              SRK iteration                                 */
+/******************************************************************************/
+template <typename Precision>
+void Cortical_Column_Batch_T<Precision>::set_RK (int K, unsigned begin, unsigned end) {
+    INSTRUMENT_SCOPE(Instrumentation::SET_RK_0 + K);
+    set_rates(K, begin, end);
+    update_RK(K, begin, end);
+}
+
+template <typename Precision>
+void Cortical_Column_Batch_T<Precision>::update_RK (int K, unsigned begin, unsigned end) {
+    const T a		= RK::A[K] * dt;
+    const S a_slow	= RK::A[K] * dt;
+    const T b		= RK::B[K];
+
+    /* Moment 0, moment K of every variable and its destination K+1 */
+    const T* __restrict__ Vp_0	= &Vp  [0];
+    const T* __restrict__ Vi_0	= &Vi  [0];
+    const S* __restrict__ Na_0	= &Na  [0];
+    const T* __restrict__ sep_0	= &s_ep[0];
+    const T* __restrict__ sei_0	= &s_ei[0];
+    const T* __restrict__ sgp_0	= &s_gp[0];
+    const T* __restrict__ sgi_0	= &s_gi[0];
+    const T* __restrict__ xep_0	= &x_ep[0];
+    const T* __restrict__ xei_0	= &x_ei[0];
+    const T* __restrict__ xgp_0	= &x_gp[0];
+    const T* __restrict__ xgi_0	= &x_gi[0];
+    const T* __restrict__ vp	= &Vp  [K*N];
+    const T* __restrict__ vi	= &Vi  [K*N];
+    const S* __restrict__ na	= &Na  [K*N];
+    const T* __restrict__ sep	= &s_ep[K*N];
+    const T* __restrict__ sei	= &s_ei[K*N];
+    const T* __restrict__ sgp	= &s_gp[K*N];
+    const T* __restrict__ sgi	= &s_gi[K*N];
+    const T* __restrict__ xep	= &x_ep[K*N];
+    const T* __restrict__ xei	= &x_ei[K*N];
+    const T* __restrict__ xgp	= &x_gp[K*N];
+    const T* __restrict__ xgi	= &x_gi[K*N];
+    const T* __restrict__ qp	= Qp.data();
+    const T* __restrict__ qi	= Qi.data();
+    const T* __restrict__ wKNa	= w_KNa.data();
+    const T* __restrict__ gKNa	= g_KNa.data();
+    const T* __restrict__ net	= coupling.data();
+    const T* __restrict__ R0	= &Rand_vars[0];
+    const T* __restrict__ R1	= &Rand_vars[N];
+    const T* __restrict__ R2	= &Rand_vars[2*N];
+    const T* __restrict__ R3	= &Rand_vars[3*N];
+
+    T* __restrict__ Vp_n	= &Vp  [(K+1)*N];
+    T* __restrict__ Vi_n	= &Vi  [(K+1)*N];
+    S* __restrict__ Na_n	= &Na  [(K+1)*N];
+    T* __restrict__ sep_n	= &s_ep[(K+1)*N];
+    T* __restrict__ sei_n	= &s_ei[(K+1)*N];
+    T* __restrict__ sgp_n	= &s_gp[(K+1)*N];
+    T* __restrict__ sgi_n	= &s_gi[(K+1)*N];
+    T* __restrict__ xep_n	= &x_ep[(K+1)*N];
+    T* __restrict__ xei_n	= &x_ei[(K+1)*N];
+    T* __restrict__ xgp_n	= &x_gp[(K+1)*N];
+    T* __restrict__ xgi_n	= &x_gi[(K+1)*N];
+
+    const T sqrt_3		= std::sqrt(T(3));
+
+    /* The right hand side of Cortex_Model per column, followed by the stage
+     * of SRK4, so that the results are identical in double precision */
+    for (unsigned i=begin; i < end; ++i) {
+        const CC::Variables<T, S> y = {vp[i], vi[i], na[i], sep[i], sei[i], sgp[i], sgi[i],
+                                       xep[i], xei[i], xgp[i], xgi[i]};
+        const CC::Variables<T, S> d = CC::derivatives(y, qp[i], qi[i], wKNa[i], gKNa[i], net[i]);
+
+        Vp_n [i] = Vp_0 [i] + a*d.Vp;
+        Vi_n [i] = Vi_0 [i] + a*d.Vi;
+        Na_n [i] = Na_0 [i] + a_slow*d.Na;
+        sep_n[i] = sep_0[i] + a*d.s_ep;
+        sei_n[i] = sei_0[i] + a*d.s_ei;
+        sgp_n[i] = sgp_0[i] + a*d.s_gp;
+        sgi_n[i] = sgi_0[i] + a*d.s_gi;
+        xep_n[i] = xep_0[i] + a*d.x_ep + gamma_e * gamma_e * (R0[i] + R1[i]/sqrt_3)*b;
+        xei_n[i] = xei_0[i] + a*d.x_ei + gamma_e * gamma_e * (R2[i] + R3[i]/sqrt_3)*b;
+        xgp_n[i] = xgp_0[i] + a*d.x_gp;
+        xgi_n[i] = xgi_0[i] + a*d.x_gi;
+    }
+}
+
+template <typename Precision>
+void Cortical_Column_Batch_T<Precision>::add_RK(unsigned begin, unsigned end) {
+    INSTRUMENT_SCOPE(Instrumentation::ADD_RK);
+    add_RK(Vp,	 begin, end);
+    add_RK(Vi,	 begin, end);
+    add_RK(Na,	 begin, end);
+    add_RK(s_ep, begin, end);
+    add_RK(s_ei, begin, end);
+    add_RK(s_gp, begin, end);
+    add_RK(s_gi, begin, end);
+    add_RK_noise(x_ep, 0, begin, end);
+    add_RK_noise(x_ei, 1, begin, end);
+    add_RK(x_gp, begin, end);
+    add_RK(x_gi, begin, end);
+
+    /* Generate noise for the next iteration, the counter is advanced by
+     * next_noise once all ranges are done */
+    if (Noise_count == Noise_block) {
+        INSTRUMENT_SCOPE(Instrumentation::NOISE);
+        fill_noise(begin, end);
+    }
+    const unsigned k		= Noise_count % Noise_block;
+    const unsigned numNoise = Rand_vars.size()/N;
+    for (unsigned j=0; j < numNoise; ++j) {
+        const T* __restrict__ z		= &Noise[(j*Noise_block+k)*N];
+        const T* __restrict__ sd	= &Noise_std[j*N];
+        T* __restrict__ R			= &Rand_vars[j*N];
+        for (unsigned i=begin; i < end; ++i) {
+            R[i] = z[i] * sd[i] + input[i];
+        }
+    }
+}
+
+template <typename Precision>
+void Cortical_Column_Batch_T<Precision>::next_noise(void) {
+    Noise_count = Noise_count % Noise_block + 1;
+}
+
+template <typename Precision>
+void Cortical_Column_Batch_T<Precision>::iterate_ODE(void) {
+    INSTRUMENT_SCOPE(Instrumentation::STEP);
+
+    /* First calculating every ith RK moment. This has to be in order, 1th
+     * moment first
+     */
+    for (unsigned i=0; i < 4; ++i) {
+        set_RK(i, 0, N);
+    }
+    add_RK(0, N);
+    next_noise();
+}
+
+/******************************************************************************/
+/*							Explicit instantiations							  */
+/******************************************************************************/
+template class Cortical_Column_Batch_T<Double_Precision>;
+template class Cortical_Column_Batch_T<Single_Precision>;
+template class Cortical_Column_Batch_T<Mixed_Precision>;
@@ -0,0 +1,223 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ *
+ *	Based on:	Characterization of K-Complexes and Slow Wave Activity in a Neural Mass Model
+ *				A Weigenand, M Schellenberger Costa, H-VV Ngo, JC Claussen, T Martinetz
+ *				PLoS Computational Biology. 2014;10:e1003923
+ */
+
+/******************************************************************************/
+/*			Implementation of an ensemble of independent cortical modules	  */
+/*																			  */
+/*	Every state variable and every RK moment is stored as a contiguous array  */
+/*	over all columns (structure of arrays). Moment k of column i is found at  */
+/*	index k*N + i, so that each stage of the SRK4 scheme is a set of plain	  */
+/*	loops over the columns that the compiler can vectorize.					  */
+/*																			  */
+/*	The columns use the same arithmetic and the same noise streams as		  */
+/*	Cortical_Column, so that column i of a batch reproduces the scalar		  */
+/*	column with the same seed and id i bit for bit.							  */
+/*																			  */
+/*	The scalar type is chosen by a precision policy. Single precision halves  */
+/*	the memory traffic and doubles the number of SIMD lanes, mixed precision  */
+/*	keeps the slow Na concentration and the summation of the RK moments in	  */
+/*	double. The noise streams are the same in every precision, the normals	  */
+/*	are rounded when they are stored. Precision_Check.cpp compares the long	  */
+/*	run statistics against double precision.								  */
+/******************************************************************************/
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "Cortical_Column.h"
+#include "Random_Stream.h"
+
+/******************************************************************************/
+/*								Precision policies							  */
+/*	State is the type of the variables, their moments and the noise, Slow	  */
+/*	the type of Na and of the sum of the moments in add_RK.					  */
+/******************************************************************************/
+struct Double_Precision {
+    typedef double	State;
+    typedef double	Slow;
+    static constexpr const char* name = "double";
+};
+
+struct Single_Precision {
+    typedef float	State;
+    typedef float	Slow;
+    static constexpr const char* name = "single";
+};
+
+struct Mixed_Precision {
+    typedef float	State;
+    typedef double	Slow;
+    static constexpr const char* name = "mixed";
+};
+
+template <typename Precision>
+class Cortical_Column_Batch_T {
+public:
+    typedef typename Precision::State	T;
+    typedef typename Precision::Slow	S;
+
+    /* Par contains the parameters (sigma_p, g_KNa, dphi) of every column one
+     * after another, i.e. Par[3*i+0], Par[3*i+1], Par[3*i+2] for column i.
+     * Column i has the noise of Cortical_Column(&Par[3*i], Settings, seed, id)
+     * with id = ids[i], or id = i if ids is empty */
+    Cortical_Column_Batch_T(unsigned Number, double* Par,
+                            const Simulation_Settings& Settings = Simulation_Settings(),
+                            uint64_t seed = rand(),
+                            const std::vector<uint32_t>& ids = std::vector<uint32_t>());
+
+    void		set_input	(unsigned i, double I) {input[i] = I;}
+    void		iterate_ODE	(void);
+
+    unsigned 	size		(void) const {return N;}
+private:
+    void 	set_RNG		(uint64_t, const std::vector<uint32_t>&);
+    void 	fill_noise	(unsigned begin, unsigned end);
+
+    /* Firing rates and KNa activation of the columns [begin, end) at moment K */
+    void 	set_rates	(int K, unsigned begin, unsigned end);
+
+    /* ODE functions of the columns [begin, end). A step of all columns is
+     * set_RK for every moment, add_RK and finally next_noise once, so that
+     * disjoint ranges can be processed in parallel. set_RK is set_rates
+     * followed by update_RK, which uses the rates in Qp and the coupling */
+    void 	set_RK		(int K, unsigned begin, unsigned end);
+    void	update_RK	(int K, unsigned begin, unsigned end);
+    void 	add_RK	 	(unsigned begin, unsigned end);
+    void	next_noise	(void);
+
+    /* Helper functions */
+    template <typename V>
+    inline std::vector<V> init (V value)
+    {
+        std::vector<V> var(5*N, V(0));
+        std::fill(var.begin(), var.begin()+N, value);
+        return var;
+    }
+
+    /* The moments are summed in the slow type */
+    template <typename V>
+    inline void add_RK (std::vector<V>& var, unsigned begin, unsigned end) {
+        V* __restrict__ v = var.data();
+        for (unsigned i=begin; i < end; ++i) {
+            v[i] = (-3*S(v[i]) + 2*S(v[N+i]) + 4*S(v[2*N+i]) + 2*S(v[3*N+i]) + S(v[4*N+i]))/6;
+        }
+    }
+
+    inline void add_RK_noise (std::vector<T>& var, unsigned M, unsigned begin, unsigned end) {
+        T* __restrict__ v = var.data();
+        const T* __restrict__ R0 = &Rand_vars[(2*M)  *N];
+        const T* __restrict__ R1 = &Rand_vars[(2*M+1)*N];
+        const S gamma = gamma_e;
+        for (unsigned i=begin; i < end; ++i) {
+            v[i] = (-3*S(v[i]) + 2*S(v[N+i]) + 4*S(v[2*N+i]) + 2*S(v[3*N+i]) + S(v[4*N+i]))/6
+                 + gamma * gamma * (S(R0[i]) - S(R1[i])*std::sqrt(S(3)))/4;
+        }
+    }
+
+    /* Number of columns */
+    const unsigned				N;
+
+    /* Duration of a time step in ms */
+    const double				dt;
+
+    /* Random number generators, four per column ordered by column */
+    std::vector<randomStreamPhilox> Streams;
+
+    /* Block of standard normal numbers, Noise[(j*Noise_block+k)*N+i] is draw k
+     * of stream j of column i, and the standard deviation of every stream */
+    static constexpr unsigned	Noise_block	= Cortical_Column::Noise_block;
+    std::vector<T>		Noise;
+    std::vector<T>		Noise_std;
+    unsigned			Noise_count	= 0;
+
+    /* Container for noise, Rand_vars[j*N+i] is noise variable j of column i */
+    std::vector<T>		Rand_vars;
+
+    /* Parameters that vary between columns */
+    std::vector<T>				sigma_p,
+                                g_KNa,
+                                dphi,
+                                input;
+
+    /* Afferent firing rate from other columns in ms^-1, which drives s_ep and
+     * s_ei like the local one (see Cortical_Network and Cortical_Sheet) */
+    std::vector<T>				coupling;
+
+    /* Scratch space for the nonlinearities of the current moment */
+    std::vector<T>				Qp,
+                                Qi,
+                                w_KNa;
+
+    /* The right hand side is the one of Cortex_Model, the parameters of the
+     * rates, the initial state and the noise gain are rounded to T */
+    typedef Cortex_Model CC;
+    typedef SRK4<Cortex_Model> RK;
+    static constexpr T		 	Qp_max		= CC::Qp_max;
+    static constexpr T		 	Qi_max		= CC::Qi_max;
+    static constexpr T		 	theta_p		= CC::theta_p;
+    static constexpr T		 	theta_i		= CC::theta_i;
+    static constexpr T		 	sigma_i		= CC::sigma_i;
+    static constexpr T		 	C1          = CC::C1;
+    static constexpr T		 	gamma_e		= CC::gamma_e;
+    static constexpr T		 	E_L_p 		= CC::E_L_p;
+    static constexpr T		 	E_L_i 		= CC::E_L_i;
+    static constexpr S		 	Na_eq    	= CC::Na_eq;
+
+    /* Population variables, see Cortical_Column for their meaning */
+    std::vector<T>		Vp	= init(E_L_p),
+                        Vi	= init(E_L_i);
+    std::vector<S>		Na	= init(Na_eq);
+    std::vector<T>		s_ep= init(T(0)),
+                        s_ei= init(T(0)),
+                        s_gp= init(T(0)),
+                        s_gi= init(T(0)),
+                        x_ep= init(T(0)),
+                        x_ei= init(T(0)),
+                        x_gp= init(T(0)),
+                        x_gi= init(T(0));
+
+    /* Data storage  access */
+    template <typename P>
+    friend void get_data (unsigned, Cortical_Column_Batch_T<P>&, unsigned, std::vector<double*>&);
+
+    /* Network of coupled columns */
+    friend class Cortical_Network;
+    friend class Cortical_Sheet;
+};
+
+/* The double precision batch reproduces Cortical_Column */
+typedef Cortical_Column_Batch_T<Double_Precision>	Cortical_Column_Batch;
+typedef Cortical_Column_Batch_T<Single_Precision>	Cortical_Column_Batch_Single;
+typedef Cortical_Column_Batch_T<Mixed_Precision>	Cortical_Column_Batch_Mixed;
+
+extern template class Cortical_Column_Batch_T<Double_Precision>;
+extern template class Cortical_Column_Batch_T<Single_Precision>;
+extern template class Cortical_Column_Batch_T<Mixed_Precision>;
@@ -0,0 +1,278 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*						Functions of the network of columns					  */
+/******************************************************************************/
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "Cortical_Network.h"
+#include "Instrumentation.h"
+#include "Step_Barrier.h"
+
+/* Work of a column step in units of the work of an edge, used to balance the
+ * partitions */
+static const unsigned column_cost	= 64;
+
+/* Partition boundaries are multiples of this, so that threads do not share
+ * cache lines of the state arrays */
+static const unsigned alignment		= 8;
+
+/******************************************************************************/
+/*								Constructor									  */
+/******************************************************************************/
+Cortical_Network::Cortical_Network(unsigned Number, double* Par,
+                                   const std::vector<unsigned>&	offsets,
+                                   const std::vector<unsigned>&	sources,
+                                   const std::vector<double>&	weights,
+                                   const std::vector<double>&	delays,
+                                   const Simulation_Settings& Settings,
+                                   uint64_t seed,
+                                   unsigned threads,
+                                   bool reorder)
+    : N (Number)
+    , order (column_order(Number, offsets, sources, reorder))
+    , position (Number)
+    , Columns (Number, permute_parameters(order, Par).data(), Settings, seed,
+               std::vector<uint32_t>(order.begin(), order.end()))
+{
+    for (unsigned k=0; k < N; ++k) {
+        position[order[k]] = k;
+    }
+
+    /* Afferent edges in the new order, sorted by source for locality */
+    struct Edge {
+        unsigned	source;
+        double		weight;
+        unsigned	delay;
+    };
+    std::vector<Edge> row;
+    Offsets.reserve(N+1);
+    Sources.reserve(sources.size());
+    Weights.reserve(sources.size());
+    Delays.reserve(sources.size());
+    Offsets.push_back(0);
+    unsigned longest = 0;
+    for (unsigned k=0; k < N; ++k) {
+        const unsigned i = order[k];
+        row.clear();
+        for (unsigned e=offsets[i]; e < offsets[i+1]; ++e) {
+            const unsigned delay = std::max(1L, std::lround(delays[e]/Settings.dt));
+            row.push_back(Edge{position[sources[e]], weights[e], delay});
+            longest = std::max(longest, delay);
+        }
+        std::sort(row.begin(), row.end(), [](const Edge& a, const Edge& b) {
+            return a.source < b.source;
+        });
+        for (auto& edge : row) {
+            Sources.push_back(edge.source);
+            Weights.push_back(edge.weight);
+            Delays.push_back(edge.delay);
+        }
+        Offsets.push_back(Sources.size());
+    }
+
+    /* The history starts with the rates of the initial state */
+    numSlots = longest+1;
+    History.resize(numSlots*N);
+    Columns.set_rates(0, 0, N);
+    for (unsigned s=0; s < numSlots; ++s) {
+        std::copy(Columns.Qp.begin(), Columns.Qp.end(), History.begin() + s*N);
+    }
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    set_partitions(threads);
+}
+
+/******************************************************************************/
+/*								Reordering									  */
+/******************************************************************************/
+std::vector<unsigned> Cortical_Network::column_order(unsigned Number,
+                                                     const std::vector<unsigned>& offsets,
+                                                     const std::vector<unsigned>& sources,
+                                                     bool reorder) {
+    std::vector<unsigned> result(Number);
+    for (unsigned i=0; i < Number; ++i) {
+        result[i] = i;
+    }
+    if (!reorder) {
+        return result;
+    }
+
+    /* Symmetrized adjacency in CSR format */
+    std::vector<unsigned> degree(Number, 0);
+    for (unsigned i=0; i < Number; ++i) {
+        for (unsigned e=offsets[i]; e < offsets[i+1]; ++e) {
+            if (sources[e] != i) {
+                ++degree[i];
+                ++degree[sources[e]];
+            }
+        }
+    }
+    std::vector<unsigned> start(Number+1, 0);
+    for (unsigned i=0; i < Number; ++i) {
+        start[i+1] = start[i] + degree[i];
+    }
+    std::vector<unsigned> fill(start.begin(), start.end()-1);
+    std::vector<unsigned> neighbors(start[Number]);
+    for (unsigned i=0; i < Number; ++i) {
+        for (unsigned e=offsets[i]; e < offsets[i+1]; ++e) {
+            const unsigned j = sources[e];
+            if (j != i) {
+                neighbors[fill[i]++] = j;
+                neighbors[fill[j]++] = i;
+            }
+        }
+    }
+
+    /* Breadth first search from the columns of lowest degree, neighbors are
+     * visited in the order of increasing degree */
+    auto by_degree = [&degree](unsigned a, unsigned b) {
+        return degree[a] < degree[b] || (degree[a] == degree[b] && a < b);
+    };
+    std::vector<unsigned> seeds = result;
+    std::sort(seeds.begin(), seeds.end(), by_degree);
+
+    std::vector<bool> visited(Number, false);
+    std::vector<unsigned> next;
+    unsigned count = 0;
+    for (unsigned seed : seeds) {
+        if (visited[seed]) {
+            continue;
+        }
+        visited[seed] = true;
+        result[count++] = seed;
+        for (unsigned head = count-1; head < count; ++head) {
+            const unsigned i = result[head];
+            next.clear();
+            for (unsigned e=start[i]; e < start[i+1]; ++e) {
+                if (!visited[neighbors[e]]) {
+                    visited[neighbors[e]] = true;
+                    next.push_back(neighbors[e]);
+                }
+            }
+            std::sort(next.begin(), next.end(), by_degree);
+            for (unsigned j : next) {
+                result[count++] = j;
+            }
+        }
+    }
+    std::reverse(result.begin(), result.end());
+    return result;
+}
+
+std::vector<double> Cortical_Network::permute_parameters(const std::vector<unsigned>& order,
+                                                         const double* Par) {
+    std::vector<double> Par_new(3*order.size());
+    for (unsigned k=0; k < order.size(); ++k) {
+        for (unsigned p=0; p < 3; ++p) {
+            Par_new[3*k+p] = Par[3*order[k]+p];
+        }
+    }
+    return Par_new;
+}
+
+/******************************************************************************/
+/*								Partitioning								  */
+/******************************************************************************/
+void Cortical_Network::set_partitions(unsigned threads) {
+    threads = std::max(1u, std::min(threads, (N + alignment - 1)/alignment));
+    const double total = Sources.size() + double(column_cost)*N;
+
+    partition.assign(1, 0);
+    double work = 0;
+    for (unsigned k=0; k < N && partition.size() < threads; ++k) {
+        work += (Offsets[k+1] - Offsets[k]) + column_cost;
+        const unsigned boundary = (k+1) - (k+1)%alignment;
+        if (work >= total*partition.size()/threads && boundary > partition.back()) {
+            partition.push_back(boundary);
+        }
+    }
+    partition.push_back(N);
+}
+
+/******************************************************************************/
+/*								Time stepping								  */
+/******************************************************************************/
+void Cortical_Network::step(unsigned begin, unsigned end) {
+    /* Afferent rates from the history, all delays are at least one step */
+    const double* __restrict__ history	= History.data();
+    const unsigned* __restrict__ source	= Sources.data();
+    const unsigned* __restrict__ delay	= Delays.data();
+    const double* __restrict__ weight	= Weights.data();
+    for (unsigned k=begin; k < end; ++k) {
+        double sum = 0;
+        for (unsigned e=Offsets[k]; e < Offsets[k+1]; ++e) {
+            const unsigned s = Slot >= delay[e] ? Slot - delay[e] : Slot + numSlots - delay[e];
+            sum += weight[e] * history[s*N + source[e]];
+        }
+        Columns.coupling[k] = sum;
+    }
+
+    /* The rates of the current state are computed in the first stage */
+    Columns.set_RK(0, begin, end);
+    std::copy(Columns.Qp.begin() + begin, Columns.Qp.begin() + end,
+              History.begin() + Slot*N + begin);
+    for (unsigned K=1; K < 4; ++K) {
+        Columns.set_RK(K, begin, end);
+    }
+    Columns.add_RK(begin, end);
+}
+
+void Cortical_Network::iterate_ODE(unsigned steps) {
+    INSTRUMENT_SCOPE(Instrumentation::STEP);
+    auto finish = [this]() {
+        Columns.next_noise();
+        Slot = (Slot+1) % numSlots;
+    };
+
+    const unsigned numThreads = threads();
+    if (numThreads == 1) {
+        for (unsigned t=0; t < steps; ++t) {
+            step(0, N);
+            finish();
+        }
+        return;
+    }
+
+    Step_Barrier barrier(numThreads);
+    auto work = [&](unsigned p) {
+        for (unsigned t=0; t < steps; ++t) {
+            step(partition[p], partition[p+1]);
+            barrier.wait(finish);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned p=1; p < numThreads; ++p) {
+        workers.emplace_back(work, p);
+    }
+    work(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
@@ -0,0 +1,118 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*				Network of cortical columns with conduction delays			  */
+/*																			  */
+/*	The connectivity is a sparse matrix in compressed sparse row format		  */
+/*	over the targets: the afferent edges of column i are the entries		  */
+/*	[offsets[i], offsets[i+1]) of sources, weights and delays (in ms).		  */
+/*	Every column receives the weighted and delayed pyramidal firing rates	  */
+/*																			  */
+/*		coupling_i(t) = sum_j w_ij Qp_j(t - d_ij)							  */
+/*																			  */
+/*	which drives s_ep and s_ei in addition to the local rates N_pp * Qp and	  */
+/*	N_ip * Qp. The weights are therefore numbers of connections like N_pp.	  */
+/*																			  */
+/*	Delays are rounded to multiples of dt (at least one step). The firing	  */
+/*	rates of all columns are kept in a ring of max_delay+1 time slots, where  */
+/*	slot s holds the rates of all columns contiguously, like the moments of	  */
+/*	Cortical_Column_Batch. The columns are reordered with reverse Cuthill-	  */
+/*	McKee, so that the sources of a column are close to it in memory, and	  */
+/*	split into contiguous partitions with similar numbers of edges, one per	  */
+/*	thread. Threads synchronize once per step.								  */
+/*																			  */
+/*	Columns keep their original index in the interface and their noise is	  */
+/*	the one of Cortical_Column(&Par[3*i], Settings, seed, i).				  */
+/******************************************************************************/
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Cortical_Column_Batch.h"
+#include "Simulation_Settings.h"
+
+class Cortical_Network {
+public:
+    /* Par contains the parameters of every column as for Cortical_Column_Batch.
+     * A thread number of 0 uses all available cores */
+    Cortical_Network(unsigned Number, double* Par,
+                     const std::vector<unsigned>&	offsets,
+                     const std::vector<unsigned>&	sources,
+                     const std::vector<double>&		weights,
+                     const std::vector<double>&		delays,
+                     const Simulation_Settings& Settings = Simulation_Settings(),
+                     uint64_t seed = rand(),
+                     unsigned threads = 0,
+                     bool reorder = true);
+
+    /* Advances the network by steps time steps. Threads are started for every
+     * call, so the network should be iterated in blocks, e.g. of red steps */
+    void		iterate_ODE	(unsigned steps = 1);
+
+    void		set_input	(unsigned i, double I) {Columns.set_input(position[i], I);}
+    double		Vp			(unsigned i) const {return Columns.Vp[position[i]];}
+
+    unsigned	size		(void) const {return N;}
+    unsigned	max_delay	(void) const {return numSlots-1;}
+    unsigned	threads		(void) const {return partition.size()-1;}
+private:
+    /* Permutation of the columns, order[k] is the original index of column k.
+     * Reverse Cuthill-McKee of the symmetrized graph or the identity */
+    static std::vector<unsigned>	column_order			(unsigned Number,
+                                                         const std::vector<unsigned>& offsets,
+                                                         const std::vector<unsigned>& sources,
+                                                         bool reorder);
+    static std::vector<double>		permute_parameters		(const std::vector<unsigned>& order,
+                                                         const double* Par);
+
+    /* Splits the columns into partitions with similar work */
+    void	set_partitions	(unsigned threads);
+
+    /* One step of the columns [begin, end) */
+    void	step			(unsigned begin, unsigned end);
+
+    const unsigned				N;
+
+    /* Reordering of the columns and its inverse */
+    std::vector<unsigned>		order;
+    std::vector<unsigned>		position;
+
+    /* Columns in the new order */
+    Cortical_Column_Batch		Columns;
+
+    /* Afferent edges in the new order, delays in time steps */
+    std::vector<unsigned>		Offsets;
+    std::vector<unsigned>		Sources;
+    std::vector<double>			Weights;
+    std::vector<unsigned>		Delays;
+
+    /* Ring of firing rates, History[s*N+k] is the rate of column k at slot s */
+    unsigned					numSlots	= 1;
+    unsigned					Slot		= 0;
+    std::vector<double>			History;
+
+    /* Boundaries of the partitions, thread p works on [partition[p], partition[p+1]) */
+    std::vector<unsigned>		partition;
+};
@@ -0,0 +1,154 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*						Functions of the sheet of columns					  */
+/******************************************************************************/
+#include <algorithm>
+#include <thread>
+
+#include "Cortical_Sheet.h"
+#include "Instrumentation.h"
+#include "Step_Barrier.h"
+
+/******************************************************************************/
+/*								Constructor									  */
+/******************************************************************************/
+Cortical_Sheet::Cortical_Sheet(unsigned Width, unsigned Height, double* Par, double D,
+                               const Simulation_Settings& Settings,
+                               uint64_t seed,
+                               unsigned threads)
+    : W (Width)
+    , H (Height)
+    , D (D)
+    , Columns (Width*Height, Par, Settings, seed)
+    , Rates (2*Width*Height)
+{
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::max(1u, std::min(threads, H));
+
+    /* Rows are split evenly, the first blocks get one row more */
+    partition.assign(1, 0);
+    for (unsigned p=0; p < threads; ++p) {
+        const unsigned rows = H/threads + (p < H%threads ? 1 : 0);
+        partition.push_back(partition.back() + rows*W);
+    }
+}
+
+/******************************************************************************/
+/*								Stencil										  */
+/******************************************************************************/
+void Cortical_Sheet::publish(int K, unsigned begin, unsigned end) {
+    Columns.set_rates(K, begin, end);
+    std::copy(Columns.Qp.begin() + begin, Columns.Qp.begin() + end,
+              Rates.begin() + (K%2)*W*H + begin);
+}
+
+void Cortical_Sheet::set_coupling(int K, unsigned begin, unsigned end) {
+    const double* __restrict__ rates	= &Rates[(K%2)*W*H];
+    double* __restrict__ net			= Columns.coupling.data();
+
+    /* Missing neighbours at the border are replaced by the column itself,
+     * which does not contribute */
+    for (unsigned row=begin/W; row < end/W; ++row) {
+        const double* __restrict__ q	= rates + row*W;
+        const double* __restrict__ up	= row > 0   ? q - W : q;
+        const double* __restrict__ down	= row < H-1 ? q + W : q;
+        double* __restrict__ c			= net + row*W;
+        c[0] = D * ((W > 1 ? q[1] - q[0] : 0) + (up[0] - q[0]) + (down[0] - q[0]));
+        for (unsigned x=1; x+1 < W; ++x) {
+            c[x] = D * ((q[x-1] - q[x]) + (q[x+1] - q[x]) + (up[x] - q[x]) + (down[x] - q[x]));
+        }
+        if (W > 1) {
+            c[W-1] = D * ((q[W-2] - q[W-1]) + (up[W-1] - q[W-1]) + (down[W-1] - q[W-1]));
+        }
+    }
+}
+
+/******************************************************************************/
+/*								Time stepping								  */
+/******************************************************************************/
+void Cortical_Sheet::iterate_ODE(unsigned steps) {
+    INSTRUMENT_SCOPE(Instrumentation::STEP);
+    const unsigned numThreads = threads();
+    if (numThreads == 1) {
+        for (unsigned t=0; t < steps; ++t) {
+            for (unsigned K=0; K < 4; ++K) {
+                publish(K, 0, W*H);
+                set_coupling(K, 0, W*H);
+                Columns.update_RK(K, 0, W*H);
+            }
+            Columns.add_RK(0, W*H);
+            Columns.next_noise();
+        }
+        return;
+    }
+
+    /* A buffer of rates is overwritten two stages after it was published, when
+     * all threads have passed the barrier of the stage in between. The noise
+     * counter of the previous step is advanced at the first barrier, when
+     * add_RK of the previous step is done everywhere */
+    Step_Barrier barrier(numThreads);
+    auto work = [&](unsigned p) {
+        const unsigned begin	= partition[p];
+        const unsigned end		= partition[p+1];
+        for (unsigned t=0; t < steps; ++t) {
+            for (unsigned K=0; K < 4; ++K) {
+                publish(K, begin, end);
+                if (K == 0 && t > 0) {
+                    barrier.wait([this]() {Columns.next_noise();});
+                } else {
+                    barrier.wait([]() {});
+                }
+                set_coupling(K, begin, end);
+                Columns.update_RK(K, begin, end);
+            }
+            Columns.add_RK(begin, end);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned p=1; p < numThreads; ++p) {
+        workers.emplace_back(work, p);
+    }
+    work(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (steps > 0) {
+        Columns.next_noise();
+    }
+}
+
+/******************************************************************************/
+/*								Data output									  */
+/******************************************************************************/
+void Cortical_Sheet::get_frame(double* frame, unsigned stride) const {
+    for (unsigned y=0; y < H; y += stride) {
+        for (unsigned x=0; x < W; x += stride) {
+            *frame++ = Columns.Vp[y*W+x];
+        }
+    }
+}
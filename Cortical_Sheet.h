@@ -0,0 +1,99 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*				Two dimensional sheet of nearest neighbour coupled columns	  */
+/*																			  */
+/*	The columns form a Width x Height lattice stored row by row, column		  */
+/*	(x, y) has index y*Width + x. Neighbouring columns exchange their		  */
+/*	pyramidal firing rates diffusively,										  */
+/*																			  */
+/*		coupling_i = D * sum_j (Qp_j - Qp_i),								  */
+/*																			  */
+/*	over the four nearest neighbours j, with no flux across the border. The	  */
+/*	coupling drives s_ep and s_ei like the network input of					  */
+/*	Cortical_Network, but it is evaluated in every stage of the SRK scheme	  */
+/*	from the rates of that stage, so every stage is a stencil sweep.		  */
+/*																			  */
+/*	Threads own blocks of whole rows. The rates of a stage are published in  */
+/*	a double buffer, so that the rows at the border of a block (the halo)	  */
+/*	are read directly from the neighbouring block and one barrier per stage  */
+/*	suffices. The noise of column i is the one of							  */
+/*	Cortical_Column(&Par[3*i], Settings, seed, i), so the results do not	  */
+/*	depend on the number of threads.										  */
+/******************************************************************************/
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Cortical_Column_Batch.h"
+#include "Simulation_Settings.h"
+
+class Cortical_Sheet {
+public:
+    /* Par contains the parameters of every column as for Cortical_Column_Batch,
+     * D is the number of connections to every neighbour. A thread number of 0
+     * uses all available cores */
+    Cortical_Sheet(unsigned Width, unsigned Height, double* Par, double D,
+                   const Simulation_Settings& Settings = Simulation_Settings(),
+                   uint64_t seed = rand(),
+                   unsigned threads = 0);
+
+    /* Advances the sheet by steps time steps. Threads are started for every
+     * call, so the sheet should be iterated in blocks, e.g. of red steps */
+    void		iterate_ODE	(unsigned steps = 1);
+
+    void		set_input	(unsigned x, unsigned y, double I) {Columns.set_input(y*W+x, I);}
+    double		Vp			(unsigned x, unsigned y) const {return Columns.Vp[y*W+x];}
+
+    /* Writes Vp of every stride-th column in x and y into frame, row by row.
+     * frame has to hold frame_size(stride) values */
+    void		get_frame	(double* frame, unsigned stride = 1) const;
+    unsigned	frame_size	(unsigned stride = 1) const
+    {return ((W+stride-1)/stride) * ((H+stride-1)/stride);}
+
+    unsigned	width		(void) const {return W;}
+    unsigned	height		(void) const {return H;}
+    unsigned	threads		(void) const {return partition.size()-1;}
+private:
+    /* Rates of moment K of the columns [begin, end) into the buffer of K */
+    void	publish		(int K, unsigned begin, unsigned end);
+
+    /* Diffusive coupling of the columns [begin, end) from the buffer of K */
+    void	set_coupling(int K, unsigned begin, unsigned end);
+
+    const unsigned				W;
+    const unsigned				H;
+
+    /* Strength of the coupling */
+    const double				D;
+
+    Cortical_Column_Batch		Columns;
+
+    /* Firing rates of two consecutive moments, Rates[(K%2)*N+i] */
+    std::vector<double>			Rates;
+
+    /* Boundaries of the partitions in columns, always whole rows */
+    std::vector<unsigned>		partition;
+};
@@ -28,13 +28,56 @@
 #pragma once
 #include <vector>
 #include "Cortical_Column.h"
+#include "Cortical_Column_Batch.h"
+#include "Instrumentation.h"
+#include "Trace_Writer.h"
 
 inline void get_data(unsigned counter, Cortical_Column& Col,
                      std::vector<double*>& pData) {
-    pData[0][counter] = Col.Vp	[0];
-    pData[1][counter] = Col.Vi	[0];
-    pData[2][counter] = Col.s_ep[0];
-    pData[3][counter] = Col.s_ei[0];
-    pData[4][counter] = Col.s_gp[0];
-    pData[5][counter] = Col.s_gi[0];
+    INSTRUMENT_SCOPE(Instrumentation::GET_DATA);
+    INSTRUMENT_COUNT(Instrumentation::SAMPLES);
+    const Cortex_Model::State& y = Col.Stepper.state();
+    pData[0][counter] = y[Cortex_Model::Vp];
+    pData[1][counter] = y[Cortex_Model::Vi];
+    pData[2][counter] = y[Cortex_Model::s_ep];
+    pData[3][counter] = y[Cortex_Model::s_ei];
+    pData[4][counter] = y[Cortex_Model::s_gp];
+    pData[5][counter] = y[Cortex_Model::s_gi];
+}
+
+/* Single channel in the order of get_data, e.g. for online analysis */
+inline double get_channel(const Cortical_Column& Col, unsigned channel) {
+    const Cortex_Model::State& y = Col.Stepper.state();
+    switch (channel) {
+    default:
+    case 0: return y[Cortex_Model::Vp];
+    case 1: return y[Cortex_Model::Vi];
+    case 2: return y[Cortex_Model::s_ep];
+    case 3: return y[Cortex_Model::s_ei];
+    case 4: return y[Cortex_Model::s_gp];
+    case 5: return y[Cortex_Model::s_gi];
+    }
+}
+
+/* Streaming version, the channels are the same as above */
+inline void get_data(Cortical_Column& Col, Trace_Writer& Writer) {
+    INSTRUMENT_SCOPE(Instrumentation::GET_DATA);
+    INSTRUMENT_COUNT(Instrumentation::SAMPLES);
+    const Cortex_Model::State& y = Col.Stepper.state();
+    const double sample[6] = {y[Cortex_Model::Vp], y[Cortex_Model::Vi], y[Cortex_Model::s_ep],
+                              y[Cortex_Model::s_ei], y[Cortex_Model::s_gp], y[Cortex_Model::s_gi]};
+    Writer.push(sample);
+}
+
+template <typename Precision>
+inline void get_data(unsigned counter, Cortical_Column_Batch_T<Precision>& Col, unsigned i,
+                     std::vector<double*>& pData) {
+    INSTRUMENT_SCOPE(Instrumentation::GET_DATA);
+    INSTRUMENT_COUNT(Instrumentation::SAMPLES);
+    pData[0][counter] = Col.Vp	[i];
+    pData[1][counter] = Col.Vi	[i];
+    pData[2][counter] = Col.s_ep[i];
+    pData[3][counter] = Col.s_ei[i];
+    pData[4][counter] = Col.s_gp[i];
+    pData[5][counter] = Col.s_gi[i];
 }
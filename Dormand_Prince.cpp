@@ -0,0 +1,198 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*					Functions of the adaptive integrator					  */
+/******************************************************************************/
+#include <algorithm>
+#include <cmath>
+
+#include "Dormand_Prince.h"
+
+constexpr unsigned Dormand_Prince::M;
+
+/******************************************************************************/
+/*									Coefficients							  */
+/*	Butcher tableau, error estimate and dense output of Hairer, Norsett and	  */
+/*	Wanner, Solving Ordinary Differential Equations I, routine DOPRI5.		  */
+/******************************************************************************/
+namespace {
+const double c2 = 1./5, c3 = 3./10, c4 = 4./5, c5 = 8./9;
+const double a21 = 1./5;
+const double a31 = 3./40,		a32 = 9./40;
+const double a41 = 44./45,		a42 = -56./15,		a43 = 32./9;
+const double a51 = 19372./6561,	a52 = -25360./2187,	a53 = 64448./6561,	a54 = -212./729;
+const double a61 = 9017./3168,	a62 = -355./33,		a63 = 46732./5247,	a64 = 49./176,
+             a65 = -5103./18656;
+const double a71 = 35./384,		a73 = 500./1113,	a74 = 125./192,		a75 = -2187./6784,
+             a76 = 11./84;
+const double e1 = 71./57600,	e3 = -71./16695,	e4 = 71./1920,		e5 = -17253./339200,
+             e6 = 22./525,		e7 = -1./40;
+const double d1 = -12715105075./11282082432,	d3 = 87487479700./32700410799,
+             d4 = -10690763975./1880347072,		d5 = 701980252875./199316789632,
+             d6 = -1453857185./822651844,		d7 = 69997945./29380423;
+}
+
+/******************************************************************************/
+/*									Constructor								  */
+/******************************************************************************/
+Dormand_Prince::Dormand_Prince(Cortical_Column& C, const Simulation_Settings& Settings)
+    : Cortex (&C)
+    , dt (Settings.dt)
+    , rtol (Settings.tolerance)
+    , atol (Settings.tolerance)
+    , h_min (1E-6*Settings.dt)
+    , h (Settings.dt)
+{
+    input = Cortex->input;
+    restart();
+}
+
+/******************************************************************************/
+/*								Column interface							  */
+/******************************************************************************/
+void Dormand_Prince::read_column(State& y) const {
+    y = Cortex->Stepper.state();
+}
+
+void Dormand_Prince::write_column(const State& y) {
+    Cortex->Stepper.state() = y;
+}
+
+void Dormand_Prince::rhs(const State& y, State& dydt) {
+    Cortex->derivatives(y.data(), dydt.data());
+    ++numEvaluations;
+}
+
+/******************************************************************************/
+/*								Time stepping								  */
+/******************************************************************************/
+void Dormand_Prince::restart(void) {
+    t0		= grid * dt;
+    t1		= t0;
+    h_last	= 0;
+    read_column(y1);
+    rhs(y1, k1);
+}
+
+void Dormand_Prince::step(void) {
+    /* The input changed at the current grid point */
+    if (Cortex->input != input) {
+        input = Cortex->input;
+        restart();
+    }
+
+    /* Integrate until the next grid point is covered */
+    ++grid;
+    const double t = grid * dt;
+    while (t1 < t - 1E-9*dt) {
+        if (!integrate()) {
+            /* The column still holds the previous grid point */
+            Cortex->iterate_ODE();
+            h = dt;
+            restart();
+            ++numFallbacks;
+            return;
+        }
+    }
+
+    /* Dense output at the grid point */
+    const double theta	= (t - t0)/h_last;
+    const double theta1	= 1 - theta;
+    State y;
+    for (unsigned i=0; i < M; ++i) {
+        y[i] = dense[0][i] + theta*(dense[1][i] + theta1*(dense[2][i] +
+               theta*(dense[3][i] + theta1*dense[4][i])));
+    }
+    write_column(y);
+}
+
+bool Dormand_Prince::integrate(void) {
+    State k2, k3, k4, k5, k6, k7, y, y_new;
+    while (true) {
+        for (unsigned i=0; i < M; ++i) {
+            y[i] = y1[i] + h*a21*k1[i];
+        }
+        rhs(y, k2);
+        for (unsigned i=0; i < M; ++i) {
+            y[i] = y1[i] + h*(a31*k1[i] + a32*k2[i]);
+        }
+        rhs(y, k3);
+        for (unsigned i=0; i < M; ++i) {
+            y[i] = y1[i] + h*(a41*k1[i] + a42*k2[i] + a43*k3[i]);
+        }
+        rhs(y, k4);
+        for (unsigned i=0; i < M; ++i) {
+            y[i] = y1[i] + h*(a51*k1[i] + a52*k2[i] + a53*k3[i] + a54*k4[i]);
+        }
+        rhs(y, k5);
+        for (unsigned i=0; i < M; ++i) {
+            y[i] = y1[i] + h*(a61*k1[i] + a62*k2[i] + a63*k3[i] + a64*k4[i] + a65*k5[i]);
+        }
+        rhs(y, k6);
+        for (unsigned i=0; i < M; ++i) {
+            y_new[i] = y1[i] + h*(a71*k1[i] + a73*k3[i] + a74*k4[i] + a75*k5[i] + a76*k6[i]);
+        }
+        rhs(y_new, k7);
+
+        /* Scaled RMS norm of the local error */
+        double error = 0;
+        for (unsigned i=0; i < M; ++i) {
+            const double e		= h*(e1*k1[i] + e3*k3[i] + e4*k4[i] + e5*k5[i] + e6*k6[i] + e7*k7[i]);
+            const double scale	= atol + rtol*std::max(std::abs(y1[i]), std::abs(y_new[i]));
+            error += (e/scale)*(e/scale);
+        }
+        error = std::sqrt(error/M);
+        if (!std::isfinite(error)) {
+            return false;
+        }
+
+        /* New step size with safety factor, limited to [0.2, 5] times h */
+        const double factor = error == 0 ? 5 : std::min(5., std::max(0.2, 0.9*std::pow(error, -0.2)));
+        if (error <= 1) {
+            /* Dense output of the accepted step */
+            for (unsigned i=0; i < M; ++i) {
+                const double ydiff	= y_new[i] - y1[i];
+                const double bspl	= h*k1[i] - ydiff;
+                dense[0][i] = y1[i];
+                dense[1][i] = ydiff;
+                dense[2][i] = bspl;
+                dense[3][i] = ydiff - h*k7[i] - bspl;
+                dense[4][i] = h*(d1*k1[i] + d3*k3[i] + d4*k4[i] + d5*k5[i] + d6*k6[i] + d7*k7[i]);
+            }
+            t0		= t1;
+            t1	   += h;
+            h_last	= h;
+            y1		= y_new;
+            k1		= k7;
+            h	   *= factor;
+            ++numSteps;
+            return true;
+        }
+        h *= factor;
+        if (h < h_min) {
+            return false;
+        }
+    }
+}
@@ -0,0 +1,108 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*				Adaptive integration of noise free columns					  */
+/*																			  */
+/*	Without noise (dphi == 0) the column is a deterministic ODE that is		  */
+/*	integrated with the embedded Runge-Kutta scheme of Dormand and Prince	  */
+/*	5(4) with step size control. The simulation loop still advances on the	  */
+/*	grid of dt with step(): the state at the grid points is taken from the	  */
+/*	4th order dense output, so that stimulation and recording work as with	  */
+/*	iterate_ODE. Large steps are only evaluated, not recomputed.			  */
+/*																			  */
+/*	The input of the stimulation is a discontinuity. When it changes between */
+/*	two calls of step() the integration is restarted at that grid point.	  */
+/*																			  */
+/*	The SRK4 scheme draws noise of standard deviation dt even for dphi == 0, */
+/*	which is dropped here.													  */
+/*																			  */
+/*	If the error estimate is not finite or the step size falls below h_min	  */
+/*	the grid step is done with iterate_ODE instead and the integration is	  */
+/*	restarted from there.													  */
+/******************************************************************************/
+#pragma once
+#include <array>
+
+#include "Cortical_Column.h"
+#include "Simulation_Settings.h"
+
+class Dormand_Prince {
+public:
+    Dormand_Prince(Cortical_Column& C, const Simulation_Settings& Settings);
+
+    /* Whether the column is noise free and the tolerance is set */
+    static bool	applicable	(const Cortical_Column& C, const Simulation_Settings& Settings) {
+        return C.dphi == 0 && Settings.tolerance > 0;
+    }
+
+    /* Advances the column by dt, replaces Cortical_Column::iterate_ODE */
+    void		step		(void);
+
+    /* Number of evaluations of the vector field, of accepted steps and of grid
+     * steps that fell back to iterate_ODE */
+    unsigned long	evaluations	(void) const {return numEvaluations;}
+    unsigned long	steps		(void) const {return numSteps;}
+    unsigned long	fallbacks	(void) const {return numFallbacks;}
+private:
+    static constexpr unsigned		M = Cortical_Column::numStates;
+    typedef std::array<double, M>	State;
+
+    /* Copy between the column and the state */
+    void	read_column		(State& y) const;
+    void	write_column	(const State& y);
+
+    /* Restarts the integration from the state of the column at the grid */
+    void	restart			(void);
+
+    /* Takes the next accepted step from t1, sets up the dense output. Returns
+     * false if no step with a finite error above h_min is accepted */
+    bool	integrate		(void);
+    void	rhs				(const State& y, State& dydt);
+
+    Cortical_Column*	Cortex;
+    const double		dt;
+    const double		rtol;
+    const double		atol;
+    const double		h_min;
+
+    /* Number of grid steps done and input during the last one */
+    unsigned long		grid	= 0;
+    double				input	= 0;
+
+    /* Last accepted step [t0, t1], its size and the dense output */
+    double				t0		= 0;
+    double				t1		= 0;
+    double				h_last	= 0;
+    std::array<State, 5>	dense;
+
+    /* State and derivative at t1 and size of the next step */
+    State				y1;
+    State				k1;
+    double				h;
+
+    unsigned long		numEvaluations	= 0;
+    unsigned long		numSteps		= 0;
+    unsigned long		numFallbacks	= 0;
+};
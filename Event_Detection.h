@@ -0,0 +1,179 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ *
+ *	Based on:	Characterization of K-Complexes and Slow Wave Activity in a Neural Mass Model
+ *				A Weigenand, M Schellenberger Costa, H-VV Ngo, JC Claussen, T Martinetz
+ *				PLoS Computational Biology. 2014;10:e1003923
+ */
+
+/******************************************************************************/
+/*				Online detection of down states and K-complexes				  */
+/******************************************************************************/
+#pragma once
+#include <vector>
+
+/******************************************************************************/
+/*						Threshold crossing and minimum search				  */
+/*	Used by the phase dependent stimulation: once Vp falls below threshold	  */
+/*	the first minimum afterwards is searched.								  */
+/******************************************************************************/
+class Trough_Search {
+public:
+    explicit Trough_Search(double threshold = -72) : threshold(threshold) {}
+
+    /* Searches for a threshold crossing if armed and for the minimum after a
+     * crossing. Returns true in the step after the minimum */
+    bool check (double Vp, bool armed) {
+        /* Search for threshold */
+        if (armed && !threshold_crossed) {
+            if (Vp <= threshold) {
+                threshold_crossed 	= true;
+            }
+        }
+
+        /* Search for minimum */
+        if (threshold_crossed) {
+            if (Vp > Vp_old) {
+                threshold_crossed 	= false;
+                minimum				= Vp_old;
+                Vp_old 				= 0;
+                return true;
+            } else {
+                Vp_old = Vp;
+            }
+        }
+        return false;
+    }
+
+    bool 	crossed		(void) const {return threshold_crossed;}
+    double	trough		(void) const {return minimum;}
+
+    /* Progress of the search, to continue it in a restored simulation */
+    double	last		(void) const {return Vp_old;}
+    void	restore		(bool crossed, double last, double trough) {
+        threshold_crossed	= crossed;
+        Vp_old				= last;
+        minimum				= trough;
+    }
+
+    /* Threshold for the detection */
+    double 	threshold;
+private:
+    /* If threshold has been reached */
+    bool 	threshold_crossed	= false;
+
+    /* Old voltage value for minimum detection */
+    double 	Vp_old				= 0;
+
+    /* Value of the last minimum */
+    double	minimum				= 0;
+};
+
+/******************************************************************************/
+/*								Event detector								  */
+/*	An event starts when Vp falls below threshold and ends when it rises	  */
+/*	above threshold + hysteresis. The trough is the minimum in between.		  */
+/*	Events are kept if their duration is within [min_duration, max_duration] */
+/*	and the trough is below amplitude. Work and memory per sample are O(1).   */
+/******************************************************************************/
+struct Event {
+    double	onset;				/* Time of the threshold crossing in s	*/
+    double	trough_time;		/* Time of the minimum in s				*/
+    double	trough_amplitude;	/* Minimum of Vp in mV					*/
+    double	duration;			/* Time below threshold + hysteresis in s	*/
+};
+
+class Event_Detector {
+public:
+    /* fs is the rate in Hz with which samples are added */
+    explicit Event_Detector(double fs,
+                            double threshold	= -72,
+                            double hysteresis	= 5,
+                            double amplitude	= -75,
+                            double min_duration	= 0.1,
+                            double max_duration	= 2.0)
+    : dt (1/fs)
+    , search (threshold)
+    , hysteresis (hysteresis)
+    , amplitude (amplitude)
+    , min_duration (min_duration)
+    , max_duration (max_duration)
+    {}
+
+    /* Add the next sample of Vp */
+    void add (double Vp) {
+        const bool was_crossed = search.crossed();
+        search.check(Vp, !in_event);
+
+        /* Start of a new event */
+        if (!in_event && search.crossed() && !was_crossed) {
+            in_event	= true;
+            onset		= count;
+            trough		= Vp;
+            trough_time	= count;
+        }
+
+        if (in_event) {
+            if (Vp < trough) {
+                trough		= Vp;
+                trough_time	= count;
+            }
+
+            /* End of the event */
+            if (Vp >= search.threshold + hysteresis) {
+                const double duration = (count - onset) * dt;
+                if (duration >= min_duration &&
+                    duration <= max_duration &&
+                    trough   <= amplitude) {
+                    event_table.push_back(Event{onset*dt, trough_time*dt, trough, duration});
+                }
+                in_event = false;
+            }
+        }
+        ++count;
+    }
+
+    const std::vector<Event>& events (void) const {return event_table;}
+private:
+    /* Duration of a sample in s */
+    const double		dt;
+
+    /* Threshold crossing shared with the stimulation protocol */
+    Trough_Search		search;
+
+    /* Criteria of an event */
+    const double		hysteresis;
+    const double		amplitude;
+    const double		min_duration;
+    const double		max_duration;
+
+    /* State of the current event in samples */
+    bool				in_event	= false;
+    unsigned long		count		= 0;
+    unsigned long		onset		= 0;
+    unsigned long		trough_time	= 0;
+    double				trough		= 0;
+
+    /* Detected events */
+    std::vector<Event>	event_table;
+};
@@ -10,7 +10,7 @@ cd ..;
 
 % Check if the executable exists and compile if needed
 if(exist('Cortex_mex.mesa64', 'file')==0)
-    mex CXXFLAGS="\$CXXFLAGS -std=c++11 -O3" Cortex_mex.cpp Cortical_Column.cpp;
+    mex CXXFLAGS="\$CXXFLAGS -std=c++11 -O3" Cortex_mex.cpp Column_Session.cpp Cortex_Model.cpp Cortical_Column.cpp Dormand_Prince.cpp Warm_Start.cpp;
 end
 
 % Add the path to the simulation routine
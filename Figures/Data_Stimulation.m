@@ -39,10 +39,14 @@ T     = 4;
 Ve_N2 = cell(N,1);
 Ve_N3 = cell(N,1);
 
+% The columns are noise free, so all runs start from the same state after the
+% onset, which is computed once (warm start without decorrelation time)
+warm = 0;
+
 for i=1:N 
     var_stim(2)= i*10;
-    [Ve_N2{i}, ~]    = Cortex_mex(T, Param_N2, var_stim);
-    [Ve_N3{i}, ~]    = Cortex_mex(T, Param_N3, var_stim);
+    [Ve_N2{i}, ~]    = Cortex_mex(T, Param_N2, var_stim, warm);
+    [Ve_N3{i}, ~]    = Cortex_mex(T, Param_N3, var_stim, warm);
 end
 
 save('Data/Stimulation.mat', 'Ve_N2', 'Ve_N3');
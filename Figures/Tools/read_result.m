@@ -0,0 +1,30 @@
+function varargout = read_result(file_name)
+% Reads the result of a job written by nm_cortex (see Job_File.h).
+%
+% The outputs are the same as the ones of Cortex_mex, one 1 x N row per
+% recorded channel in the order of the job file, followed by the marker:
+%   [Vp, s_ep, marker] = read_result('out/job_0.bin');
+
+fid = fopen(file_name, 'r');
+if fid < 0
+    error('read_result: could not open %s', file_name);
+end
+
+magic = fread(fid, 8, '*char')';
+if ~strcmp(magic, 'NMRESULT')
+    fclose(fid);
+    error('read_result: %s is not a result file', file_name);
+end
+
+channels = fread(fid, 1, 'uint32');
+markers  = fread(fid, 1, 'uint32');
+samples  = fread(fid, 1, 'uint64');
+fread(fid, channels, 'uint32');
+
+varargout = cell(1, channels+1);
+for i = 1:channels
+    varargout{i} = fread(fid, [1 samples], 'double');
+end
+varargout{channels+1} = fread(fid, [1 markers], 'double');
+fclose(fid);
+end
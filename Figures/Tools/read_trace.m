@@ -0,0 +1,44 @@
+function [Data, Info] = read_trace(file_name)
+% Reads a trace file written by Trace_Writer (see Trace_Writer.h).
+%
+% Data is a C x N matrix with one row per channel. Info contains dt, res, red,
+% the parameters stored in the header and the channel names. Only the samples
+% that are already complete are read, so the function can be called while the
+% simulation is still running.
+%
+% For very long simulations memory mapping avoids loading the whole file:
+%   [~, Info] = read_trace(file_name);
+%   m = memmapfile(file_name, 'Offset', Info.header_size, ...
+%                  'Format', {'double', [Info.channels Info.samples], 'x'});
+
+fid = fopen(file_name, 'r');
+if fid < 0
+    error('read_trace: could not open %s', file_name);
+end
+
+magic = fread(fid, 8, '*char')';
+if ~strncmp(magic, 'NMTRACE', 7)
+    fclose(fid);
+    error('read_trace: %s is not a trace file', file_name);
+end
+
+Info.version     = fread(fid, 1, 'uint32');
+Info.header_size = fread(fid, 1, 'uint32');
+Info.channels    = fread(fid, 1, 'uint32');
+num_params       = fread(fid, 1, 'uint32');
+Info.dt          = fread(fid, 1, 'double');
+Info.res         = fread(fid, 1, 'uint32');
+Info.red         = fread(fid, 1, 'uint32');
+Info.samples     = fread(fid, 1, 'uint64');
+Info.parameters  = fread(fid, num_params, 'double');
+
+Info.names = cell(Info.channels, 1);
+for i = 1:Info.channels
+    name = fread(fid, 32, '*char')';
+    Info.names{i} = name(1:find([name char(0)] == char(0), 1) - 1);
+end
+
+fseek(fid, Info.header_size, 'bof');
+Data = fread(fid, [Info.channels Info.samples], 'double');
+fclose(fid);
+end
@@ -0,0 +1,200 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*					Instrumentation of the simulation loop					  */
+/*																			  */
+/*	Compiled in with INSTRUMENTATION=1 (e.g. DEFINES += INSTRUMENTATION=1 in */
+/*	NM_Cortex.pro). Otherwise the macros below are empty and cost nothing.	  */
+/*																			  */
+/*	INSTRUMENT_SCOPE(id) measures the cycles until the end of the scope and  */
+/*	INSTRUMENT_COUNT(id) counts an event. Every thread accumulates into its	  */
+/*	own thread_local counters without locking. They are merged into the		  */
+/*	global totals when the thread ends or when a report is created.			  */
+/*																			  */
+/*	Cycles are read from the time stamp counter on x86 and are nanoseconds	  */
+/*	of the steady clock elsewhere.											  */
+/******************************************************************************/
+#pragma once
+
+#ifndef INSTRUMENTATION
+#define INSTRUMENTATION 0
+#endif
+
+namespace Instrumentation {
+/* Measured parts of a step */
+enum Timer {
+    STEP,			/* iterate_ODE							*/
+    SET_RK_0,		/* set_RK, one timer per stage			*/
+    SET_RK_1,
+    SET_RK_2,
+    SET_RK_3,
+    ADD_RK,			/* add_RK including the noise refill	*/
+    NOISE,			/* refill of the noise block			*/
+    CHECK_STIM,		/* Stim::check_stim						*/
+    GET_DATA,		/* recording of a sample				*/
+    NUM_TIMERS
+};
+
+/* Counted events */
+enum Counter {
+    STIM_ON,		/* stimulation switched on				*/
+    STIM_OFF,		/* stimulation switched off				*/
+    SAMPLES,		/* recorded samples						*/
+    NUM_COUNTERS
+};
+}
+
+#if INSTRUMENTATION
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace Instrumentation {
+inline uint64_t cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct Totals {
+    uint64_t calls	[NUM_TIMERS]	= {};
+    uint64_t cycles	[NUM_TIMERS]	= {};
+    uint64_t events	[NUM_COUNTERS]	= {};
+
+    void add (const Totals& other) {
+        for (unsigned i=0; i < NUM_TIMERS; ++i) {
+            calls [i] += other.calls [i];
+            cycles[i] += other.cycles[i];
+        }
+        for (unsigned i=0; i < NUM_COUNTERS; ++i) {
+            events[i] += other.events[i];
+        }
+    }
+};
+
+/* Totals of the threads that have ended */
+inline Totals& global_totals(void) {
+    static Totals totals;
+    return totals;
+}
+
+inline std::mutex& global_lock(void) {
+    static std::mutex lock;
+    return lock;
+}
+
+/* Counters of a thread, merged into the global totals when the thread ends */
+struct Thread_Totals : Totals {
+    ~Thread_Totals() {
+        std::lock_guard<std::mutex> guard(global_lock());
+        global_totals().add(*this);
+    }
+};
+
+inline Thread_Totals& local(void) {
+    static thread_local Thread_Totals totals;
+    return totals;
+}
+
+class Scoped_Timer {
+public:
+    explicit Scoped_Timer(unsigned id) : id(id), start(cycles()) {}
+    ~Scoped_Timer() {
+        Totals& totals = local();
+        totals.cycles[id] += cycles() - start;
+        ++totals.calls[id];
+    }
+private:
+    const unsigned id;
+    const uint64_t start;
+};
+
+inline void count(unsigned id, uint64_t n = 1) {
+    local().events[id] += n;
+}
+
+/* Clears the totals of ended threads and of the calling thread */
+inline void reset(void) {
+    std::lock_guard<std::mutex> guard(global_lock());
+    global_totals() = Totals();
+    static_cast<Totals&>(local()) = Totals();
+}
+
+/* Summary of the ended threads and the calling thread. Shares are relative
+ * to the cycles spent in iterate_ODE */
+inline std::string report(void) {
+    Totals totals;
+    {
+        std::lock_guard<std::mutex> guard(global_lock());
+        totals = global_totals();
+    }
+    totals.add(local());
+
+    static const char* timer_names[NUM_TIMERS] = {
+        "iterate_ODE", "set_RK_0", "set_RK_1", "set_RK_2", "set_RK_3",
+        "add_RK", "noise refill", "check_stim", "get_data"};
+    static const char* counter_names[NUM_COUNTERS] = {
+        "stimulation on", "stimulation off", "recorded samples"};
+
+    std::string summary;
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-16s %14s %18s %12s %8s\n",
+                  "part", "calls", "cycles", "mean", "share");
+    summary += line;
+    const double step = totals.cycles[STEP] ? double(totals.cycles[STEP]) : 1.0;
+    for (unsigned i=0; i < NUM_TIMERS; ++i) {
+        const uint64_t calls = totals.calls[i];
+        std::snprintf(line, sizeof(line), "%-16s %14llu %18llu %12.1f %7.1f%%\n",
+                      timer_names[i], (unsigned long long) calls,
+                      (unsigned long long) totals.cycles[i],
+                      calls ? double(totals.cycles[i])/calls : 0.0,
+                      100*totals.cycles[i]/step);
+        summary += line;
+    }
+    for (unsigned i=0; i < NUM_COUNTERS; ++i) {
+        std::snprintf(line, sizeof(line), "%-16s %14llu\n", counter_names[i],
+                      (unsigned long long) totals.events[i]);
+        summary += line;
+    }
+    return summary;
+}
+}
+
+#define INSTRUMENT_CONCAT_(a, b)	a##b
+#define INSTRUMENT_CONCAT(a, b)		INSTRUMENT_CONCAT_(a, b)
+#define INSTRUMENT_SCOPE(id)		Instrumentation::Scoped_Timer INSTRUMENT_CONCAT(instrument_, __LINE__)(id)
+#define INSTRUMENT_COUNT(id)		Instrumentation::count(id)
+#else
+#define INSTRUMENT_SCOPE(id)
+#define INSTRUMENT_COUNT(id)
+#endif
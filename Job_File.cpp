@@ -0,0 +1,140 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+
+/******************************************************************************/
+/*						Functions of the job file handling					  */
+/******************************************************************************/
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "Job_File.h"
+
+/* Names of the channels in the order of get_data */
+static const char* channel_names[6] = {"Vp", "Vi", "s_ep", "s_ei", "s_gp", "s_gi"};
+
+/******************************************************************************/
+/*									Parsing									  */
+/******************************************************************************/
+static bool parse_channels(const std::string& list, std::vector<unsigned>& channels) {
+    if (list == "all") {
+        channels = {0, 1, 2, 3, 4, 5};
+        return true;
+    }
+    std::stringstream stream(list);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+        unsigned i = 0;
+        while (i < 6 && name != channel_names[i]) {
+            ++i;
+        }
+        if (i == 6) {
+            return false;
+        }
+        channels.push_back(i);
+    }
+    return !channels.empty();
+}
+
+bool read_job_file(const std::string& path, std::vector<Job_Entry>& entries,
+                   std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "could not open " + path;
+        return false;
+    }
+
+    std::string line;
+    unsigned line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        line = line.substr(0, line.find('#'));
+        std::stringstream stream(line);
+
+        /* Skip empty lines */
+        std::string first;
+        if (!(stream >> first)) {
+            continue;
+        }
+        stream.clear();
+        stream.str(line);
+
+        Job_Entry entry;
+        entry.job.Param_Cortex.resize(3);
+        entry.job.var_stim.resize(8);
+        entry.job.id = 0;
+        std::string channels, rest;
+        stream >> entry.job.T;
+        for (auto& p : entry.job.Param_Cortex) {
+            stream >> p;
+        }
+        for (auto& v : entry.job.var_stim) {
+            stream >> v;
+        }
+        stream >> entry.job.seed >> channels;
+        if (!stream || (stream >> rest) || entry.job.T <= 0) {
+            error = path + ":" + std::to_string(line_number) +
+                    ": expected T, 3 parameters, 8 stimulation values, seed and channels";
+            return false;
+        }
+        if (!parse_channels(channels, entry.channels)) {
+            error = path + ":" + std::to_string(line_number) +
+                    ": unknown channel in " + channels;
+            return false;
+        }
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+/******************************************************************************/
+/*									Output									  */
+/******************************************************************************/
+bool write_job_result(const std::string& path, const Job_Entry& entry,
+                      Sweep_Result& result) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    const uint32_t numChannels	= entry.channels.size();
+    const uint32_t numMarkers	= result.marker.size();
+    const uint64_t samples		= result.data.size()/6;
+
+    std::fwrite("NMRESULT", 1, 8, file);
+    std::fwrite(&numChannels, 4, 1, file);
+    std::fwrite(&numMarkers,  4, 1, file);
+    std::fwrite(&samples,	  8, 1, file);
+    for (unsigned channel : entry.channels) {
+        const uint32_t index = channel;
+        std::fwrite(&index, 4, 1, file);
+    }
+    for (unsigned channel : entry.channels) {
+        std::fwrite(result.channel(channel), sizeof(double), samples, file);
+    }
+    std::fwrite(result.marker.data(), sizeof(double), numMarkers, file);
+
+    const bool success = !std::ferror(file);
+    return (std::fclose(file) == 0) && success;
+}
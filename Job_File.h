@@ -0,0 +1,65 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+
+/******************************************************************************/
+/*							Job files of the batch runner					  */
+/*																			  */
+/*	A job file lists one simulation per line, empty lines and everything	  */
+/*	after a # are ignored. The entries are separated by white space:		  */
+/*																			  */
+/*	T  sigma_p g_KNa dphi  var_stim[0..7]  seed  channels					  */
+/*																			  */
+/*	T is the duration in s, the three parameters and the eight stimulation	  */
+/*	values are the same as the inputs of Cortex_mex. channels is a comma	  */
+/*	separated list of Vp, Vi, s_ep, s_ei, s_gp, s_gi or "all".				  */
+/*																			  */
+/*	Results are written into one file per job, containing the recorded		  */
+/*	channels as rows and the stimulation marker, as returned by Cortex_mex.	  */
+/*	The layout of the file (native byte order, as read_result.m expects on	  */
+/*	the same machine) is													  */
+/*																			  */
+/*	char[8] "NMRESULT", uint32 channels, uint32 markers, uint64 samples,	  */
+/*	uint32[channels] channel index, double[channels][samples] data,			  */
+/*	double[markers] marker													  */
+/******************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Parameter_Sweep.h"
+
+struct Job_Entry {
+    Sweep_Job				job;
+    std::vector<unsigned>	channels;	/* Recorded channels in the order of get_data */
+};
+
+/* Reads all jobs of the file. Returns false and a description of the first
+ * error (including the line number) if the file could not be parsed */
+bool read_job_file		(const std::string& path, std::vector<Job_Entry>& entries,
+                         std::string& error);
+
+/* Writes the selected channels and the marker of a finished job */
+bool write_job_result	(const std::string& path, const Job_Entry& entry,
+                         Sweep_Result& result);
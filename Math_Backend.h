@@ -0,0 +1,235 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*				Transcendental functions of the firing rates				  */
+/*																			  */
+/*	The sigmoid firing rates need exp() and the KNa activation needs		  */
+/*	pow(x, 3.5). The implementation is chosen at compile time by defining	  */
+/*	MATH_BACKEND (e.g. DEFINES += MATH_BACKEND=1 in NM_Cortex.pro):			  */
+/*																			  */
+/*	MATH_LIBM	(0, default) calls std::exp and std::pow, so results are	  */
+/*				identical to a build without this header.					  */
+/*	MATH_POLY	(1) Cody-Waite range reduction and a degree 13 polynomial.	  */
+/*				The code is branch free, so loops over columns are 			  */
+/*				vectorized (2 lanes SSE2, 4 lanes AVX2, 8 lanes AVX-512).	  */
+/*				Maximal relative error of exp is 3E-16 on [-700, 700].		  */
+/*	MATH_TABLE	(2) 2^f is tabulated with 256 intervals on [-0.5, 0.5] and	  */
+/*				linearly interpolated. Maximal relative error of exp is 1E-6. */
+/*																			  */
+/*	For MATH_POLY and MATH_TABLE x^3.5 is computed as x*x*x*sqrt(x), which   */
+/*	has a maximal relative error of 5E-16 and vectorizes as well.			  */
+/*																			  */
+/*	The single precision batch (see Cortical_Column_Batch.h) uses float		  */
+/*	versions: expf and powf for MATH_LIBM and a degree 7 polynomial with a	  */
+/*	maximal relative error of 2E-7 for MATH_POLY and MATH_TABLE.			  */
+/*	Math_Check.cpp measures these errors and the long run statistics.		  */
+/******************************************************************************/
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#define MATH_LIBM	0
+#define MATH_POLY	1
+#define MATH_TABLE	2
+
+#ifndef MATH_BACKEND
+#define MATH_BACKEND MATH_LIBM
+#endif
+
+/******************************************************************************/
+/*								Helper functions							  */
+/******************************************************************************/
+/* Splits x*log2(e) into the nearest integer k and returns 2^k. Adding 1.5*2^52
+ * rounds to an integer that is then found in the lowest mantissa bits */
+inline double exp_split(double x, double& k) {
+    const double shift = 6755399441055744.0;
+    const double t = x * 1.4426950408889634074 + shift;
+    k = t - shift;
+
+    uint64_t bits;
+    std::memcpy(&bits, &t, sizeof(bits));
+    bits = (bits << 52) + (uint64_t(1023) << 52);
+
+    double scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return scale;
+}
+
+/* Clamp the argument to the range where 2^k is a normal number */
+inline double exp_clamp(double x) {
+    x = x < -700.0 ? -700.0 : x;
+    x = x >  700.0 ?  700.0 : x;
+    return x;
+}
+
+/******************************************************************************/
+/*								Exponential function						  */
+/******************************************************************************/
+inline double exp_libm(double x) {
+    return std::exp(x);
+}
+
+inline double exp_poly(double x) {
+    /* ln(2) split into a part exact in double and the remainder */
+    const double ln2_hi = 6.93147180369123816490E-1;
+    const double ln2_lo = 1.90821492927058770002E-10;
+
+    double k;
+    x = exp_clamp(x);
+    const double scale = exp_split(x, k);
+    const double r = (x - k*ln2_hi) - k*ln2_lo;
+
+    /* Taylor polynomial of degree 13 for |r| <= ln(2)/2 */
+    double p = 1.0/6227020800;
+    p = p*r + 1.0/479001600;
+    p = p*r + 1.0/39916800;
+    p = p*r + 1.0/3628800;
+    p = p*r + 1.0/362880;
+    p = p*r + 1.0/40320;
+    p = p*r + 1.0/5040;
+    p = p*r + 1.0/720;
+    p = p*r + 1.0/120;
+    p = p*r + 1.0/24;
+    p = p*r + 1.0/6;
+    p = p*r + 0.5;
+    p = p*r + 1.0;
+    p = p*r + 1.0;
+    return scale * p;
+}
+
+/* Table of 2^f on [-0.5, 0.5] */
+template <unsigned Size>
+struct Exp_Table {
+    static std::array<double, Size+2> create(void) {
+        std::array<double, Size+2> table;
+        for (unsigned i=0; i < Size+2; ++i) {
+            table[i] = std::exp2(-0.5 + double(i)/Size);
+        }
+        return table;
+    }
+    static const std::array<double, Size+2> data;
+};
+
+template <unsigned Size>
+const std::array<double, Size+2> Exp_Table<Size>::data = Exp_Table<Size>::create();
+
+inline double exp_table(double x) {
+    const unsigned Size = 256;
+
+    double k;
+    x = exp_clamp(x);
+    const double scale	= exp_split(x, k);
+    const double f		= (x * 1.4426950408889634074 - k + 0.5) * Size;
+    const unsigned j	= (unsigned) f;
+    const double w		= f - j;
+
+    const std::array<double, Size+2>& table = Exp_Table<Size>::data;
+    return scale * (table[j] + w * (table[j+1] - table[j]));
+}
+
+/* Single precision version with the split of Cephes and a degree 7 Taylor
+ * polynomial, the rounding of 1.5*2^23 gives the integer k */
+inline float exp_poly(float x) {
+    const float ln2_hi = 0.693359375f;
+    const float ln2_lo = -2.12194440E-4f;
+    const float shift  = 12582912.0f;
+
+    x = x < -87.0f ? -87.0f : x;
+    x = x >  87.0f ?  87.0f : x;
+    const float t = x * 1.44269504f + shift;
+    const float k = t - shift;
+
+    uint32_t bits;
+    std::memcpy(&bits, &t, sizeof(bits));
+    bits = (bits << 23) + (uint32_t(127) << 23);
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+
+    const float r = (x - k*ln2_hi) - k*ln2_lo;
+    float p = 1.0f/5040;
+    p = p*r + 1.0f/720;
+    p = p*r + 1.0f/120;
+    p = p*r + 1.0f/24;
+    p = p*r + 1.0f/6;
+    p = p*r + 0.5f;
+    p = p*r + 1.0f;
+    p = p*r + 1.0f;
+    return scale * p;
+}
+
+/******************************************************************************/
+/*							Power function x^3.5							  */
+/******************************************************************************/
+inline double pow_35_libm(double x) {
+    return std::pow(x, 3.5);
+}
+
+inline double pow_35_sqrt(double x) {
+    return x*x*x*std::sqrt(x);
+}
+
+inline float pow_35_sqrt(float x) {
+    return x*x*x*std::sqrt(x);
+}
+
+/******************************************************************************/
+/*							Selected implementation							  */
+/******************************************************************************/
+#if MATH_BACKEND == MATH_POLY
+inline double math_exp		(double x) {return exp_poly(x);}
+inline double math_pow_35	(double x) {return pow_35_sqrt(x);}
+inline float  math_exp		(float x)  {return exp_poly(x);}
+inline float  math_pow_35	(float x)  {return pow_35_sqrt(x);}
+#define MATH_BACKEND_NAME "poly"
+#elif MATH_BACKEND == MATH_TABLE
+inline double math_exp		(double x) {return exp_table(x);}
+inline double math_pow_35	(double x) {return pow_35_sqrt(x);}
+inline float  math_exp		(float x)  {return exp_poly(x);}
+inline float  math_pow_35	(float x)  {return pow_35_sqrt(x);}
+#define MATH_BACKEND_NAME "table"
+#else
+inline double math_exp		(double x) {return exp_libm(x);}
+inline double math_pow_35	(double x) {return pow_35_libm(x);}
+inline float  math_exp		(float x)  {return std::exp(x);}
+inline float  math_pow_35	(float x)  {return std::pow(x, 3.5f);}
+#define MATH_BACKEND_NAME "libm"
+#endif
+
+/* Array versions that process n values at once, x and y may be equal */
+template <typename T>
+inline void math_exp (const T* x, T* y, unsigned n) {
+    for (unsigned i=0; i < n; ++i) {
+        y[i] = math_exp(x[i]);
+    }
+}
+
+template <typename T>
+inline void math_pow_35 (const T* x, T* y, unsigned n) {
+    for (unsigned i=0; i < n; ++i) {
+        y[i] = math_pow_35(x[i]);
+    }
+}
@@ -0,0 +1,185 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*				Accuracy check of the selected math backend					  */
+/*																			  */
+/*	1. Maximal relative error of every backend against libm on the argument	  */
+/*	   ranges that occur in the model.										  */
+/*	2. Long run statistics of Vp (mean, standard deviation, power spectrum)	  */
+/*	   for the N2 and N3 parameter sets with the backend selected at compile  */
+/*	   time. The statistics are written to Math_Check_<backend>.csv and		  */
+/*	   compared to Math_Check_libm.csv if that file exists, so the check is	  */
+/*	   run first with MATH_BACKEND=0 and then with the backend under test.	  */
+/******************************************************************************/
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Cortical_Column.h"
+#include "Data_Storage.h"
+
+/******************************************************************************/
+/*                          Fixed simulation settings						  */
+/******************************************************************************/
+const int T      		= 600;		/* Duration of the simulation in s		  */
+const Simulation_Settings Settings;	/* Resolution, onset and reduction		  */
+const int onset			= Settings.onset;
+const int res 			= Settings.res;
+const int red 			= Settings.red;
+
+/* Spectrum is evaluated on segments of 10 s between 0.1 and 30 Hz */
+const int		T_segment	= 10;
+const double	df			= 0.1;
+const int		N_freq		= 300;
+
+/******************************************************************************/
+/*							Error of the kernels							  */
+/******************************************************************************/
+template <typename F, typename G>
+double max_error(F f, G g, double lower, double upper, double step) {
+    double error = 0;
+    for (double x = lower; x <= upper; x += step) {
+        const double ref = g(x);
+        error = std::max(error, std::abs(f(x) - ref)/std::abs(ref));
+    }
+    return error;
+}
+
+/******************************************************************************/
+/*							Statistics of a run 							  */
+/******************************************************************************/
+std::vector<double> get_statistics(double* Param) {
+    const int samples	= res/red;
+    const double pi		= 3.14159265358979323846;
+
+    Cortical_Column Cortex(Param, Settings, 1);
+    std::vector<double> data(6);
+    std::vector<double*> pData;
+    for (auto& d : data) {
+        pData.push_back(&d);
+    }
+
+    std::vector<double> segment;
+    std::vector<double> psd(N_freq, 0.0);
+    double mean = 0, var = 0;
+    for (int t=0; t < (T+onset)*res; ++t) {
+        Cortex.iterate_ODE();
+        if(t >= onset*res && t%red == 0){
+            get_data(0, Cortex, pData);
+            segment.push_back(data[0]);
+            mean += data[0];
+            var  += data[0]*data[0];
+        }
+        if (segment.size() == (unsigned) T_segment*samples) {
+            /* Remove the mean of the segment */
+            double m = 0;
+            for (double v : segment) {
+                m += v;
+            }
+            m /= segment.size();
+
+            /* Periodogram at the chosen frequencies */
+            for (int k=0; k < N_freq; ++k) {
+                double re = 0, im = 0;
+                const double w = 2*pi*(k+1)*df/samples;
+                for (unsigned n=0; n < segment.size(); ++n) {
+                    re += (segment[n]-m)*std::cos(w*n);
+                    im += (segment[n]-m)*std::sin(w*n);
+                }
+                psd[k] += (re*re + im*im)/(segment.size()*samples) * T_segment/T;
+            }
+            segment.clear();
+        }
+    }
+    mean /= T*samples;
+    var   = var/(T*samples) - mean*mean;
+
+    std::vector<double> result = {mean, std::sqrt(var)};
+    result.insert(result.end(), psd.begin(), psd.end());
+    return result;
+}
+
+/******************************************************************************/
+/*                              Main routine								  */
+/******************************************************************************/
+int main(void) {
+    /* Kernel accuracy on the argument ranges of the model */
+    typedef double (*Kernel)(double);
+    typedef float (*Kernel_float)(float);
+    auto exp_float		= [](double x) {return (double) ((Kernel_float) exp_poly)((float) x);};
+    auto pow_35_float	= [](double x) {return (double) ((Kernel_float) pow_35_sqrt)((float) x);};
+    std::cout << "maximal relative error against libm\n";
+    std::cout << "exp   poly:  " << max_error((Kernel) exp_poly,  exp_libm, -50, 50, 1E-5) << "\n";
+    std::cout << "exp   table: " << max_error(exp_table, exp_libm, -50, 50, 1E-5) << "\n";
+    std::cout << "x^3.5 sqrt:  " << max_error((Kernel) pow_35_sqrt, pow_35_libm, 0.1, 50, 1E-5) << "\n";
+    std::cout << "single precision, relative to the rounded argument\n";
+    std::cout << "exp   poly:  " << max_error(exp_float, [](double x) {return exp_libm((float) x);}, -50, 50, 1E-5) << "\n";
+    std::cout << "x^3.5 sqrt:  " << max_error(pow_35_float, [](double x) {return pow_35_libm((float) x);}, 0.1, 50, 1E-5) << "\n";
+
+    /* Long run statistics with the compiled backend */
+    std::vector<double> Param_N2 = {4.6, 1.33, 2.0};
+    std::vector<double> Param_N3 = {6.5, 2.0,  2.0};
+    std::vector<std::vector<double>> stats = {get_statistics(Param_N2.data()),
+                                              get_statistics(Param_N3.data())};
+
+    const std::string name = std::string("Math_Check_") + MATH_BACKEND_NAME + ".csv";
+    std::ofstream output(name);
+    for (auto& s : stats) {
+        for (unsigned i=0; i < s.size(); ++i) {
+            output << s[i] << (i+1 < s.size() ? "," : "\n");
+        }
+    }
+    output.close();
+    std::cout << "backend " << MATH_BACKEND_NAME << " written to " << name << "\n";
+
+    /* Compare to the libm reference */
+    std::ifstream reference("Math_Check_libm.csv");
+    if (MATH_BACKEND == MATH_LIBM || !reference.good()) {
+        return 0;
+    }
+    const char* label[] = {"N2", "N3"};
+    for (unsigned j=0; j < stats.size(); ++j) {
+        std::vector<double> ref;
+        std::string value;
+        for (unsigned i=0; i < stats[j].size(); ++i) {
+            std::getline(reference, value, i+1 < stats[j].size() ? ',' : '\n');
+            ref.push_back(std::atof(value.c_str()));
+        }
+
+        /* Relative deviation of the spectrum in the 0.1-4 Hz range */
+        double psd_dev = 0, psd_ref = 0;
+        for (int k=0; k < 40; ++k) {
+            psd_dev += std::abs(stats[j][k+2] - ref[k+2]);
+            psd_ref += ref[k+2];
+        }
+        std::cout << label[j] << ": mean Vp " << stats[j][0] << " (libm " << ref[0] << ")"
+                  << ", std Vp " << stats[j][1] << " (libm " << ref[1] << ")"
+                  << ", relative PSD deviation below 4 Hz " << psd_dev/psd_ref << "\n";
+    }
+    return 0;
+}
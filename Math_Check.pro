@@ -0,0 +1,26 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+TARGET = math_check
+
+SOURCES +=  Math_Check.cpp      \
+			Cortex_Model.cpp    \
+			Cortical_Column.cpp
+
+HEADERS +=  Cortex_Model.h      \
+			Cortical_Column.h   \
+			Data_Storage.h      \
+			Math_Backend.h      \
+			Random_Stream.h     \
+			Simulation_Settings.h \
+			SRK4.h
+
+QMAKE_CXXFLAGS += -std=c++11
+QMAKE_CXXFLAGS_RELEASE -= -O1
+QMAKE_CXXFLAGS_RELEASE -= -O2
+QMAKE_CXXFLAGS_RELEASE *= -O3
+
+# Backend under test, run once with 0 to create the reference
+DEFINES += MATH_BACKEND=0
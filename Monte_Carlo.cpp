@@ -0,0 +1,177 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*						Functions of the Monte-Carlo trials					  */
+/******************************************************************************/
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Monte_Carlo.h"
+
+/******************************************************************************/
+/*							Running statistics								  */
+/******************************************************************************/
+Running_Statistics::Running_Statistics(unsigned bins, unsigned hist_bins, double lo, double hi)
+    : Mean (bins, 0.0)
+    , M2 (bins, 0.0)
+    , numHist (hist_bins)
+    , lo (lo)
+    , hi (hi)
+    , hist ((size_t) bins*hist_bins, 0)
+{}
+
+void Running_Statistics::add(const double* x) {
+    ++n;
+    for (unsigned i=0; i < Mean.size(); ++i) {
+        const double delta = x[i] - Mean[i];
+        Mean[i]	+= delta/n;
+        M2[i]	+= delta*(x[i] - Mean[i]);
+    }
+    if (numHist == 0) {
+        return;
+    }
+    const double scale = numHist/(hi - lo);
+    for (unsigned i=0; i < Mean.size(); ++i) {
+        const int k = std::floor((x[i] - lo)*scale);
+        ++hist[(size_t) i*numHist + std::min<int>(std::max(k, 0), numHist-1)];
+    }
+}
+
+double Running_Statistics::ci_width(unsigned bin, double z) const {
+    return n > 1 ? 2*z*std::sqrt(variance(bin)/n) : INFINITY;
+}
+
+double Running_Statistics::quantile(unsigned bin, double q) const {
+    if (numHist == 0 || n == 0) {
+        return NAN;
+    }
+    const uint32_t* h = &hist[(size_t) bin*numHist];
+    const double rank = q*n;
+    const double width = (hi - lo)/numHist;
+    double sum = 0;
+    for (unsigned k=0; k < numHist; ++k) {
+        if (h[k] > 0 && sum + h[k] >= rank) {
+            return lo + width*(k + (rank - sum)/h[k]);
+        }
+        sum += h[k];
+    }
+    return hi;
+}
+
+/******************************************************************************/
+/*								Parallel trials								  */
+/******************************************************************************/
+Monte_Carlo_Result run_trials(const Monte_Carlo_Job& job, const Simulation_Settings& Settings,
+                              unsigned threads) {
+    const double fs		= (double) Settings.res/Settings.red;
+    const int samples	= job.trial.T*Settings.res/Settings.red;
+    const int pre		= std::lround(job.pre*fs);
+    const int post		= std::lround(job.post*fs);
+
+    Monte_Carlo_Result result;
+    result.dt	= 1/fs;
+    result.t0	= job.aligned ? -pre/fs : 0;
+    const unsigned bins	= job.aligned ? pre + post : samples;
+    result.statistics	= Running_Statistics(bins, job.hist_bins, job.hist_lo, job.hist_hi);
+
+    /* Bins that are checked by the stopping rule */
+    unsigned first = 0, last = bins;
+    if (job.stop_end > job.stop_begin) {
+        first	= std::min<double>(bins, std::max(0.0, std::ceil((job.stop_begin - result.t0)*fs)));
+        last	= std::min<double>(bins, std::max(0.0, std::floor((job.stop_end - result.t0)*fs) + 1));
+    }
+    auto converged = [&]() {
+        if (job.width <= 0 || result.trials < job.min_trials || first >= last) {
+            return false;
+        }
+        for (unsigned i=first; i < last; ++i) {
+            if (!(result.statistics.ci_width(i, job.z) <= job.width)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    /* Adds a finished trial to the statistics */
+    auto add = [&](Sweep_Result& trial) {
+        const double* x = trial.channel(job.channel);
+        if (!job.aligned) {
+            result.statistics.add(x);
+        } else {
+            for (double marker : trial.marker) {
+                const int begin = (int) marker - pre;
+                if (begin >= 0 && begin + (int) bins <= samples) {
+                    result.statistics.add(x + begin);
+                }
+            }
+        }
+        ++result.trials;
+        result.converged = converged();
+    };
+
+    /* Trials are simulated in any order, but wait for their turn to enter
+     * the statistics. A thread holds at most one trial at a time */
+    std::mutex				lock;
+    std::condition_variable	turn;
+    unsigned				added = 0;
+    std::atomic<bool>		stop(false);
+    std::atomic<unsigned>	next(0);
+    auto work = [&]() {
+        Sweep_Result trial;
+        trial.data.resize(6 * samples);
+        for (unsigned k = next++; k < job.max_trials && !stop; k = next++) {
+            Sweep_Job config = job.trial;
+            config.id += k;
+            run_simulation(config, Settings, trial);
+
+            std::unique_lock<std::mutex> guard(lock);
+            turn.wait(guard, [&]() {return stop || added == k;});
+            if (!stop) {
+                add(trial);
+                ++added;
+                stop = result.converged;
+                turn.notify_all();
+            }
+        }
+    };
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::max(1u, std::min(threads, job.max_trials));
+    std::vector<std::thread> workers;
+    for (unsigned i=1; i < threads; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return result;
+}
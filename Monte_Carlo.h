@@ -0,0 +1,146 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*					Monte-Carlo trials with online statistics				  */
+/*																			  */
+/*	Runs independent realizations of one column and stimulation protocol.	  */
+/*	Trial k uses the noise streams with id job.trial.id + k, so every trial	  */
+/*	can be reproduced on its own with Cortex_mex or run_simulation. Only the */
+/*	statistics over the trials are kept: mean and variance of every time bin */
+/*	(Welford's update) and optionally a histogram per bin for quantiles, so	  */
+/*	memory depends on the number of bins but not on the number of trials.	  */
+/*																			  */
+/*	The bins are the samples of one channel after the onset, or epochs		  */
+/*	around every stimulation marker if aligned is set. Then every epoch that */
+/*	lies completely within its trial is one observation.					  */
+/*																			  */
+/*	The trials are simulated in parallel but enter the statistics in the	  */
+/*	order of k. The results and the number of trials at which the engine	  */
+/*	stops therefore do not depend on the number of threads.					  */
+/******************************************************************************/
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Parameter_Sweep.h"
+#include "Simulation_Settings.h"
+
+/******************************************************************************/
+/*						Running statistics of many bins						  */
+/******************************************************************************/
+class Running_Statistics {
+public:
+    Running_Statistics(void) {}
+
+    /* Histograms with hist_bins bins on [lo, hi] for the quantiles, values
+     * outside are counted in the first or last bin. 0 disables them */
+    Running_Statistics(unsigned bins, unsigned hist_bins = 0, double lo = -100, double hi = 0);
+
+    /* Add one observation, x contains a value for every bin */
+    void		add			(const double* x);
+
+    /* Number of observations */
+    uint64_t	count		(void) const {return n;}
+    unsigned	bins		(void) const {return Mean.size();}
+
+    double		mean		(unsigned bin) const {return Mean[bin];}
+
+    /* Unbiased estimate of the variance */
+    double		variance	(unsigned bin) const {return n > 1 ? M2[bin]/(n-1) : 0;}
+
+    /* Width of the confidence interval mean +- z * standard error */
+    double		ci_width	(unsigned bin, double z = 1.96) const;
+
+    /* Value below which the fraction q of the observations of bin lies,
+     * interpolated within the histogram bins */
+    double		quantile	(unsigned bin, double q) const;
+private:
+    uint64_t				n = 0;
+    std::vector<double>		Mean;
+    std::vector<double>		M2;
+
+    /* Histograms of all bins one after another */
+    unsigned				numHist	= 0;
+    double					lo		= 0;
+    double					hi		= 0;
+    std::vector<uint32_t>	hist;
+};
+
+/******************************************************************************/
+/*							Description of the trials						  */
+/******************************************************************************/
+struct Monte_Carlo_Job {
+    /* Configuration of every trial, trial k uses the stream id trial.id + k */
+    Sweep_Job	trial;
+
+    /* Recorded channel in the order of Cortex_mex, 0 == Vp */
+    unsigned	channel		= 0;
+
+    /* Epochs from pre s before to post s after every stimulation marker
+     * instead of the complete trial */
+    bool		aligned		= false;
+    double		pre			= 0.5;
+    double		post		= 1.5;
+
+    /* Limits of the number of trials */
+    unsigned	min_trials	= 10;
+    unsigned	max_trials	= 100;
+
+    /* Stop once the confidence interval of the mean is at most width in all
+     * bins within [stop_begin, stop_end] s on the time axis of the bins (all
+     * bins if stop_end <= stop_begin). A width of 0 runs max_trials */
+    double		width		= 0;
+    double		z			= 1.96;
+    double		stop_begin	= 0;
+    double		stop_end	= 0;
+
+    /* Histograms for the quantiles, see Running_Statistics */
+    unsigned	hist_bins	= 0;
+    double		hist_lo		= -100;
+    double		hist_hi		= 0;
+};
+
+/******************************************************************************/
+/*							Output of the trials							  */
+/******************************************************************************/
+struct Monte_Carlo_Result {
+    /* Trials that entered the statistics */
+    unsigned			trials		= 0;
+
+    /* If the confidence interval reached the target width */
+    bool				converged	= false;
+
+    /* Time of the first bin in s (after the onset or relative to the
+     * marker) and spacing of the bins */
+    double				t0			= 0;
+    double				dt			= 0;
+
+    Running_Statistics	statistics;
+};
+
+/* Runs trials until the stopping rule is met or max_trials are done with the
+ * given number of threads. A thread number of 0 uses all available cores */
+Monte_Carlo_Result run_trials	(const Monte_Carlo_Job& job, const Simulation_Settings& Settings,
+                                 unsigned threads = 0);
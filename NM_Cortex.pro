@@ -7,16 +7,62 @@ TARGET = release_binary
 
 SOURCES +=  Cortex_mex.cpp      \
 			Cortex.cpp          \
-			Cortical_Column.cpp
+			Column_Session.cpp  \
+			Continuation.cpp    \
+			Cortex_Model.cpp    \
+			Cortical_Column.cpp \
+			Dormand_Prince.cpp  \
+			Cortical_Column_Batch.cpp \
+			Cortical_Network.cpp \
+			Cortical_Sheet.cpp  \
+			Monte_Carlo.cpp     \
+			Parameter_Fit.cpp   \
+			Parameter_Sweep.cpp \
+			Real_Time.cpp       \
+			Spectral_Analysis.cpp \
+			Trace_Writer.cpp    \
+			Trial_Fork.cpp      \
+			Warm_Start.cpp
 
-HEADERS +=  Cortical_Column.h   \
+HEADERS +=  Column_Session.h    \
+			Continuation.h      \
+			Cortex_Model.h      \
+			Cortical_Column.h   \
+			Cortical_Column_Batch.h \
+			Cortical_Network.h  \
+			Cortical_Sheet.h    \
+			Math_Backend.h      \
 			Data_Storage.h      \
+			Dormand_Prince.h    \
+			Event_Detection.h   \
+			Instrumentation.h   \
+			Monte_Carlo.h       \
+			Parameter_Fit.h     \
+			Parameter_Sweep.h   \
+			Probe.h             \
 			Random_Stream.h     \
-			Stimulation.h
+			Real_Time.h         \
+			Simulation_Settings.h \
+			Spectral_Analysis.h \
+			SPSC_Queue.h        \
+			SRK4.h              \
+			Stimulation.h       \
+			Step_Barrier.h      \
+			Trace_Writer.h      \
+			Trial_Fork.h        \
+			Warm_Start.h
 
 SOURCES -= Cortex_mex.cpp
 
-QMAKE_CXXFLAGS += -std=c++11
+QMAKE_CXXFLAGS += -std=c++11 -pthread
+LIBS += -pthread
 QMAKE_CXXFLAGS_RELEASE -= -O1
 QMAKE_CXXFLAGS_RELEASE -= -O2
 QMAKE_CXXFLAGS_RELEASE *= -O3
+
+# Implementation of exp and pow, see Math_Backend.h
+# 0 == libm, 1 == polynomial (vectorized), 2 == table
+DEFINES += MATH_BACKEND=0
+
+# Cycle counters of the step loop, see Instrumentation.h
+DEFINES += INSTRUMENTATION=0
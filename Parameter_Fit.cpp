@@ -0,0 +1,338 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*						Functions of the parameter fit						  */
+/******************************************************************************/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "Event_Detection.h"
+#include "Math_Backend.h"
+#include "Parameter_Fit.h"
+#include "Spectral_Analysis.h"
+
+/******************************************************************************/
+/*								Features									  */
+/******************************************************************************/
+unsigned fit_num_features(const Fit_Job& job) {
+    return std::max<size_t>(job.bands.size(), 1) - 1 + 2;
+}
+
+std::vector<double> fit_features(const Fit_Job& job, const Simulation_Settings& Settings,
+                                 Sweep_Result& result) {
+    const double fs			= (double) Settings.res/Settings.red;
+    const unsigned samples	= result.data.size()/6;
+    const double* Vp		= result.channel(0);
+
+    Welch_PSD		PSD(fs, job.segment);
+    Event_Detector	Detector(fs);
+    for (unsigned i=0; i < samples; ++i) {
+        PSD.add(Vp[i]);
+        Detector.add(Vp[i]);
+    }
+
+    std::vector<double> features;
+    if (job.bands.size() > 1) {
+        const double total = PSD.band_power(job.bands.front(), job.bands.back());
+        for (unsigned i=0; i+1 < job.bands.size(); ++i) {
+            features.push_back(total > 0 ? PSD.band_power(job.bands[i], job.bands[i+1])/total : 0);
+        }
+    }
+    features.push_back(Detector.events().size() / (samples/fs/60));
+
+    /* Trough after the stimuli */
+    const unsigned window = job.kc_window*fs;
+    double trough = 0;
+    unsigned count = 0;
+    for (double marker : result.marker) {
+        if (marker >= 0 && marker + window <= samples) {
+            trough += *std::min_element(Vp + (unsigned) marker, Vp + (unsigned) marker + window);
+            ++count;
+        }
+    }
+    features.push_back(count > 0 ? trough/count : 0);
+    return features;
+}
+
+double fit_score(const Fit_Job& job, const std::vector<double>& features) {
+    double score = 0;
+    for (unsigned i=0; i < features.size() && i < job.target.size(); ++i) {
+        const double w = i < job.weights.size() ? job.weights[i] : 1;
+        score += w * (features[i] - job.target[i]) * (features[i] - job.target[i]);
+    }
+    return score;
+}
+
+/* Features of all candidates, every repeat is a job of the sweep */
+static std::vector<std::vector<double>> evaluate(const Fit_Job& job, const Simulation_Settings& Settings,
+                                                 const std::vector<std::vector<double>>& candidates,
+                                                 unsigned threads) {
+    const unsigned repeats = std::max(1u, job.repeats);
+    std::vector<Sweep_Job> jobs;
+    for (auto& Param_Cortex : candidates) {
+        for (unsigned r=0; r < repeats; ++r) {
+            jobs.push_back(Sweep_Job{job.T, Param_Cortex, job.var_stim, job.seed, job.id + r});
+        }
+    }
+    std::vector<std::vector<double>> features_job(jobs.size());
+    run_sweep(jobs, Settings, [&](unsigned j, Sweep_Result& result) {
+        features_job[j] = fit_features(job, Settings, result);
+    }, threads);
+
+    /* Average in a fixed order, independent of the scheduling */
+    std::vector<std::vector<double>> features(candidates.size(),
+                                              std::vector<double>(fit_num_features(job), 0.0));
+    for (unsigned j=0; j < jobs.size(); ++j) {
+        for (unsigned i=0; i < features[j/repeats].size(); ++i) {
+            features[j/repeats][i] += features_job[j][i] / repeats;
+        }
+    }
+    return features;
+}
+
+std::vector<double> fit_features(const Fit_Job& job, const Simulation_Settings& Settings,
+                                 const std::vector<double>& Param_Cortex, unsigned threads) {
+    return evaluate(job, Settings, {Param_Cortex}, threads)[0];
+}
+
+/******************************************************************************/
+/*								Checkpoint									  */
+/*	Everything that determines the population and the features is stored	  */
+/*	as a key, so that a checkpoint of a different fit is not continued.		  */
+/*	Target and weights may change, the scores are recomputed. The number	  */
+/*	of generations may be raised to extend a finished fit.					  */
+/******************************************************************************/
+struct Fit_State {
+    uint32_t							generation = 0;
+    std::vector<std::vector<double>>	population;
+    std::vector<std::vector<double>>	features;
+    std::vector<double>					scores;
+    std::vector<double>					history;
+};
+
+template <typename T>
+static void append(std::string& key, const T& value) {
+    key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void append(std::string& key, const std::vector<double>& values) {
+    append(key, (uint32_t) values.size());
+    key.append(reinterpret_cast<const char*>(values.data()), values.size()*sizeof(double));
+}
+
+static std::string checkpoint_key(const Fit_Job& job, const Simulation_Settings& Settings) {
+    std::string key;
+    append(key, (uint32_t) job.population);
+    append(key, (uint32_t) fit_num_features(job));
+    append(key, job.lower);
+    append(key, job.upper);
+
+    /* Simulations */
+    append(key, (int32_t) job.T);
+    append(key, job.var_stim);
+    append(key, job.seed);
+    append(key, job.id);
+    append(key, (uint32_t) job.repeats);
+    append(key, (int32_t) Settings.onset);
+    append(key, (int32_t) Settings.res);
+    append(key, (int32_t) Settings.red);
+    append(key, Settings.tolerance);
+    append(key, Settings.warm_start);
+    append(key, (int32_t) MATH_BACKEND);
+
+    /* Features and optimizer */
+    append(key, job.bands);
+    append(key, job.kc_window);
+    append(key, (uint32_t) job.segment);
+    append(key, job.F);
+    append(key, job.CR);
+    append(key, job.fit_seed);
+    return key;
+}
+
+static bool load_state(const Fit_Job& job, const Simulation_Settings& Settings, Fit_State& state) {
+    if (job.checkpoint.empty()) {
+        return false;
+    }
+    std::FILE* file = std::fopen(job.checkpoint.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    const unsigned D = job.lower.size();
+    const unsigned M = fit_num_features(job);
+    const std::string key = checkpoint_key(job, Settings);
+    char magic[8];
+    uint32_t length = 0;
+    std::string stored(key.size(), '\0');
+    bool good = std::fread(magic, 1, 8, file) == 8 && std::memcmp(magic, "NMFIT02", 8) == 0
+             && std::fread(&length, sizeof(uint32_t), 1, file) == 1 && length == key.size()
+             && std::fread(&stored[0], 1, length, file) == length && stored == key
+             && std::fread(&state.generation, sizeof(uint32_t), 1, file) == 1;
+    state.population.assign(job.population, std::vector<double>(D));
+    state.features.assign(job.population, std::vector<double>(M));
+    state.scores.resize(job.population);
+    state.history.resize(good ? state.generation : 0);
+    for (unsigned k=0; good && k < job.population; ++k) {
+        good = std::fread(state.population[k].data(), sizeof(double), D, file) == D
+            && std::fread(state.features[k].data(), sizeof(double), M, file) == M;
+    }
+    good = good && std::fread(state.scores.data(), sizeof(double), job.population, file) == job.population
+                && std::fread(state.history.data(), sizeof(double), state.history.size(), file)
+                   == state.history.size();
+    std::fclose(file);
+    return good;
+}
+
+static void store_state(const Fit_Job& job, const Simulation_Settings& Settings, const Fit_State& state) {
+    if (job.checkpoint.empty()) {
+        return;
+    }
+
+    /* Written to a temporary file first, so that an interrupted write keeps
+     * the previous checkpoint */
+    const std::string temp = job.checkpoint + ".tmp"
+                           + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    std::FILE* file = std::fopen(temp.c_str(), "wb");
+    if (!file) {
+        return;
+    }
+    const unsigned D = job.lower.size();
+    const unsigned M = fit_num_features(job);
+    const std::string key = checkpoint_key(job, Settings);
+    const uint32_t length = key.size();
+    bool good = std::fwrite("NMFIT02", 1, 8, file) == 8
+             && std::fwrite(&length, sizeof(uint32_t), 1, file) == 1
+             && std::fwrite(key.data(), 1, length, file) == length
+             && std::fwrite(&state.generation, sizeof(uint32_t), 1, file) == 1;
+    for (unsigned k=0; good && k < job.population; ++k) {
+        good = std::fwrite(state.population[k].data(), sizeof(double), D, file) == D
+            && std::fwrite(state.features[k].data(), sizeof(double), M, file) == M;
+    }
+    good = good && std::fwrite(state.scores.data(), sizeof(double), job.population, file) == job.population
+                && std::fwrite(state.history.data(), sizeof(double), state.history.size(), file)
+                   == state.history.size();
+    good = (std::fclose(file) == 0) && good;
+    if (!good || std::rename(temp.c_str(), job.checkpoint.c_str()) != 0) {
+        std::remove(temp.c_str());
+    }
+}
+
+/******************************************************************************/
+/*							Differential evolution							  */
+/******************************************************************************/
+Fit_Result fit_parameters(const Fit_Job& job, const Simulation_Settings& Settings,
+                          unsigned threads) {
+    if (job.lower.size() != 3 || job.upper.size() != 3) {
+        throw std::invalid_argument("fit_parameters: bounds have to contain sigma_p, g_KNa and dphi");
+    }
+    for (unsigned d=0; d < 3; ++d) {
+        if (!(job.lower[d] <= job.upper[d])) {
+            throw std::invalid_argument("fit_parameters: lower bound above the upper bound");
+        }
+    }
+    const unsigned D	= job.lower.size();
+    const unsigned NP	= std::max(4u, job.population);
+    Fit_Job fit = job;
+    fit.population = NP;
+
+    /* Generator of generation g, generation 0 is the initial population */
+    auto generator = [&fit](uint32_t g) {
+        std::seed_seq seq{(uint32_t) fit.fit_seed, (uint32_t) (fit.fit_seed >> 32), g};
+        return std::mt19937_64(seq);
+    };
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    Fit_Result result;
+    Fit_State state;
+    if (load_state(fit, Settings, state)) {
+        /* The target or weights may have changed since the checkpoint */
+        for (unsigned k=0; k < NP; ++k) {
+            state.scores[k] = fit_score(fit, state.features[k]);
+        }
+    } else {
+        std::mt19937_64 rng = generator(0);
+        state = Fit_State();
+        state.population.assign(NP, std::vector<double>(D));
+        for (auto& x : state.population) {
+            for (unsigned d=0; d < D; ++d) {
+                x[d] = fit.lower[d] + uniform(rng) * (fit.upper[d] - fit.lower[d]);
+            }
+        }
+        state.features = evaluate(fit, Settings, state.population, threads);
+        for (auto& f : state.features) {
+            state.scores.push_back(fit_score(fit, f));
+        }
+        result.evaluations += NP;
+        store_state(fit, Settings, state);
+    }
+
+    for (uint32_t g = state.generation; g < fit.generations; ++g) {
+        /* Mutation and crossover */
+        std::mt19937_64 rng = generator(g+1);
+        std::vector<std::vector<double>> trials(NP, std::vector<double>(D));
+        for (unsigned k=0; k < NP; ++k) {
+            unsigned a, b, c;
+            do {a = rng() % NP;} while (a == k);
+            do {b = rng() % NP;} while (b == k || b == a);
+            do {c = rng() % NP;} while (c == k || c == a || c == b);
+            const unsigned forced = rng() % D;
+            for (unsigned d=0; d < D; ++d) {
+                double x = state.population[k][d];
+                if (uniform(rng) < fit.CR || d == forced) {
+                    x = state.population[a][d] + fit.F * (state.population[b][d] - state.population[c][d]);
+                }
+                trials[k][d] = std::min(std::max(x, fit.lower[d]), fit.upper[d]);
+            }
+        }
+
+        /* Selection */
+        std::vector<std::vector<double>> features = evaluate(fit, Settings, trials, threads);
+        result.evaluations += NP;
+        for (unsigned k=0; k < NP; ++k) {
+            const double score = fit_score(fit, features[k]);
+            if (score <= state.scores[k]) {
+                state.population[k]	= trials[k];
+                state.features[k]	= features[k];
+                state.scores[k]		= score;
+            }
+        }
+        state.history.push_back(*std::min_element(state.scores.begin(), state.scores.end()));
+        state.generation = g+1;
+        store_state(fit, Settings, state);
+    }
+
+    const unsigned best = std::min_element(state.scores.begin(), state.scores.end()) - state.scores.begin();
+    result.parameters	= state.population[best];
+    result.features		= state.features[best];
+    result.score		= state.scores[best];
+    result.generations	= state.generation;
+    result.history		= state.history;
+    return result;
+}
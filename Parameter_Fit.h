@@ -0,0 +1,119 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*				Fit of the column parameters to EEG features				  */
+/*																			  */
+/*	Candidates (sigma_p, g_KNa, dphi) are scored by the weighted squared	  */
+/*	distance of the features of their simulations to a target:				  */
+/*		relative power of Vp in the bands [bands[i], bands[i+1]] Hz			  */
+/*		slow oscillations per minute (Event_Detector with default criteria)	  */
+/*		mean trough of Vp within kc_window s after every stimulation marker	  */
+/*	in this order. Every feature is averaged over repeats simulations.		  */
+/*																			  */
+/*	The optimizer is differential evolution (DE/rand/1/bin). A generation	  */
+/*	is simulated at once with run_sweep, so all cores are busy. All			  */
+/*	candidates use the same noise streams (common random numbers), so the	  */
+/*	differences of their scores are not masked by different noise.			  */
+/*																			  */
+/*	After every generation population and scores are written to checkpoint, */
+/*	a later call with the same file continues from there. The random		  */
+/*	numbers of generation g only depend on fit_seed and g, so a resumed fit	  */
+/*	gives the same result as an uninterrupted one. A checkpoint of a job	  */
+/*	or settings that differ in anything but target, weights and the number	  */
+/*	of generations is ignored and overwritten.								  */
+/******************************************************************************/
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Parameter_Sweep.h"
+#include "Simulation_Settings.h"
+
+/******************************************************************************/
+/*							Description of the fit							  */
+/******************************************************************************/
+struct Fit_Job {
+    /* Simulations of every candidate, repeat r uses the stream id id + r */
+    int					T			= 60;
+    std::vector<double>	var_stim	= std::vector<double>(8, 0.0);
+    uint64_t			seed		= 1;
+    uint32_t			id			= 0;
+    unsigned			repeats		= 1;
+
+    /* Bounds of sigma_p, g_KNa and dphi, equal bounds fix a parameter */
+    std::vector<double>	lower		= {4.0, 1.0, 2.0};
+    std::vector<double>	upper		= {7.0, 2.5, 2.0};
+
+    /* Features, see above */
+    std::vector<double>	bands		= {0.5, 1.25, 4, 8, 15};
+    double				kc_window	= 1.0;
+    unsigned			segment		= 256;		/* Welch segment in samples		*/
+    std::vector<double>	target;
+    std::vector<double>	weights;				/* Empty == all 1				*/
+
+    /* Differential evolution */
+    unsigned			population	= 20;
+    unsigned			generations	= 30;
+    double				F			= 0.7;		/* Differential weight			*/
+    double				CR			= 0.9;		/* Crossover probability		*/
+    uint64_t			fit_seed	= 1;
+
+    /* File of the optimizer state, empty == none */
+    std::string			checkpoint;
+};
+
+/******************************************************************************/
+/*							Output of the fit								  */
+/******************************************************************************/
+struct Fit_Result {
+    std::vector<double>	parameters;		/* Best candidate (sigma_p, g_KNa, dphi) */
+    std::vector<double>	features;		/* Its features							*/
+    double				score		= 0;
+    unsigned			generations	= 0;/* Generations done, including resumed	*/
+    unsigned			evaluations	= 0;/* Candidates simulated in this call	*/
+    std::vector<double>	history;		/* Best score after every generation	*/
+};
+
+/* Number of features of the job */
+unsigned			fit_num_features	(const Fit_Job& job);
+
+/* Features of a single simulation as returned by run_simulation */
+std::vector<double>	fit_features	(const Fit_Job& job, const Simulation_Settings& Settings,
+                                     Sweep_Result& result);
+
+/* Features of the parameters averaged over the repeats of the job, e.g. to
+ * compute a target from a reference parameter set */
+std::vector<double>	fit_features	(const Fit_Job& job, const Simulation_Settings& Settings,
+                                     const std::vector<double>& Param_Cortex, unsigned threads = 0);
+
+/* Weighted squared distance to the target */
+double				fit_score		(const Fit_Job& job, const std::vector<double>& features);
+
+/* Runs the remaining generations with the given number of threads. A thread
+ * number of 0 uses all available cores. Throws std::invalid_argument unless
+ * there are 3 lower and upper bounds with lower <= upper */
+Fit_Result			fit_parameters	(const Fit_Job& job, const Simulation_Settings& Settings,
+                                     unsigned threads = 0);
@@ -0,0 +1,277 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*					Functions of the parallel parameter sweep				  */
+/******************************************************************************/
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "Cortical_Column.h"
+#include "Data_Storage.h"
+#include "Dormand_Prince.h"
+#include "Parameter_Sweep.h"
+#include "Probe.h"
+#include "Stimulation.h"
+#include "Trace_Writer.h"
+#include "Warm_Start.h"
+
+/******************************************************************************/
+/*								Work stealing queues						  */
+/*	Every thread owns a queue that it works on from the front. Once it is	  */
+/*	empty the thread takes jobs from the back of the other queues.			  */
+/******************************************************************************/
+class Work_Queues {
+public:
+    Work_Queues(unsigned threads) : queues(threads) {}
+
+    void push (unsigned thread, unsigned job) {
+        queues[thread].jobs.push_back(job);
+    }
+
+    /* Fetch the next job of thread, returns false if all queues are empty */
+    bool pop (unsigned thread, unsigned& job) {
+        if (take(queues[thread], true, job)) {
+            return true;
+        }
+        for (unsigned i=1; i < queues.size(); ++i) {
+            if (take(queues[(thread+i)%queues.size()], false, job)) {
+                return true;
+            }
+        }
+        return false;
+    }
+private:
+    struct Queue {
+        std::mutex				lock;
+        std::deque<unsigned>	jobs;
+    };
+
+    bool take (Queue& queue, bool front, unsigned& job) {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.jobs.empty()) {
+            return false;
+        }
+        if (front) {
+            job = queue.jobs.front();
+            queue.jobs.pop_front();
+        } else {
+            job = queue.jobs.back();
+            queue.jobs.pop_back();
+        }
+        return true;
+    }
+
+    std::vector<Queue> queues;
+};
+
+/******************************************************************************/
+/*								Grid of jobs								  */
+/******************************************************************************/
+std::vector<Sweep_Job> create_grid(int T,
+                                   const std::vector<std::vector<double>>& Params,
+                                   const std::vector<std::vector<double>>& Stims,
+                                   uint64_t seed) {
+    std::vector<Sweep_Job> jobs;
+    jobs.reserve(Params.size()*Stims.size());
+    for (auto& Param_Cortex : Params) {
+        for (auto& var_stim : Stims) {
+            jobs.push_back(Sweep_Job{T, Param_Cortex, var_stim, seed, (uint32_t) jobs.size()});
+        }
+    }
+    return jobs;
+}
+
+/******************************************************************************/
+/*								Single simulation							  */
+/******************************************************************************/
+/* Runs the simulation loop of Cortex_mex, record is called after every time
+ * step after the onset with the number of the step */
+template <typename Recorder>
+std::vector<double> simulate(const Sweep_Job& job, const Simulation_Settings& Settings,
+                             Recorder record) {
+    const int onset	= Settings.onset;
+    const int res	= Settings.res;
+    const int red	= Settings.red;
+    const int Time	= (job.T+onset)*res;
+
+    /* Copies as the constructors expect mutable parameters */
+    std::vector<double> Param_Cortex = job.Param_Cortex;
+    std::vector<double> var_stim	 = job.var_stim;
+
+    /* Initialize the population and stimulation protocol */
+    Cortical_Column Cortex(Param_Cortex.data(), Settings, job.seed, job.id);
+    Stim Stimulation(Cortex, var_stim.data(), Settings, job.seed + job.id);
+
+    /* Skip the onset if a cached state can be used */
+    const int t_start = warm_start(Cortex, Settings, job.seed, job.id);
+
+    /* Noise free columns are integrated adaptively */
+    const bool adaptive = Dormand_Prince::applicable(Cortex, Settings);
+    Dormand_Prince Solver(Cortex, Settings);
+
+    /* Simulation, the stimulation is only checked at its events */
+    Stimulation.run(t_start, Time, [&](int t) {
+        if (adaptive) {
+            Solver.step();
+        } else {
+            Cortex.iterate_ODE();
+        }
+        if(t >= onset*res){
+            record(t, Cortex);
+        }
+    });
+
+    /* Marker in samples as returned by Cortex_mex */
+    std::vector<double> marker;
+    for (auto& elem : Stimulation.markers()) {
+        marker.push_back(elem/red);
+    }
+    return marker;
+}
+
+/* Recorder of every red-th step, record is called with the number of the sample */
+template <typename Recorder>
+struct Sampler {
+    int			red;
+    int			count;
+    Recorder	record;
+
+    void operator() (int t, Cortical_Column& Cortex) {
+        if (t%red == 0) {
+            record(count, Cortex);
+            ++count;
+        }
+    }
+};
+
+template <typename Recorder>
+Sampler<Recorder> sampled(const Simulation_Settings& Settings, Recorder record) {
+    return Sampler<Recorder>{Settings.red, 0, record};
+}
+
+void run_simulation(const Sweep_Job& job, const Simulation_Settings& Settings,
+                    Sweep_Result& result) {
+    /* Pointer to the data blocks */
+    std::vector<double*> dataPointer;
+    for (unsigned i=0; i < 6; ++i) {
+        dataPointer.push_back(result.channel(i));
+    }
+    result.marker = simulate(job, Settings, sampled(Settings, [&dataPointer](int count, Cortical_Column& Cortex) {
+        get_data(count, Cortex, dataPointer);
+    }));
+}
+
+bool run_simulation(const Sweep_Job& job, const Simulation_Settings& Settings,
+                    const std::string& path, std::vector<double>& marker) {
+    /* The header stores the column and stimulation parameters */
+    std::vector<double> parameters = job.Param_Cortex;
+    parameters.insert(parameters.end(), job.var_stim.begin(), job.var_stim.end());
+    Trace_Writer Writer(path, {"Vp", "Vi", "s_ep", "s_ei", "s_gp", "s_gi"}, parameters, Settings);
+    if (!Writer.good()) {
+        return false;
+    }
+
+    marker = simulate(job, Settings, sampled(Settings, [&Writer](int, Cortical_Column& Cortex) {
+        get_data(Cortex, Writer);
+    }));
+    Writer.close();
+    return Writer.good();
+}
+
+std::vector<double> run_simulation(const Sweep_Job& job, const Simulation_Settings& Settings,
+                                   Welch_PSD& PSD, unsigned channel) {
+    return simulate(job, Settings, sampled(Settings, [&PSD, channel](int, Cortical_Column& Cortex) {
+        PSD.add(get_channel(Cortex, channel));
+    }));
+}
+
+std::vector<double> run_simulation(const Sweep_Job& job, const Simulation_Settings& Settings,
+                                   Event_Detector& Detector) {
+    return simulate(job, Settings, sampled(Settings, [&Detector](int, Cortical_Column& Cortex) {
+        Detector.add(get_channel(Cortex, 0));
+    }));
+}
+
+std::vector<double> run_simulation(const Sweep_Job& job, const Simulation_Settings& Settings,
+                                   Probe_Recorder& Recorder) {
+    return simulate(job, Settings, [&Recorder](int, Cortical_Column& Cortex) {
+        Recorder.add(Cortex);
+    });
+}
+
+/******************************************************************************/
+/*								Parallel sweep								  */
+/******************************************************************************/
+std::vector<Sweep_Result> run_sweep(const std::vector<Sweep_Job>& jobs,
+                                    const Simulation_Settings& Settings,
+                                    unsigned threads) {
+    /* Every job writes to its own result, so no locking is needed */
+    std::vector<Sweep_Result> results(jobs.size());
+    run_sweep(jobs, Settings, [&results](unsigned job, Sweep_Result& result) {
+        results[job] = std::move(result);
+    }, threads);
+    return results;
+}
+
+void run_sweep(const std::vector<Sweep_Job>& jobs,
+               const Simulation_Settings& Settings,
+               const std::function<void(unsigned, Sweep_Result&)>& finished,
+               unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    /* Distribute the jobs, longest first, so that short ones are stolen */
+    std::vector<unsigned> order(jobs.size());
+    for (unsigned i=0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&jobs](unsigned a, unsigned b) {
+        return jobs[a].T > jobs[b].T;
+    });
+    Work_Queues queues(threads);
+    for (unsigned i=0; i < order.size(); ++i) {
+        queues.push(i%threads, order[i]);
+    }
+
+    /* Worker threads */
+    std::vector<std::thread> workers;
+    for (unsigned i=0; i < threads; ++i) {
+        workers.emplace_back([&, i]() {
+            unsigned job;
+            while (queues.pop(i, job)) {
+                Sweep_Result result;
+                result.data.resize(6 * jobs[job].T*Settings.res/Settings.red);
+                run_simulation(jobs[job], Settings, result);
+                finished(job, result);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
@@ -0,0 +1,118 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*					Parallel sweeps over parameters and stimuli				  */
+/*																			  */
+/*	A sweep is a list of independent simulations as they are done by		  */
+/*	Cortex_mex. The simulations are distributed over threads with per thread */
+/*	queues, idle threads steal work from the others, as the duration of the	  */
+/*	simulations may differ a lot.											  */
+/******************************************************************************/
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Event_Detection.h"
+#include "Simulation_Settings.h"
+#include "Spectral_Analysis.h"
+
+class Probe_Recorder;
+
+/******************************************************************************/
+/*							Description of a simulation						  */
+/******************************************************************************/
+struct Sweep_Job {
+    int					T;				/* Duration of the simulation in s 		*/
+    std::vector<double>	Param_Cortex;	/* Parameters of cortical module 		*/
+    std::vector<double>	var_stim;		/* Parameters of stimulation protocol 	*/
+    uint64_t			seed;			/* Global seed of the noise				*/
+    uint32_t			id;				/* Id of the noise streams				*/
+};
+
+/******************************************************************************/
+/*							Output of a simulation							  */
+/******************************************************************************/
+struct Sweep_Result {
+    /* The six channels of Cortex_mex (Vp, Vi, s_ep, s_ei, s_gp, s_gi) one
+     * after another, each with T*res/red samples */
+    std::vector<double>	data;
+
+    /* Onsets of the stimulation in samples */
+    std::vector<double>	marker;
+
+    /* Pointer to a channel */
+    double* channel (unsigned i) {return &data[i*data.size()/6];}
+};
+
+/* Creates a job for every combination of the parameter and stimulation sets.
+ * All jobs share the seed but have different stream ids */
+std::vector<Sweep_Job> create_grid	(int T,
+                                     const std::vector<std::vector<double>>& Params,
+                                     const std::vector<std::vector<double>>& Stims,
+                                     uint64_t seed);
+
+/* Runs a single simulation, result has to be allocated for the job */
+void run_simulation	(const Sweep_Job& job, const Simulation_Settings& Settings,
+                     Sweep_Result& result);
+
+/* Runs a single simulation and streams the samples into a trace file (see
+ * Trace_Writer.h), so that memory use does not grow with the duration. Stores
+ * the stimulation marker in samples, returns false if the file could not be
+ * created or written, in that case nothing is simulated or the trace is cut */
+bool run_simulation	(const Sweep_Job& job, const Simulation_Settings& Settings,
+                     const std::string& path, std::vector<double>& marker);
+
+/* Runs a single simulation and adds every sample of one channel (in the order
+ * of Cortex_mex) to the online spectral estimate instead of storing it.
+ * Returns the stimulation marker in samples */
+std::vector<double> run_simulation	(const Sweep_Job& job, const Simulation_Settings& Settings,
+                                     Welch_PSD& PSD, unsigned channel = 0);
+
+/* Runs a single simulation and passes every sample of Vp to the event
+ * detector instead of storing it. Returns the stimulation marker in samples */
+std::vector<double> run_simulation	(const Sweep_Job& job, const Simulation_Settings& Settings,
+                                     Event_Detector& Detector);
+
+/* Runs a single simulation and passes every time step after the onset to the
+ * probes (see Probe.h), so only the requested quantities are recorded.
+ * Returns the stimulation marker in samples */
+std::vector<double> run_simulation	(const Sweep_Job& job, const Simulation_Settings& Settings,
+                                     Probe_Recorder& Recorder);
+
+/* Allocates the results and runs all jobs with the given number of threads.
+ * A thread number of 0 uses all available cores */
+std::vector<Sweep_Result> run_sweep	(const std::vector<Sweep_Job>& jobs,
+                                     const Simulation_Settings& Settings,
+                                     unsigned threads = 0);
+
+/* Same as above, but every result is handed to finished as soon as its job is
+ * done and freed afterwards, so memory does not grow with the number of jobs.
+ * finished is called from the worker threads with the index of the job */
+void run_sweep	(const std::vector<Sweep_Job>& jobs,
+                 const Simulation_Settings& Settings,
+                 const std::function<void(unsigned, Sweep_Result&)>& finished,
+                 unsigned threads = 0);
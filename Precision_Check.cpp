@@ -0,0 +1,167 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*			Validation of the single and mixed precision batches			  */
+/*																			  */
+/*	Ensembles of columns with the N2 and N3 parameter sets are simulated in	  */
+/*	double, mixed and single precision with the same noise. For every		  */
+/*	precision the long run statistics of Vp are reported: mean, standard	  */
+/*	deviation, the rate of slow oscillations (events of Event_Detector) and	  */
+/*	the deviation of the power spectrum below 4 Hz from double precision.	  */
+/*	A double precision run with another seed gives the deviations that are	  */
+/*	expected from the finite duration alone.								  */
+/******************************************************************************/
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Cortical_Column_Batch.h"
+#include "Data_Storage.h"
+#include "Event_Detection.h"
+#include "Spectral_Analysis.h"
+
+/******************************************************************************/
+/*                          Fixed simulation settings						  */
+/******************************************************************************/
+const int T      		= 300;		/* Duration of the simulation in s		  */
+const unsigned Columns	= 16;		/* Number of columns per ensemble		  */
+const Simulation_Settings Settings;	/* Resolution, onset and reduction		  */
+const int onset			= Settings.onset;
+const int res 			= Settings.res;
+const int red 			= Settings.red;
+
+/* Spectrum on segments of 10.24 s */
+const unsigned	Segment	= 1024;
+
+/******************************************************************************/
+/*							Statistics of a run 							  */
+/******************************************************************************/
+struct Statistics {
+    std::string			name;
+    double				mean;
+    double				std;
+    double				rate;		/* Slow oscillations per minute			*/
+    std::vector<double>	psd;
+    std::vector<double>	frequencies;
+    double				step;		/* Time per step and column in ns		*/
+};
+
+template <typename Precision>
+Statistics get_statistics(const std::vector<double>& Param, uint64_t seed) {
+    const double fs = res/red;
+
+    std::vector<double> Par;
+    for (unsigned i=0; i < Columns; ++i) {
+        Par.insert(Par.end(), Param.begin(), Param.end());
+    }
+    Cortical_Column_Batch_T<Precision> Batch(Columns, Par.data(), Settings, seed);
+
+    std::vector<Event_Detector> Detectors(Columns, Event_Detector(fs));
+    std::vector<Welch_PSD> PSDs(Columns, Welch_PSD(fs, Segment));
+    std::vector<double> data(6);
+    std::vector<double*> pData;
+    for (auto& d : data) {
+        pData.push_back(&d);
+    }
+
+    double mean = 0, var = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int t=0; t < (T+onset)*res; ++t) {
+        Batch.iterate_ODE();
+        if(t >= onset*res && t%red == 0){
+            for (unsigned i=0; i < Columns; ++i) {
+                get_data(0, Batch, i, pData);
+                Detectors[i].add(data[0]);
+                PSDs[i].add(data[0]);
+                mean += data[0];
+                var  += data[0]*data[0];
+            }
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    Statistics stats;
+    stats.name	= Precision::name;
+    const double samples = (double) Columns*T*fs;
+    stats.mean	= mean/samples;
+    stats.std	= std::sqrt(var/samples - stats.mean*stats.mean);
+    stats.rate	= 0;
+    stats.psd	= std::vector<double>(Segment/2+1, 0.0);
+    for (unsigned i=0; i < Columns; ++i) {
+        stats.rate += Detectors[i].events().size() * 60. / (Columns*T);
+        std::vector<double> psd = PSDs[i].psd();
+        for (unsigned k=0; k < psd.size(); ++k) {
+            stats.psd[k] += psd[k]/Columns;
+        }
+    }
+    stats.frequencies	= PSDs[0].frequencies();
+    stats.step			= std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()
+                        / ((double) Columns*(T+onset)*res);
+    return stats;
+}
+
+/* Relative deviation of the spectrum in the 0.1-4 Hz range */
+double psd_deviation(const Statistics& stats, const Statistics& ref) {
+    double dev = 0, total = 0;
+    for (unsigned k=0; k < ref.psd.size(); ++k) {
+        if (ref.frequencies[k] >= 0.1 && ref.frequencies[k] <= 4) {
+            dev		+= std::abs(stats.psd[k] - ref.psd[k]);
+            total	+= ref.psd[k];
+        }
+    }
+    return dev/total;
+}
+
+/******************************************************************************/
+/*                              Main routine								  */
+/******************************************************************************/
+int main(void) {
+    std::cout << "backend " << MATH_BACKEND_NAME << ", " << Columns << " columns for " << T << " s\n";
+
+    const std::vector<std::vector<double>> Params = {{4.6, 1.33, 2.0}, {6.5, 2.0, 2.0}};
+    const char* label[] = {"N2", "N3"};
+    for (unsigned j=0; j < Params.size(); ++j) {
+        std::vector<Statistics> stats = {get_statistics<Double_Precision>(Params[j], 1),
+                                         get_statistics<Mixed_Precision> (Params[j], 1),
+                                         get_statistics<Single_Precision>(Params[j], 1),
+                                         get_statistics<Double_Precision>(Params[j], 2)};
+        stats.back().name = "double, seed 2";
+
+        std::cout << label[j] << ":\n";
+        for (auto& s : stats) {
+            std::cout << "  " << std::left << std::setw(15) << s.name << std::right
+                      << " mean Vp " << std::setw(8) << s.mean
+                      << " mV, std Vp " << std::setw(8) << s.std
+                      << " mV, " << std::setw(6) << s.rate
+                      << " SO/min, relative PSD deviation below 4 Hz " << std::setw(10)
+                      << psd_deviation(s, stats[0])
+                      << ", " << std::setw(6) << s.step << " ns per step\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,31 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+TARGET = precision_check
+
+SOURCES +=  Precision_Check.cpp \
+			Cortex_Model.cpp    \
+			Cortical_Column.cpp \
+			Cortical_Column_Batch.cpp \
+			Spectral_Analysis.cpp
+
+HEADERS +=  Cortex_Model.h      \
+			Cortical_Column.h   \
+			Cortical_Column_Batch.h \
+			Data_Storage.h      \
+			Event_Detection.h   \
+			Math_Backend.h      \
+			Random_Stream.h     \
+			Simulation_Settings.h \
+			Spectral_Analysis.h \
+			SRK4.h
+
+QMAKE_CXXFLAGS += -std=c++11
+QMAKE_CXXFLAGS_RELEASE -= -O1
+QMAKE_CXXFLAGS_RELEASE -= -O2
+QMAKE_CXXFLAGS_RELEASE *= -O3
+
+# Implementation of exp and pow, see Math_Backend.h
+DEFINES += MATH_BACKEND=0
@@ -0,0 +1,182 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*							Configurable recording							  */
+/*																			  */
+/*	A probe records one quantity of the column: a state variable in the		  */
+/*	order of Cortex_Model::Variable or one of the derived quantities Qp, Qi,  */
+/*	I_KNa and the input. Every probe has its own decimation in time steps	  */
+/*	and either samples every decimation-th step (as get_data does for red)	  */
+/*	or reduces every window of decimation steps to its mean, minimum or		  */
+/*	maximum. Derived quantities are only computed at the steps that need	  */
+/*	them, so a sampled probe costs nothing in between.						  */
+/*																			  */
+/*	Value k of a probe is written to data[k*stride], so several probes can	  */
+/*	share one interleaved buffer, and/or passed to the sink together with	  */
+/*	the index of the probe for streaming.									  */
+/******************************************************************************/
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Cortical_Column.h"
+#include "Instrumentation.h"
+
+struct Probe {
+    /* Derived quantities follow the state variables */
+    enum Quantity {
+        Qp = Cortex_Model::numStates,	/* Firing rate of the pyramidal population in ms^-1	*/
+        Qi,								/* Firing rate of the inhibitory population in ms^-1	*/
+        I_KNa,							/* Sodium dependent potassium current in mV/ms		*/
+        Input							/* Input of the stimulation as in set_input			*/
+    };
+
+    enum Reduction {Sample, Mean, Min, Max};
+
+    /* Throws std::invalid_argument for a quantity after Input */
+    Probe(unsigned quantity, unsigned decimation = 100, Reduction reduction = Sample,
+          double* data = nullptr, size_t length = 0, size_t stride = 1)
+    : quantity (checked(quantity))
+    , decimation (std::max(1u, decimation))
+    , reduction (reduction)
+    , data (data)
+    , length (length)
+    , stride (stride)
+    {}
+
+    unsigned	quantity;
+    unsigned	decimation;
+    Reduction	reduction;
+
+    /* Output buffer with room for length values, nullptr if only the sink is used */
+    double*		data;
+    size_t		length;
+    size_t		stride;
+private:
+    static unsigned checked (unsigned quantity) {
+        if (quantity > Input) {
+            throw std::invalid_argument("Probe: unknown quantity " + std::to_string(quantity));
+        }
+        return quantity;
+    }
+};
+
+class Probe_Recorder {
+public:
+    /* Called with the index of the probe and the value */
+    typedef std::function<void(unsigned, double)> Sink;
+
+    explicit Probe_Recorder(const std::vector<Probe>& probes, const Sink& sink = Sink())
+    : sink (sink)
+    {
+        for (auto& probe : probes) {
+            channels.push_back(Channel{probe, 0, 0.0, 0});
+        }
+    }
+
+    /* Called after every time step that is recorded */
+    void add (const Cortical_Column& C) {
+        INSTRUMENT_SCOPE(Instrumentation::GET_DATA);
+        for (unsigned i=0; i < channels.size(); ++i) {
+            Channel& ch = channels[i];
+            const Probe& p = ch.probe;
+            switch (p.reduction) {
+            case Probe::Sample:
+                if (ch.phase == 0) {
+                    emit(i, value(C, p.quantity));
+                }
+                break;
+            case Probe::Mean:
+                ch.acc += value(C, p.quantity);
+                if (ch.phase+1 == p.decimation) {
+                    emit(i, ch.acc / p.decimation);
+                }
+                break;
+            case Probe::Min:
+                ch.acc = ch.phase == 0 ? value(C, p.quantity) : std::min(ch.acc, value(C, p.quantity));
+                if (ch.phase+1 == p.decimation) {
+                    emit(i, ch.acc);
+                }
+                break;
+            case Probe::Max:
+                ch.acc = ch.phase == 0 ? value(C, p.quantity) : std::max(ch.acc, value(C, p.quantity));
+                if (ch.phase+1 == p.decimation) {
+                    emit(i, ch.acc);
+                }
+                break;
+            }
+            if (++ch.phase == p.decimation) {
+                ch.phase	= 0;
+                ch.acc		= 0;
+            }
+        }
+    }
+
+    /* Values of probe i so far */
+    size_t	count	(unsigned i) const {return channels[i].count;}
+
+    /* Values of a probe for the given number of time steps */
+    static size_t	values	(const Probe& probe, size_t steps) {
+        return probe.reduction == Probe::Sample ? (steps + probe.decimation - 1) / probe.decimation
+                                                : steps / probe.decimation;
+    }
+private:
+    struct Channel {
+        Probe		probe;
+        unsigned	phase;		/* Step within the current window		*/
+        double		acc;		/* Sum, minimum or maximum of the window	*/
+        size_t		count;		/* Values so far							*/
+    };
+
+    static double value (const Cortical_Column& C, unsigned quantity) {
+        const Cortex_Model::State& y = C.Stepper.state();
+        switch (quantity) {
+        case Probe::Qp:		return C.Model.Qp(y.data());
+        case Probe::Qi:		return Cortex_Model::Qi(y.data());
+        case Probe::I_KNa:	return C.Model.I_KNa(y.data());
+        case Probe::Input:	return C.input;
+        default:			return y[quantity];
+        }
+    }
+
+    void emit (unsigned i, double x) {
+        INSTRUMENT_COUNT(Instrumentation::SAMPLES);
+        Channel& ch = channels[i];
+        if (ch.probe.data && ch.count < ch.probe.length) {
+            ch.probe.data[ch.count*ch.probe.stride] = x;
+        }
+        if (sink) {
+            sink(i, x);
+        }
+        ++ch.count;
+    }
+
+    std::vector<Channel>	channels;
+    Sink					sink;
+};
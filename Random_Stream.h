@@ -27,13 +27,16 @@
 /*                          Random number streams                             */
 /******************************************************************************/
 #pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <random>
 
 class randomStreamNormal {
 public:
     explicit randomStreamNormal(double mean, double stddev)
     : mt(rand()), norm_dist(mean, stddev) {}
-    explicit randomStreamNormal(double mean, double stddev, double seed)
+    explicit randomStreamNormal(double mean, double stddev, uint64_t seed)
     : mt(seed), norm_dist(mean, stddev) {}
 
     double operator ()(void) { return norm_dist(mt); }
@@ -46,7 +49,7 @@ class randomStreamUniformInt {
 public:
     explicit randomStreamUniformInt(int lower_bound, int upper_bound)
     : mt(rand()), uniform_dist(lower_bound, upper_bound) {}
-    explicit randomStreamUniformInt(int lower_bound, int upper_bound, double seed)
+    explicit randomStreamUniformInt(int lower_bound, int upper_bound, uint64_t seed)
     : mt(seed), uniform_dist(lower_bound, upper_bound) {}
 
     int operator ()(void) { return uniform_dist(mt); }
@@ -54,3 +57,109 @@ private:
     std::mt19937_64                     mt;
     std::uniform_int_distribution<>     uniform_dist;
 };
+
+/******************************************************************************/
+/*                      Counter based normal distribution                     */
+/*                                                                            */
+/*  Philox4x32-10 (Salmon et al. 2011) maps a 128 bit counter and a 64 bit    */
+/*  key to 128 random bits. Every stream is identified by the global seed     */
+/*  (key) and the column and stream id (upper counter words), so the numbers  */
+/*  do not depend on the order in which streams are created or on threads.    */
+/*  The state is 24 bytes. Normals are created in blocks with Box-Muller, so  */
+/*  one counter value yields two normals. Every iteration of the block loop   */
+/*  is independent, which allows the compiler to vectorize the Philox rounds. */
+/*  The single precision version uses the same uniform numbers and does the  */
+/*  Box-Muller transform in float.                                            */
+/******************************************************************************/
+class randomStreamPhilox {
+public:
+    explicit randomStreamPhilox(uint64_t seed, uint32_t column, uint32_t stream)
+    : key(seed), column(column), stream(stream) {}
+
+    /* Fill out with n standard normal numbers, n has to be even */
+    void fill(double* out, unsigned n);
+    void fill(float* out, unsigned n);
+
+    /* Number of normals drawn so far */
+    uint64_t position(void) const {return 2*counter;}
+
+    /* Continue the stream after position normals, position has to be even */
+    void seek(uint64_t position) {counter = position/2;}
+
+    /* Identification of the stream */
+    uint64_t seed	(void) const {return key;}
+    uint32_t id		(void) const {return column;}
+private:
+    /* Fill out with n/2 pairs of uniform numbers in (0, 1] and [0, 1) */
+    void uniforms(double* out, unsigned n);
+
+    uint64_t	key;
+    uint32_t	column;
+    uint32_t	stream;
+    uint64_t	counter = 0;
+};
+
+inline void randomStreamPhilox::uniforms(double* out, unsigned n) {
+    const uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+    const uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+    const uint64_t one	= 0x3FF0000000000000;	/* bit pattern of 1.0 */
+
+    /* Random bits as two uniform numbers in (0, 1] and [0, 1). The upper 52
+     * bits are used as mantissa of a number in [1, 2) to avoid conversions */
+    for (unsigned k=0; k < n/2; ++k) {
+        const uint64_t c = counter + k;
+        uint32_t c0 = uint32_t(c), c1 = uint32_t(c >> 32), c2 = column, c3 = stream;
+        uint32_t k0 = uint32_t(key), k1 = uint32_t(key >> 32);
+        for (unsigned round=0; round < 10; ++round) {
+            const uint64_t p0 = uint64_t(M0) * c0;
+            const uint64_t p1 = uint64_t(M1) * c2;
+            const uint32_t t0 = uint32_t(p1 >> 32) ^ c1 ^ k0;
+            const uint32_t t2 = uint32_t(p0 >> 32) ^ c3 ^ k1;
+            c1 = uint32_t(p1);
+            c3 = uint32_t(p0);
+            c0 = t0;
+            c2 = t2;
+            k0 += W0;
+            k1 += W1;
+        }
+        const uint64_t u0 = one | (((uint64_t(c1) << 32) | c0) >> 12);
+        const uint64_t u1 = one | (((uint64_t(c3) << 32) | c2) >> 12);
+        double d0, d1;
+        std::memcpy(&d0, &u0, sizeof(d0));
+        std::memcpy(&d1, &u1, sizeof(d1));
+        out[2*k]	= 2.0 - d0;
+        out[2*k+1]	= d1 - 1.0;
+    }
+    counter += n/2;
+}
+
+inline void randomStreamPhilox::fill(double* out, unsigned n) {
+    const double two_pi	= 6.28318530717958647693;
+    uniforms(out, n);
+
+    /* Box-Muller transform */
+    for (unsigned k=0; k < n/2; ++k) {
+        const double r   = std::sqrt(-2*std::log(out[2*k]));
+        const double phi = two_pi * out[2*k+1];
+        out[2*k]	= r * std::cos(phi);
+        out[2*k+1]	= r * std::sin(phi);
+    }
+}
+
+inline void randomStreamPhilox::fill(float* out, unsigned n) {
+    const float two_pi	= 6.28318530717958647693f;
+    const unsigned Chunk = 64;
+    double u[Chunk];
+    for (unsigned m=0; m < n; m += Chunk) {
+        const unsigned length = n-m < Chunk ? n-m : Chunk;
+        uniforms(u, length);
+
+        /* Box-Muller transform */
+        for (unsigned k=0; k < length/2; ++k) {
+            const float r   = std::sqrt(-2*std::log(float(u[2*k])));
+            const float phi = two_pi * float(u[2*k+1]);
+            out[m+2*k]		= r * std::cos(phi);
+            out[m+2*k+1]	= r * std::sin(phi);
+        }
+    }
+}
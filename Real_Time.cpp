@@ -0,0 +1,182 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*					Functions of the real time closed loop mode				  */
+/******************************************************************************/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "Data_Storage.h"
+#include "Real_Time.h"
+#include "Warm_Start.h"
+
+constexpr unsigned Latency_Histogram::subBins;
+constexpr unsigned Latency_Histogram::numBins;
+
+/******************************************************************************/
+/*								Latency histogram							  */
+/******************************************************************************/
+unsigned Latency_Histogram::bin(int64_t ns) {
+    /* Values below 2*subBins get their own bin, above that the leading 7 bits */
+    unsigned shift = 0;
+    while ((ns >> shift) >= 2*subBins) {
+        ++shift;
+    }
+    return subBins*shift + (ns >> shift);
+}
+
+int64_t Latency_Histogram::lower(unsigned bin) {
+    if (bin < 2*subBins) {
+        return bin;
+    }
+    const unsigned shift = bin/subBins - 1;
+    return (int64_t) (bin - subBins*shift) << shift;
+}
+
+int64_t Latency_Histogram::width(unsigned bin) {
+    return bin < 2*subBins ? 1 : (int64_t) 1 << (bin/subBins - 1);
+}
+
+void Latency_Histogram::add(int64_t ns) {
+    ns = std::max<int64_t>(ns, 0);
+    ++bins[bin(ns)];
+    minimum = total == 0 ? ns : std::min(minimum, ns);
+    maximum = std::max(maximum, ns);
+    ++total;
+}
+
+double Latency_Histogram::quantile(double q) const {
+    if (total == 0) {
+        return 0;
+    }
+    const double rank = std::min(std::max(q, 0.0), 1.0) * total;
+    uint64_t sum = 0;
+    for (unsigned i=0; i < numBins; ++i) {
+        if (bins[i] == 0 || sum + bins[i] < rank) {
+            sum += bins[i];
+            continue;
+        }
+        /* Values are assumed to be spread evenly within the bin */
+        const double ns = lower(i) + (rank - sum) / bins[i] * width(i);
+        return 1E-3*std::min<double>(std::max<double>(ns, minimum), maximum);
+    }
+    return max();
+}
+
+/******************************************************************************/
+/*							Constructor and destructor						  */
+/******************************************************************************/
+Real_Time_Column::Real_Time_Column(double* Par, const Simulation_Settings& Settings,
+                                   unsigned block_steps, unsigned output_steps, uint64_t seed)
+    : Cortex (Par, Settings, seed)
+    , Settings (Settings)
+    , seed (seed)
+    , block (std::max(1u, block_steps))
+    , decimation (std::max(1u, output_steps))
+    , commands (1024)
+    , samples (Settings.res / decimation + 1)
+{}
+
+Real_Time_Column::~Real_Time_Column(void) {
+    stop();
+}
+
+int64_t Real_Time_Column::now(void) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Real_Time_Column::start(void) {
+    if (worker.joinable()) {
+        return;
+    }
+    if (warm_start(Cortex, Settings, seed) == 0) {
+        for (int t=0; t < Settings.onset*Settings.res; ++t) {
+            Cortex.iterate_ODE();
+        }
+    }
+    running.store(true, std::memory_order_release);
+    worker = std::thread(&Real_Time_Column::run, this);
+}
+
+void Real_Time_Column::stop(void) {
+    if (!worker.joinable()) {
+        return;
+    }
+    running.store(false, std::memory_order_release);
+    worker.join();
+}
+
+/******************************************************************************/
+/*								Simulation thread							  */
+/******************************************************************************/
+void Real_Time_Column::run(void) {
+    typedef std::chrono::steady_clock Clock;
+    const auto period = std::chrono::nanoseconds(std::llround(block * Settings.dt * 1E6));
+    auto deadline = Clock::now();
+
+    /* Samples of a block are published together after it */
+    std::vector<Sample> pending;
+    pending.reserve(block/decimation + 1);
+    uint64_t step = 0;
+    Command command;
+    while (running.load(std::memory_order_acquire)) {
+        /* Commands that arrived until now act on the next block */
+        while (commands.pop(command)) {
+            Cortex.set_input(command.input);
+            latency_command.add(now() - command.time);
+        }
+
+        for (unsigned i=0; i < block; ++i) {
+            Cortex.iterate_ODE();
+            if (++step % decimation == 0) {
+                pending.push_back(Sample{step, get_channel(Cortex, 0), now()});
+            }
+        }
+
+        const int64_t published = now();
+        for (auto& sample : pending) {
+            latency_sample.add(published - sample.time);
+            if (!samples.push(sample)) {
+                ++dropped;
+            }
+        }
+        pending.clear();
+        ++numBlocks;
+
+        /* Wait for the wall clock to catch up with the simulation */
+        deadline += period;
+        const auto finished = Clock::now();
+        if (finished > deadline) {
+            ++misses;
+            if (finished - deadline > period) {
+                deadline = finished;
+            }
+        } else {
+            std::this_thread::sleep_until(deadline);
+        }
+    }
+}
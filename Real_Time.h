@@ -0,0 +1,151 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*					Real time closed loop mode of a column					  */
+/*																			  */
+/*	A simulation thread paces Cortical_Column::iterate_ODE to the wall		  */
+/*	clock in blocks of block_steps steps, so a block of 10 steps at res = 1E4 */
+/*	is computed every ms. Every output_steps steps Vp is published through a */
+/*	lock free queue (1 kHz for output_steps = 10). Another thread switches	  */
+/*	the stimulus with set_input through a second queue, the commands are	  */
+/*	applied before the next block.											  */
+/*																			  */
+/*	Telemetry:																  */
+/*		command_latency	from send to the applied input						  */
+/*		sample_latency	from the computed state to the published sample		  */
+/*		deadline_misses	blocks that were finished after their deadline		  */
+/*	A block that is more than one period late restarts the schedule, so the   */
+/*	simulation does not try to catch up.									  */
+/*																			  */
+/*	The onset is simulated (or taken from the warm start cache) as fast as	  */
+/*	possible before the paced loop starts.									  */
+/******************************************************************************/
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "Cortical_Column.h"
+#include "SPSC_Queue.h"
+#include "Simulation_Settings.h"
+
+/******************************************************************************/
+/*								Latency histogram							  */
+/*	Log linear bins as in HDR histograms: exact below 128 ns, above that	  */
+/*	64 bins per power of 2, so the relative error stays below 1.6%. Only	  */
+/*	the simulation thread adds values, read it after stop().				  */
+/******************************************************************************/
+class Latency_Histogram {
+public:
+    void		add			(int64_t ns);
+
+    /* Latency in us below which the fraction q of all values lies, linearly
+     * interpolated within the bin and bounded by the extreme values */
+    double		quantile	(double q) const;
+
+    uint64_t	count		(void) const {return total;}
+    double		max			(void) const {return 1E-3*maximum;}
+
+    /* Bins per power of 2 and enough of them for every non negative int64 */
+    static constexpr unsigned	subBins	= 64;
+    static constexpr unsigned	numBins	= subBins * 58;
+private:
+    static unsigned	bin		(int64_t ns);
+    static int64_t	lower	(unsigned bin);
+    static int64_t	width	(unsigned bin);
+
+    std::vector<uint64_t>	bins = std::vector<uint64_t>(numBins, 0);
+    uint64_t				total	= 0;
+    int64_t					minimum	= 0;
+    int64_t					maximum	= 0;
+};
+
+class Real_Time_Column {
+public:
+    /* Vp after step steps since the end of the onset, time is the steady
+     * clock in ns when the state was computed */
+    struct Sample {
+        uint64_t	step;
+        double		Vp;
+        int64_t		time;
+    };
+
+    Real_Time_Column(double* Par,
+                     const Simulation_Settings& Settings = Simulation_Settings(),
+                     unsigned block_steps = 10,
+                     unsigned output_steps = 10,
+                     uint64_t seed = rand());
+
+    /* Stops the simulation thread */
+    ~Real_Time_Column(void);
+
+    /* Simulates the onset and starts the paced simulation thread */
+    void		start		(void);
+    void		stop		(void);
+
+    /* Client side: commands from one thread, samples read by one thread */
+    bool		stimulus_on	(double strength) {return send(strength);}
+    bool		stimulus_off(void) {return send(0.0);}
+    size_t		receive		(Sample* data, size_t n) {return samples.pop(data, n);}
+
+    /* Telemetry, valid after stop() */
+    const Latency_Histogram&	command_latency	(void) const {return latency_command;}
+    const Latency_Histogram&	sample_latency	(void) const {return latency_sample;}
+    uint64_t	deadline_misses	(void) const {return misses;}
+    uint64_t	dropped_samples	(void) const {return dropped;}
+    uint64_t	blocks			(void) const {return numBlocks;}
+
+    /* Steady clock in ns, the time base of samples and commands */
+    static int64_t	now			(void);
+private:
+    struct Command {
+        double		input;
+        int64_t		time;
+    };
+
+    bool		send		(double input) {return commands.push(Command{input, now()});}
+    void		run			(void);
+
+    Cortical_Column			Cortex;
+    const Simulation_Settings	Settings;
+    const uint64_t			seed;
+    const unsigned			block;
+    const unsigned			decimation;
+
+    SPSC_Queue<Command>		commands;
+    SPSC_Queue<Sample>		samples;
+
+    /* Telemetry of the simulation thread */
+    Latency_Histogram		latency_command;
+    Latency_Histogram		latency_sample;
+    uint64_t				misses		= 0;
+    uint64_t				dropped		= 0;
+    uint64_t				numBlocks	= 0;
+
+    std::atomic<bool>		running {false};
+    std::thread				worker;
+};
@@ -0,0 +1,101 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*					Lock free single producer single consumer queue			  */
+/*																			  */
+/*	Ring buffer with a power of two capacity. One thread may push and one	  */
+/*	other thread may pop at the same time without locks. Elements are moved  */
+/*	in blocks, a push either stores the whole block or nothing.				  */
+/******************************************************************************/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+template <typename T>
+class SPSC_Queue {
+public:
+    explicit SPSC_Queue(size_t capacity)
+    : buffer(round_up(capacity))
+    , mask(buffer.size()-1)
+    {}
+
+    /* Store n elements, returns false if there is not enough space */
+    bool push (const T* data, size_t n) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        const size_t h = head.load(std::memory_order_acquire);
+        if (buffer.size() - (t-h) < n) {
+            return false;
+        }
+        for (size_t i=0; i < n; ++i) {
+            buffer[(t+i) & mask] = data[i];
+        }
+        tail.store(t+n, std::memory_order_release);
+        return true;
+    }
+
+    bool push (const T& value) {
+        return push(&value, 1);
+    }
+
+    /* Fetch up to n elements, returns the number of elements fetched */
+    size_t pop (T* data, size_t n) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        const size_t t = tail.load(std::memory_order_acquire);
+        const size_t m = std::min(n, t-h);
+        for (size_t i=0; i < m; ++i) {
+            data[i] = buffer[(h+i) & mask];
+        }
+        head.store(h+m, std::memory_order_release);
+        return m;
+    }
+
+    bool pop (T& value) {
+        return pop(&value, 1) == 1;
+    }
+
+    /* Number of stored elements, only exact if called by one of the threads */
+    size_t size (void) const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    size_t capacity (void) const {return buffer.size();}
+private:
+    static size_t round_up (size_t n) {
+        size_t c = 1;
+        while (c < n) {
+            c *= 2;
+        }
+        return c;
+    }
+
+    std::vector<T>		buffer;
+    const size_t		mask;
+
+    /* Position of the consumer and the producer on separate cache lines */
+    alignas(64) std::atomic<size_t>	head {0};
+    alignas(64) std::atomic<size_t>	tail {0};
+};
@@ -0,0 +1,108 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*					Stochastic Runge-Kutta scheme of fourth order			  */
+/*																			  */
+/*	SRK4 integrates any model that describes itself at compile time as		  */
+/*	Cortex_Model does: a fixed size State, its initial value, the noise free  */
+/*	right hand side as functor and the states that are driven by noise.		  */
+/*	Every noise input m uses the two noise variables R[2*m] (I_l) and		  */
+/*	R[2*m+1] (I_l,0) that are passed to the step, including the input.		  */
+/*																			  */
+/*	The moments are std::arrays and the stages are loops of fixed length, so  */
+/*	the right hand side is inlined and the stages are unrolled, without heap */
+/*	allocation or virtual calls.											  */
+/******************************************************************************/
+#pragma once
+#include <array>
+#include <cmath>
+
+template <typename Model>
+class SRK4 {
+public:
+    typedef typename Model::State	State;
+    static constexpr unsigned	N	= Model::numStates;
+    static constexpr unsigned	M	= Model::numNoise;
+
+    /* Interation parameters for SRK4 */
+    static constexpr std::array<double,4> A = {{0.5, 0.5, 1.0, 1.0}};
+    static constexpr std::array<double,4> B = {{0.75, 0.75, 0.0, 0.0}};
+
+    SRK4() {
+        y.fill(State());
+        y[0] = Model::initial;
+    }
+
+    /* State at the beginning of the next step */
+    State&			state	(void)			{return y[0];}
+    const State&	state	(void) const	{return y[0];}
+
+    /* Computes moment K+1 from moment K */
+    void	stage	(const Model& f, unsigned K, double dt, const double* R);
+
+    /* Combines the moments into the new state */
+    void	combine	(const double* R);
+
+    /* A complete step */
+    void	step	(const Model& f, double dt, const double* R) {
+        for (unsigned K=0; K < 4; ++K) {
+            stage(f, K, dt, R);
+        }
+        combine(R);
+    }
+private:
+    /* Moment 0 is the state, moments 1-4 are the stages */
+    std::array<State, 5>	y;
+};
+
+/******************************************************************************/
+/*							Function definitions							  */
+/******************************************************************************/
+template <typename Model>
+constexpr std::array<double,4> SRK4<Model>::A;
+template <typename Model>
+constexpr std::array<double,4> SRK4<Model>::B;
+
+template <typename Model>
+inline void SRK4<Model>::stage(const Model& f, unsigned K, double dt, const double* R) {
+    State dydt;
+    f(y[K].data(), dydt.data());
+    for (unsigned i=0; i < N; ++i) {
+        y[K+1][i] = y[0][i] + A[K] * dt*dydt[i];
+    }
+    for (unsigned m=0; m < M; ++m) {
+        y[K+1][Model::noise_states[m]] += Model::noise_gain[m] * (R[2*m] + R[2*m+1]/std::sqrt(3))*B[K];
+    }
+}
+
+template <typename Model>
+inline void SRK4<Model>::combine(const double* R) {
+    for (unsigned i=0; i < N; ++i) {
+        y[0][i] = (-3*y[0][i] + 2*y[1][i] + 4*y[2][i] + 2*y[3][i] + y[4][i])/6;
+    }
+    for (unsigned m=0; m < M; ++m) {
+        y[0][Model::noise_states[m]] += Model::noise_gain[m] * (R[2*m] - R[2*m+1]*std::sqrt(3))/4;
+    }
+}
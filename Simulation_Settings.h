@@ -0,0 +1,54 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*                      Settings of a single simulation                       */
+/*                                                                            */
+/*  Every simulation carries its own settings, so that simulations with		  */
+/*  different resolution or onset can run concurrently. The default values	  */
+/*  are the ones used for the figures of the paper.							  */
+/******************************************************************************/
+#pragma once
+
+struct Simulation_Settings {
+    explicit Simulation_Settings(int onset = 10, int res = 1E4, int red = 1E2)
+    : onset (onset)
+    , res (res)
+    , red (red)
+    , dt (1E3/res)
+    {}
+
+    int		onset;		/* Time until data is stored in  s		  */
+    int		res;		/* Number of iteration steps per s		  */
+    int		red;		/* Number of iterations steps not saved	  */
+    double	dt;			/* Duration of a time step in ms		  */
+
+    /* Relative tolerance of the adaptive integrator that is used for noise
+     * free columns (dphi == 0), 0 disables it (see Dormand_Prince.h) */
+    double	tolerance	= 1E-6;
+
+    /* Decorrelation time in s after the cached state at the end of the onset,
+     * negative values simulate the onset (see Warm_Start.h) */
+    double	warm_start	= -1;
+};
@@ -0,0 +1,161 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*					Functions of the online spectral estimation				  */
+/******************************************************************************/
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "Spectral_Analysis.h"
+
+/******************************************************************************/
+/*								Constructor									  */
+/******************************************************************************/
+/* The radix 2 FFT only works for powers of 2 */
+static unsigned power_of_two(unsigned length) {
+    if (length < 2 || (length & (length-1)) != 0) {
+        throw std::invalid_argument("Welch_PSD: segment length has to be a power of 2");
+    }
+    return length;
+}
+
+/* Segments have to advance, a negative overlap would skip samples */
+static double fraction(double overlap) {
+    if (!(overlap >= 0 && overlap < 1)) {
+        throw std::invalid_argument("Welch_PSD: overlap has to be in [0, 1)");
+    }
+    return overlap;
+}
+
+Welch_PSD::Welch_PSD(double fs, unsigned length, double overlap)
+    : fs (fs)
+    , length (power_of_two(length))
+    , hop (std::max(1u, (unsigned) std::lround(length * (1-fraction(overlap)))))
+    , window (length)
+    , buffer (length, 0.0)
+    , data (length)
+    , twiddle (length/2)
+    , bitrev (length)
+    , accum (length/2+1, 0.0)
+{
+    const double pi = 3.14159265358979323846;
+
+    /* Periodic Hann window */
+    window_power = 0;
+    for (unsigned n=0; n < length; ++n) {
+        window[n] = 0.5 - 0.5*std::cos(2*pi*n/length);
+        window_power += window[n]*window[n];
+    }
+
+    /* Twiddle factors and bit reversal of the radix 2 FFT */
+    for (unsigned k=0; k < length/2; ++k) {
+        twiddle[k] = std::polar(1.0, -2*pi*k/length);
+    }
+    unsigned bits = 0;
+    while ((1u << bits) < length) {
+        ++bits;
+    }
+    for (unsigned n=0; n < length; ++n) {
+        unsigned r = 0;
+        for (unsigned b=0; b < bits; ++b) {
+            r |= ((n >> b) & 1) << (bits-1-b);
+        }
+        bitrev[n] = r;
+    }
+}
+
+/******************************************************************************/
+/*								Segment processing							  */
+/******************************************************************************/
+void Welch_PSD::process(void) {
+    /* Oldest sample is at pos */
+    double mean = 0;
+    for (double x : buffer) {
+        mean += x;
+    }
+    mean /= length;
+    for (unsigned n=0; n < length; ++n) {
+        data[bitrev[n]] = (buffer[(pos+n) % length] - mean) * window[n];
+    }
+    fft();
+
+    for (unsigned k=0; k <= length/2; ++k) {
+        accum[k] += std::norm(data[k]);
+    }
+    ++numSegments;
+}
+
+/* In place iterative radix 2 FFT of the bit reversed data */
+void Welch_PSD::fft(void) {
+    for (unsigned size=2; size <= length; size *= 2) {
+        const unsigned half = size/2;
+        const unsigned step = length/size;
+        for (unsigned start=0; start < length; start += size) {
+            for (unsigned k=0; k < half; ++k) {
+                const std::complex<double> t = twiddle[k*step] * data[start+k+half];
+                data[start+k+half] = data[start+k] - t;
+                data[start+k]	  += t;
+            }
+        }
+    }
+}
+
+/******************************************************************************/
+/*									Results									  */
+/******************************************************************************/
+std::vector<double> Welch_PSD::psd(void) const {
+    std::vector<double> result(accum.size(), 0.0);
+    if (numSegments == 0) {
+        return result;
+    }
+    const double scale = 1.0/(fs * window_power * numSegments);
+    for (unsigned k=0; k < accum.size(); ++k) {
+        /* Negative frequencies are folded onto the positive ones */
+        const double fold = (k == 0 || k == length/2) ? 1.0 : 2.0;
+        result[k] = fold * scale * accum[k];
+    }
+    return result;
+}
+
+std::vector<double> Welch_PSD::frequencies(void) const {
+    std::vector<double> f(accum.size());
+    for (unsigned k=0; k < f.size(); ++k) {
+        f[k] = k * fs / length;
+    }
+    return f;
+}
+
+double Welch_PSD::band_power(double lower, double upper) const {
+    const std::vector<double> P = psd();
+    const double df = fs / length;
+    double power = 0;
+    for (unsigned k=0; k < P.size(); ++k) {
+        if (k*df >= lower && k*df <= upper) {
+            power += P[k] * df;
+        }
+    }
+    return power;
+}
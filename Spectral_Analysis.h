@@ -0,0 +1,94 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*					Online power spectral density (Welch)					  */
+/*																			  */
+/*	Samples are added one at a time, e.g. every red iteration steps. Every	  */
+/*	time a new segment is complete, it is detrended (mean removed), Hann	  */
+/*	windowed and transformed, and its periodogram is added to the average.	  */
+/*	Memory is O(segment length) independent of the duration of the run.	  */
+/******************************************************************************/
+#pragma once
+#include <complex>
+#include <vector>
+
+class Welch_PSD {
+public:
+    /* fs is the sampling rate in Hz, length the segment length in samples (a
+     * power of 2) and overlap the fraction of overlap between segments (in
+     * [0, 1)), otherwise std::invalid_argument is thrown */
+    Welch_PSD(double fs, unsigned length, double overlap = 0.5);
+
+    /* Add the next sample */
+    void add (double x) {
+        buffer[pos] = x;
+        pos = (pos+1) % length;
+        if (filled < length) {
+            ++filled;
+        }
+        if (++count >= hop && filled == length) {
+            process();
+            count = 0;
+        }
+    }
+
+    /* One sided PSD averaged over all complete segments in unit^2/Hz */
+    std::vector<double> psd			(void) const;
+
+    /* Frequencies of the PSD in Hz */
+    std::vector<double> frequencies	(void) const;
+
+    /* Power in the band [lower, upper] Hz of the current average */
+    double		band_power	(double lower, double upper) const;
+
+    unsigned 	segments	(void) const {return numSegments;}
+private:
+    void process (void);
+    void fft	 (void);
+
+    /* Sampling rate, segment length and shift between segments */
+    const double			fs;
+    const unsigned			length;
+    const unsigned			hop;
+
+    /* Hann window and its power normalization */
+    std::vector<double>		window;
+    double					window_power;
+
+    /* Ring buffer of the last length samples */
+    std::vector<double>		buffer;
+    unsigned				pos		= 0;
+    unsigned				filled	= 0;
+    unsigned				count	= 0;
+
+    /* FFT work space, twiddle factors and bit reversed indices */
+    std::vector<std::complex<double>>	data;
+    std::vector<std::complex<double>>	twiddle;
+    std::vector<unsigned>				bitrev;
+
+    /* Sum of the one sided periodograms */
+    std::vector<double>		accum;
+    unsigned				numSegments	= 0;
+};
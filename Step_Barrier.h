@@ -0,0 +1,58 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*								Step barrier								  */
+/*	Synchronizes the threads of Cortical_Network and Cortical_Sheet between  */
+/*	phases of a step. The last thread to arrive runs completion before the others */
+/*	continue.																  */
+/******************************************************************************/
+#pragma once
+#include <condition_variable>
+#include <mutex>
+
+class Step_Barrier {
+public:
+    explicit Step_Barrier(unsigned count) : count(count) {}
+
+    template <typename Completion>
+    void wait (Completion completion) {
+        std::unique_lock<std::mutex> lock(mutex);
+        const unsigned long current = generation;
+        if (++arrived == count) {
+            completion();
+            arrived = 0;
+            ++generation;
+            condition.notify_all();
+        } else {
+            condition.wait(lock, [&]() {return generation != current;});
+        }
+    }
+private:
+    std::mutex				mutex;
+    std::condition_variable	condition;
+    const unsigned			count;
+    unsigned				arrived		= 0;
+    unsigned long			generation	= 0;
+};
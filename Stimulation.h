@@ -28,12 +28,27 @@
 
 /******************************************************************************/
 /*					Implementation of the stimulation protocol				  */
+/*																			  */
+/*	All transitions of the protocol are kept as absolute time steps, so		  */
+/*	next_event knows when the input changes next. In between check_stim has	  */
+/*	no effect and run advances the simulation without calling it. Only the	  */
+/*	search for a minimum of the phase dependent mode needs every step.		  */
 /******************************************************************************/
 #pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
 #include <vector>
 
 #include "Cortical_Column.h"
+#include "Event_Detection.h"
+#include "Instrumentation.h"
 #include "Random_Stream.h"
+#include "Simulation_Settings.h"
+
+/* MATLAB array type for the marker output of the mex interface */
+typedef struct mxArray_tag mxArray;
 
 /******************************************************************************/
 /*								Stimulation object							  */
@@ -43,7 +58,10 @@ public:
     /* Empty constructor for compiling */
     Stim(void);
 
-    Stim(Cortical_Column& C, double* var)
+    Stim(Cortical_Column& C, double* var,
+         const Simulation_Settings& S = Simulation_Settings(), uint64_t seed = rand())
+    : Settings(S)
+    , Seed(seed)
     { Cortex = &C; setup(var);}
 
     /* Initialize stimulation class with respect to stimulation mode */
@@ -51,6 +69,44 @@ public:
 
     /* Check whether stimulation should be started/stopped */
     void check_stim	(int time);
+
+    /* Starts the protocol at time, e.g. at a branch point (see Trial_Fork.h).
+     * Semi-periodic stimulation has its first stimulus at time, the phase
+     * dependent one continues as if a minimum had been found at time */
+    void trigger	(int time);
+
+    /* First time step >= time at which check_stim has to be called */
+    int  next_event	(int time) const;
+
+    /* Calls step(t) for the time steps [begin, end) and check_stim(t) after
+     * the steps at which an event is due */
+    template <typename Step>
+    void run		(int begin, int end, Step step);
+
+    /* Onsets of the stimulation events in time steps after onset */
+    const std::vector<int>& markers (void) const {return marker_stimulation;}
+
+    /* Progress of the protocol. Restoring it into a Stim with the same
+     * protocol and seed continues the protocol exactly, the input itself is
+     * part of the state of the column */
+    struct State {
+        bool				started;			/* Stimulus switched on			*/
+        bool				minimum_found;
+        bool				paused;
+        int					count;				/* Stimulus within the event	*/
+        int					time_to_stimuli;
+        int					time_off;
+        int					time_next_stimulus;
+        int					time_pause_end;
+        std::array<int, 3>	offsets;			/* Duration, pause and minimum	*/
+        bool				crossed;			/* Trough search				*/
+        double				Vp_old;
+        double				minimum;
+        uint64_t			draws;				/* Random ISI drawn so far		*/
+        std::vector<int>	markers;
+    };
+    State	get_state	(void) const;
+    void	set_state	(const State& state);
 private:
     /* Mode of stimulation 	*/
     /* 0 == none 			*/
@@ -81,16 +137,13 @@ private:
     /* Time between stimuli in case of multiple stimuli per event */
     int 	time_between_stimuli 	= 1050E1;
 
-    /* Threshold for phase dependent stimulation */
-    double 	threshold				= -72;
+    /* Threshold crossing and minimum search for phase dependent stimulation */
+    Trough_Search search			= Trough_Search(-72);
 
     /* Internal variables */
     /* Simulation on for TRUE and off for FALSE */
     bool 	stimulation_started 	= false;
 
-    /* If threshold has been reached */
-    bool 	threshold_crossed		= false;
-
     /* If minimum was found */
     bool 	minimum_found			= false;
 
@@ -103,26 +156,37 @@ private:
     /* Counter for number of stimuli that occurred within a stimulation event */
     int 	count_stimuli 			= 1;
 
-    /* Counter for stimulation duration since started*/
-    int 	count_duration			= 0;
+    /* Time step at which the current stimulus is switched off */
+    int 	time_off				= 0;
 
-    /* Counter after minimum was found */
-    int 	count_to_start 			= 0;
+    /* Time step of the next stimulus after a minimum was found */
+    int 	time_next_stimulus		= 0;
 
-    /* Counter for time between two stimulation events (with multiple tones) */
-    int 	count_pause 			= 0;
+    /* Time step at which the pause between stimulation events ends */
+    int 	time_pause_end			= 0;
 
-    /* Old voltage value for minimum detection */
-    double 	Vp_old					= 0;
+    /* The counters of duration, pause and delay to the stimulation restart
+     * at 1 after they were used once, so later ones are one step shorter */
+    int 	duration_offset			= 0;
+    int 	pause_offset			= 0;
+    int 	minimum_offset			= 0;
 
     /* Pointer to columns */
     Cortical_Column* Cortex;
 
+    /* Resolution and onset of the simulation */
+    Simulation_Settings Settings;
+
+    /* Seed of the random inter stimulus intervals */
+    uint64_t Seed;
+
     /* Data containers */
     std::vector<int> marker_stimulation;
 
-    /* Random number generator in case of semi-periodic stimulation */
+    /* Random number generator in case of semi-periodic stimulation and the
+     * number of intervals drawn from it */
     randomStreamUniformInt Uniform_Distribution = randomStreamUniformInt(0, 0);
+    uint64_t	ISI_draws	= 0;
 
     /* Create MATLAB container for marker storage */
     friend mxArray* get_marker(Stim &stim);
@@ -131,9 +195,9 @@ private:
 /******************************************************************************/
 /*							Function definitions							  */
 /******************************************************************************/
-void Stim::setup (double* var_stim) {
-    extern const int onset;
-    extern const int res;
+inline void Stim::setup (double* var_stim) {
+    const int onset	= Settings.onset;
+    const int res	= Settings.res;
 
     /* Set the onset onset_correction for the marker */
     onset_correction 		= onset * res;
@@ -167,7 +231,7 @@ void Stim::setup (double* var_stim) {
         /* If ISI is random create RNG */
         if (ISI_range != 0){
             /* Generate uniform distribution */
-            Uniform_Distribution = randomStreamUniformInt(ISI-ISI_range, ISI+ISI_range);
+            Uniform_Distribution = randomStreamUniformInt(ISI-ISI_range, ISI+ISI_range, Seed);
         }
     } else {
         /* In case of phase dependent stimulation, time_to_stim is the time from
@@ -177,7 +241,25 @@ void Stim::setup (double* var_stim) {
     }
 }
 
-void Stim::check_stim	(int time) {
+inline void Stim::check_stim	(int time) {
+    INSTRUMENT_SCOPE(Instrumentation::CHECK_STIM);
+
+    /* Switches the stimulation on, the duration counts from the first of
+     * overlapping stimuli */
+    auto start = [this, time]() {
+        if (!stimulation_started) {
+            time_off = time + duration - duration_offset;
+        }
+        stimulation_started 	= true;
+        Cortex->set_input(strength);
+        INSTRUMENT_COUNT(Instrumentation::STIM_ON);
+
+        /* Add marker for the first stimuli in the event */
+        if(count_stimuli == 1) {
+            marker_stimulation.push_back(time - onset_correction);
+        }
+    };
+
     /* Check if stimulation should start */
     switch (mode) {
 
@@ -189,14 +271,7 @@ void Stim::check_stim	(int time) {
     case 1:
         /* Check if stimulation time is reached */
         if(time == time_to_stimuli) {
-            /* Switch stimulation on */
-            stimulation_started 	= true;
-            Cortex->set_input(strength);
-
-            /* Add marker for the first stimuli in the event */
-            if(count_stimuli == 1) {
-                marker_stimulation.push_back(time - onset_correction);
-            }
+            start();
 
             /* Check if multiple stimuli should be applied */
             if (count_stimuli < number_of_stimuli) {
@@ -206,7 +281,12 @@ void Stim::check_stim	(int time) {
             }
             /* After last stimulus in event update the timer with respect to (random) ISI*/
             else {
-                time_to_stimuli += (ISI_range==0)? ISI : Uniform_Distribution();
+                if (ISI_range == 0) {
+                    time_to_stimuli += ISI;
+                } else {
+                    time_to_stimuli += Uniform_Distribution();
+                    ++ISI_draws;
+                }
 
                 /* Reset the stimulus counter for next stimulation event */
                 count_stimuli = 1;
@@ -216,75 +296,142 @@ void Stim::check_stim	(int time) {
 
     /* Phase dependent stimulation */
     case 2:
-        /* Search for threshold */
-        if(!stimulation_started &&
-           !minimum_found       &&
-           !threshold_crossed   &&
-           !stimulation_paused  &&
-           time>onset_correction) {
-            if(Cortex->Vp[0]<=threshold) {
-                threshold_crossed 	= true;
-            }
+        /* Search for threshold and the following minimum */
+        if(search.check(Cortex->Stepper.state()[Cortex_Model::Vp],
+                        !stimulation_started &&
+                        !minimum_found       &&
+                        !stimulation_paused  &&
+                        time>onset_correction) && !minimum_found) {
+            minimum_found 		= true;
+            time_next_stimulus	= time - minimum_offset + time_to_stimuli;
         }
 
-        /* Search for minimum */
-        if(threshold_crossed) {
-            if(Cortex->Vp[0]>Vp_old) {
-                threshold_crossed 	= false;
-                minimum_found 		= true;
-                Vp_old = 0;
+        /* Start stimulation after time_to_stimuli has passed */
+        if(minimum_found && time == time_next_stimulus) {
+            start();
+
+            /* Check if multiple stimuli should be applied */
+            if (count_stimuli < number_of_stimuli) {
+                /* Update the number of stimuli */
+                count_stimuli++;
+                time_next_stimulus += time_between_stimuli;
             } else {
-                Vp_old = Cortex->Vp[0];
+                /* After last stimulus in event pause the stimulation */
+                minimum_found 			= false;
+                stimulation_paused 		= true;
+                time_pause_end			= time + ISI - pause_offset;
+                minimum_offset			= 1;
+
+                /* Reset the stimulus counter for next stimulation event */
+                count_stimuli = 1;
             }
         }
+        break;
+    }
 
-        /* Wait until the stimulation should start */
-        if(minimum_found) {
-            /* Start stimulation after time_to_stimuli has passed */
-            if(count_to_start==time_to_stimuli + (count_stimuli-1) * time_between_stimuli) {
-                stimulation_started 	= true;
-                Cortex->set_input(strength);
+    /* Wait to switch the stimulation off */
+    if(stimulation_started && time == time_off) {
+        stimulation_started 	= false;
+        duration_offset			= 1;
+        Cortex->set_input(0.0);
+        INSTRUMENT_COUNT(Instrumentation::STIM_OFF);
+    }
 
-                /* Add marker for the first stimuli in the event */
-                if(count_stimuli == 1) {
-                    marker_stimulation.push_back(time - onset_correction);
-                }
+    /* Wait if there is a pause between stimulation events */
+    if(stimulation_paused && time == time_pause_end) {
+        stimulation_paused	= false;
+        pause_offset		= 1;
+    }
+}
 
-                /* Check if multiple stimuli should be applied */
-                if (count_stimuli < number_of_stimuli) {
-                    /* Update the number of stimuli */
-                    count_stimuli++;
-                } else {
-                    /* After last stimulus in event pause the stimulation */
-                    minimum_found 			= false;
-                    stimulation_paused 		= true;
-                    count_to_start 			= 0;
+inline void Stim::trigger (int time) {
+    if (mode == 1) {
+        time_to_stimuli		= time;
+    } else if (mode == 2) {
+        minimum_found 		= true;
+        time_next_stimulus	= time - minimum_offset + time_to_stimuli;
+    }
+}
 
-                    /* Reset the stimulus counter for next stimulation event */
-                    count_stimuli = 1;
-                }
-            }
-            count_to_start++;
+inline Stim::State Stim::get_state (void) const {
+    return State{stimulation_started, minimum_found, stimulation_paused, count_stimuli,
+                 time_to_stimuli, time_off, time_next_stimulus, time_pause_end,
+                 {{duration_offset, pause_offset, minimum_offset}},
+                 search.crossed(), search.last(), search.trough(),
+                 ISI_draws, marker_stimulation};
+}
+
+inline void Stim::set_state (const State& state) {
+    stimulation_started	= state.started;
+    minimum_found		= state.minimum_found;
+    stimulation_paused	= state.paused;
+    count_stimuli		= state.count;
+    time_to_stimuli		= state.time_to_stimuli;
+    time_off			= state.time_off;
+    time_next_stimulus	= state.time_next_stimulus;
+    time_pause_end		= state.time_pause_end;
+    duration_offset		= state.offsets[0];
+    pause_offset		= state.offsets[1];
+    minimum_offset		= state.offsets[2];
+    search.restore(state.crossed, state.Vp_old, state.minimum);
+    marker_stimulation	= state.markers;
+
+    /* The random intervals are drawn again from the start of the stream */
+    if (mode == 1 && ISI_range != 0) {
+        Uniform_Distribution = randomStreamUniformInt(ISI-ISI_range, ISI+ISI_range, Seed);
+        for (ISI_draws = 0; ISI_draws < state.draws; ++ISI_draws) {
+            Uniform_Distribution();
         }
-        break;
     }
+}
 
-    /* Wait to switch the stimulation off */
-    if(stimulation_started) {
-        if(count_duration==duration) {
-            stimulation_started 	= false;
-            count_duration			= 0;
-            Cortex->set_input(0.0);
+inline int Stim::next_event (int time) const {
+    int next = std::numeric_limits<int>::max();
+    auto candidate = [&next, time](int event) {
+        if (event >= time) {
+            next = std::min(next, event);
+        }
+    };
+
+    switch (mode) {
+    default:
+        break;
+
+    case 1:
+        candidate(time_to_stimuli);
+        break;
+
+    /* The search needs Vp of every step while it is armed or a threshold
+     * crossing waits for its minimum */
+    case 2:
+        if (search.crossed()) {
+            candidate(time);
+        } else if (!stimulation_started && !minimum_found && !stimulation_paused) {
+            candidate(std::max(time, onset_correction+1));
+        }
+        if (minimum_found) {
+            candidate(time_next_stimulus);
         }
-        count_duration++;
+        if (stimulation_paused) {
+            candidate(time_pause_end);
+        }
+        break;
     }
+    if (stimulation_started) {
+        candidate(time_off);
+    }
+    return next;
+}
 
-    /* Wait if there is a pause between stimulation events */
-    if(stimulation_paused) {
-        if(count_pause == ISI) {
-            stimulation_paused	= false;
-            count_pause 		= 0;
+template <typename Step>
+void Stim::run (int begin, int end, Step step) {
+    for (int t=begin; t < end; ++t) {
+        /* Steps without a change of the input */
+        const int event = std::min(next_event(t), end-1);
+        for (; t < event; ++t) {
+            step(t);
         }
-        count_pause++;
+        step(t);
+        check_stim(t);
     }
 }
@@ -0,0 +1,173 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*					Functions of the streaming recorder						  */
+/******************************************************************************/
+#include <chrono>
+#include <cstring>
+
+#include "Trace_Writer.h"
+
+constexpr unsigned Trace_Writer::header_size;
+constexpr unsigned Trace_Writer::name_length;
+
+/* Parameters and channel names have to fit into the fixed size header */
+static bool header_fits(std::size_t numChannels, std::size_t numParams) {
+    return 48 + 8*numParams + Trace_Writer::name_length*numChannels <= Trace_Writer::header_size;
+}
+
+/******************************************************************************/
+/*							Constructor and destructor						  */
+/******************************************************************************/
+Trace_Writer::Trace_Writer(const std::string& path,
+                           const std::vector<std::string>& channels,
+                           const std::vector<double>& parameters,
+                           const Simulation_Settings& Settings,
+                           unsigned chunk_samples,
+                           unsigned buffered_chunks)
+    : file (header_fits(channels.size(), parameters.size()) ? std::fopen(path.c_str(), "wb") : nullptr)
+    , numChannels (channels.size())
+    , chunk_size (chunk_samples * channels.size())
+    , queue (buffered_chunks * chunk_samples * channels.size())
+    , chunk (chunk_samples * channels.size())
+{
+    if (!file) {
+        failed.store(true, std::memory_order_relaxed);
+        return;
+    }
+    write_header(channels, parameters, Settings);
+    writer = std::thread(&Trace_Writer::run, this);
+}
+
+Trace_Writer::~Trace_Writer(void) {
+    close();
+}
+
+void Trace_Writer::close(void) {
+    if (!file) {
+        return;
+    }
+    finished.store(true, std::memory_order_release);
+    writer.join();
+    if (std::fclose(file) != 0) {
+        failed.store(true, std::memory_order_relaxed);
+    }
+    file = nullptr;
+}
+
+/******************************************************************************/
+/*								Producer side								  */
+/******************************************************************************/
+void Trace_Writer::push(const double* sample) {
+    if (!file) {
+        return;
+    }
+    while (!queue.push(sample, numChannels)) {
+        std::this_thread::yield();
+    }
+}
+
+/******************************************************************************/
+/*								Writer thread								  */
+/******************************************************************************/
+void Trace_Writer::write_header(const std::vector<std::string>& channels,
+                                const std::vector<double>& parameters,
+                                const Simulation_Settings& Settings) {
+    std::vector<char> header(header_size, 0);
+    const uint32_t version		= 1;
+    const uint32_t size			= header_size;
+    const uint32_t numParams	= parameters.size();
+    const uint32_t res			= Settings.res;
+    const uint32_t red			= Settings.red;
+    const uint32_t channel_count= numChannels;
+
+    std::memcpy(&header[0],  "NMTRACE", 8);
+    std::memcpy(&header[8],  &version,		 4);
+    std::memcpy(&header[12], &size,			 4);
+    std::memcpy(&header[16], &channel_count, 4);
+    std::memcpy(&header[20], &numParams,	 4);
+    std::memcpy(&header[24], &Settings.dt,	 8);
+    std::memcpy(&header[32], &res,			 4);
+    std::memcpy(&header[36], &red,			 4);
+    std::memcpy(&header[40], &samples,		 8);
+
+    /* The constructor ensured that parameters and names fit, longer names are cut */
+    unsigned offset = 48;
+    for (double p : parameters) {
+        std::memcpy(&header[offset], &p, 8);
+        offset += 8;
+    }
+    for (auto& name : channels) {
+        std::strncpy(&header[offset], name.c_str(), name_length-1);
+        offset += name_length;
+    }
+    if (std::fwrite(header.data(), 1, header_size, file) != header_size ||
+        std::fflush(file) != 0) {
+        failed.store(true, std::memory_order_relaxed);
+    }
+}
+
+void Trace_Writer::write_chunk(unsigned length) {
+    /* After an error the trace ends with the last complete chunk */
+    if (length == 0 || failed.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    /* Data has to be in the file before the sample count is updated */
+    if (std::fwrite(chunk.data(), sizeof(double), length, file) != length ||
+        std::fflush(file) != 0) {
+        failed.store(true, std::memory_order_relaxed);
+        return;
+    }
+    samples += length/numChannels;
+
+    if (std::fseek(file, 40, SEEK_SET) != 0 ||
+        std::fwrite(&samples, sizeof(samples), 1, file) != 1 ||
+        std::fflush(file) != 0 ||
+        std::fseek(file, 0, SEEK_END) != 0) {
+        failed.store(true, std::memory_order_relaxed);
+    }
+}
+
+void Trace_Writer::run(void) {
+    unsigned filled = 0;
+    while (true) {
+        /* Samples are pushed as a whole, so only complete samples are read */
+        const bool last = finished.load(std::memory_order_acquire);
+        filled += queue.pop(&chunk[filled], chunk_size - filled);
+        if (filled == chunk_size) {
+            write_chunk(filled);
+            filled = 0;
+        } else if (last) {
+            /* Queue was empty after the producer finished */
+            if (queue.size() == 0) {
+                write_chunk(filled);
+                break;
+            }
+        } else if (queue.size() == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
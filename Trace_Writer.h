@@ -0,0 +1,110 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*					Streaming recorder for long simulations					  */
+/*																			  */
+/*	The simulation pushes every recorded sample (one value per channel) into */
+/*	a lock free ring buffer. A background thread writes them in chunks to a	  */
+/*	binary file, so that memory use does not depend on the duration.		  */
+/*																			  */
+/*	File layout (native byte order):										  */
+/*		0	char[8]		"NMTRACE"											  */
+/*		8	uint32		version (1)											  */
+/*		12	uint32		size of the header in bytes (4096)					  */
+/*		16	uint32		number of channels C								  */
+/*		20	uint32		number of parameters P								  */
+/*		24	double		dt in ms											  */
+/*		32	uint32		res, iteration steps per s							  */
+/*		36	uint32		red, iteration steps per sample						  */
+/*		40	uint64		number of samples written so far					  */
+/*		48	double[P]	parameters (e.g. Param_Cortex followed by var_stim)	  */
+/*			char[C][32]	channel names										  */
+/*		4096 double[N][C] samples, all channels of a sample after another	  */
+/*																			  */
+/*	The sample count is updated after every chunk, so the file can be read	  */
+/*	(or memory mapped, see Figures/Tools/read_trace.m) while it is written.   */
+/*	It only counts samples that were flushed completely, after a write error */
+/*	no further chunks are written.											  */
+/******************************************************************************/
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SPSC_Queue.h"
+#include "Simulation_Settings.h"
+
+class Trace_Writer {
+public:
+    Trace_Writer(const std::string& path,
+                 const std::vector<std::string>& channels,
+                 const std::vector<double>& parameters,
+                 const Simulation_Settings& Settings,
+                 unsigned chunk_samples = 4096,
+                 unsigned buffered_chunks = 4);
+
+    /* Flushes the remaining samples and closes the file */
+    ~Trace_Writer(void);
+
+    /* Store one sample, waits if the writer thread falls behind */
+    void push	(const double* sample);
+
+    /* Flushes the remaining samples and closes the file */
+    void close	(void);
+
+    /* False if the file could not be opened, the parameters and channel names
+     * do not fit into the header or writing failed. Stays valid after close */
+    bool good	(void) const {return !failed.load(std::memory_order_relaxed);}
+
+    /* Size of the header and the maximal length of a channel name */
+    static constexpr unsigned	header_size	= 4096;
+    static constexpr unsigned	name_length	= 32;
+private:
+    void write_header	(const std::vector<std::string>& channels,
+                         const std::vector<double>& parameters,
+                         const Simulation_Settings& Settings);
+    void write_chunk	(unsigned length);
+    void run			(void);
+
+    std::FILE*				file;
+    const unsigned			numChannels;
+    const unsigned			chunk_size;
+
+    /* Buffer between the simulation and the writer thread */
+    SPSC_Queue<double>		queue;
+
+    /* Chunk that is written next */
+    std::vector<double>		chunk;
+
+    /* Number of samples in the file */
+    uint64_t				samples	= 0;
+
+    std::atomic<bool>		finished {false};
+    std::atomic<bool>		failed	 {false};
+    std::thread				writer;
+};
@@ -0,0 +1,132 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*						Functions of the forked trials						  */
+/******************************************************************************/
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "Cortical_Column.h"
+#include "Data_Storage.h"
+#include "Dormand_Prince.h"
+#include "Event_Detection.h"
+#include "Stimulation.h"
+#include "Trial_Fork.h"
+#include "Warm_Start.h"
+
+Fork_Result run_forks(const Fork_Job& job, const Simulation_Settings& Settings,
+                      unsigned threads) {
+    const int onset	= Settings.onset;
+    const int res	= Settings.res;
+    const int red	= Settings.red;
+
+    /* Copy as the constructor expects mutable parameters */
+    std::vector<double> Param_Cortex = job.Param_Cortex;
+    Cortical_Column Cortex(Param_Cortex.data(), Settings, job.seed, job.id);
+
+    /* Noise free columns are integrated adaptively */
+    const bool adaptive = Dormand_Prince::applicable(Cortex, Settings);
+
+    /* Shared prefix until the branch point */
+    Fork_Result result;
+    {
+        Dormand_Prince Solver(Cortex, Settings);
+        Trough_Search search(job.threshold);
+        const int t_search	= onset*res + (int) (job.branch_time*res);
+        const int t_limit	= job.trough ? t_search + job.T*res : t_search;
+        for (int t = warm_start(Cortex, Settings, job.seed, job.id); t <= t_limit; ++t) {
+            if (adaptive) {
+                Solver.step();
+            } else {
+                Cortex.iterate_ODE();
+            }
+            if (job.trough ? search.check(get_channel(Cortex, 0), t > t_search) : t == t_search) {
+                result.branch_step = t;
+                break;
+            }
+        }
+    }
+    if (result.branch_step < 0) {
+        return result;
+    }
+    const int t_branch	= result.branch_step;
+    result.first_sample	= t_branch/red + 1 - onset*res/red;
+    result.branches.resize(job.Stims.size());
+
+    /* Every branch continues a copy of the column with its own protocol */
+    auto branch = [&](unsigned k) {
+        Cortical_Column Copy(Cortex);
+        std::vector<double> var_stim = job.Stims[k];
+        Stim Stimulation(Copy, var_stim.data(), Settings, job.seed + job.id);
+        Stimulation.trigger(t_branch);
+        Stimulation.check_stim(t_branch);
+        Dormand_Prince Solver(Copy, Settings);
+
+        Sweep_Result& data = result.branches[k];
+        data.data.resize(6 * job.T*res/red);
+        std::vector<double*> dataPointer;
+        for (unsigned i=0; i < 6; ++i) {
+            dataPointer.push_back(data.channel(i));
+        }
+        int count = 0;
+        Stimulation.run(t_branch + 1, t_branch + job.T*res + 1, [&](int t) {
+            if (adaptive) {
+                Solver.step();
+            } else {
+                Copy.iterate_ODE();
+            }
+            if (t%red == 0) {
+                get_data(count, Copy, dataPointer);
+                ++count;
+            }
+        });
+
+        /* Marker in samples as returned by Cortex_mex */
+        for (auto& elem : Stimulation.markers()) {
+            data.marker.push_back(elem/red);
+        }
+    };
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::max(1u, std::min<unsigned>(threads, job.Stims.size()));
+    std::atomic<unsigned> next(0);
+    auto work = [&]() {
+        for (unsigned k = next++; k < job.Stims.size(); k = next++) {
+            branch(k);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned i=1; i < threads; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return result;
+}
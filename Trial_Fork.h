@@ -0,0 +1,83 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*					Forked trials from a shared background					  */
+/*																			  */
+/*	Stimulation protocols are compared on the same ongoing activity: the		  */
+/*	column is simulated once until a branch point, a fixed time or the first  */
+/*	trough of Vp after that time (threshold crossing and minimum as in the	  */
+/*	phase dependent stimulation). There the complete state, including the	  */
+/*	position of the noise streams, is copied for every protocol and the		  */
+/*	copies continue in parallel for T seconds. All branches therefore see	  */
+/*	the same noise and differ only by their stimulation.						  */
+/*																			  */
+/*	Every protocol is started at the branch point with Stim::trigger: semi-	  */
+/*	periodic protocols have their first stimulus there and phase dependent	  */
+/*	ones treat it as the detected minimum, so the delay to their first		  */
+/*	stimulus is time_to_stimuli. Noise free columns restart the step size	  */
+/*	control of the adaptive integrator in every branch.						  */
+/******************************************************************************/
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Parameter_Sweep.h"
+#include "Simulation_Settings.h"
+
+/******************************************************************************/
+/*							Description of the trials						  */
+/******************************************************************************/
+struct Fork_Job {
+    int					T;				/* Duration of every branch in s		*/
+    std::vector<double>	Param_Cortex;	/* Parameters of cortical module 		*/
+    std::vector<std::vector<double>> Stims;	/* Stimulation protocol of every branch	*/
+    double				branch_time;	/* Time of the branch point after the	*/
+                                        /* onset in s, or start of the search	*/
+    bool				trough;			/* Branch at the first trough instead	*/
+    double				threshold;		/* Threshold of the trough search in mV	*/
+    uint64_t			seed;			/* Global seed of the noise				*/
+    uint32_t			id;				/* Id of the noise streams				*/
+};
+
+/******************************************************************************/
+/*							Output of the trials							  */
+/******************************************************************************/
+struct Fork_Result {
+    /* Time step of the branch point counted as in Cortex_mex (the onset
+     * included), -1 if no trough was found within T seconds */
+    int							branch_step	= -1;
+
+    /* Index of the first sample of the branches in the samples of Cortex_mex */
+    int							first_sample = 0;
+
+    /* One result per protocol with T*res/red samples from the branch point
+     * on, the markers are indices in the samples of Cortex_mex */
+    std::vector<Sweep_Result>	branches;
+};
+
+/* Simulates the shared prefix once and the branches with the given number of
+ * threads. A thread number of 0 uses all available cores */
+Fork_Result run_forks	(const Fork_Job& job, const Simulation_Settings& Settings,
+                         unsigned threads = 0);
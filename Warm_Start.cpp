@@ -0,0 +1,200 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*						Functions of the warm start cache					  */
+/******************************************************************************/
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Dormand_Prince.h"
+#include "Math_Backend.h"
+#include "Warm_Start.h"
+
+/******************************************************************************/
+/*									Lookup									  */
+/******************************************************************************/
+Warm_Start_Cache& Warm_Start_Cache::shared(void) {
+    static Warm_Start_Cache cache;
+    return cache;
+}
+
+void Warm_Start_Cache::set_directory(const std::string& path) {
+    std::lock_guard<std::mutex> guard(lock);
+    directory = path;
+}
+
+void Warm_Start_Cache::clear(void) {
+    std::lock_guard<std::mutex> guard(lock);
+    states.clear();
+    numHits		= 0;
+    numMisses	= 0;
+}
+
+Warm_Start_Cache::Key Warm_Start_Cache::make_key(const Cortical_Column& C,
+                                                 const Simulation_Settings& Settings) {
+    const bool adaptive = Dormand_Prince::applicable(C, Settings);
+    return Key{{C.Model.sigma_p, C.Model.g_KNa, C.dphi, double(Settings.onset), double(Settings.res),
+                adaptive ? Settings.tolerance : 0.0, double(MATH_BACKEND)}};
+}
+
+Cortical_Column::State Warm_Start_Cache::get(const Cortical_Column& C,
+                                             const Simulation_Settings& Settings) {
+    const Key key = make_key(C, Settings);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = states.find(key);
+        if (it != states.end()) {
+            ++numHits;
+            return it->second;
+        }
+    }
+
+    /* Compute the transient without holding the lock. Threads that miss the
+     * same key at once compute the same state, the first one is kept */
+    Cortical_Column::State state;
+    if (!load(key, state)) {
+        double Par[3] = {C.Model.sigma_p, C.Model.g_KNa, C.dphi};
+        Cortical_Column Cortex(Par, Settings, 0, 0);
+        Dormand_Prince Solver(Cortex, Settings);
+        const bool adaptive = Dormand_Prince::applicable(Cortex, Settings);
+        for (int t=0; t < Settings.onset*Settings.res; ++t) {
+            if (adaptive) {
+                Solver.step();
+            } else {
+                Cortex.iterate_ODE();
+            }
+        }
+        state = Cortex.get_state();
+        store(key, state);
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    ++numMisses;
+    return states.emplace(key, state).first->second;
+}
+
+/******************************************************************************/
+/*									Files									  */
+/******************************************************************************/
+std::string Warm_Start_Cache::file_name(const Key& key) const {
+    /* The bit patterns of the key are exact and valid in file names */
+    std::string name = directory + "/warm";
+    for (double value : key) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        char hex[20];
+        std::snprintf(hex, sizeof(hex), "_%016" PRIx64, bits);
+        name += hex;
+    }
+    return name + ".bin";
+}
+
+bool Warm_Start_Cache::load(const Key& key, Cortical_Column::State& state) const {
+    if (directory.empty()) {
+        return false;
+    }
+    std::FILE* file = std::fopen(file_name(key).c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    char magic[8];
+    Key stored;
+    uint32_t Noise_count = 0;
+    bool good = std::fread(magic, 1, 8, file) == 8 && std::memcmp(magic, "NMSTATE", 8) == 0
+             && std::fread(stored.data(), sizeof(double), stored.size(), file) == stored.size()
+             && stored == key
+             && std::fread(state.y.data(), sizeof(double), state.y.size(), file) == state.y.size()
+             && std::fread(&state.input, sizeof(double), 1, file) == 1
+             && std::fread(&state.seed, sizeof(uint64_t), 1, file) == 1
+             && std::fread(&state.id, sizeof(uint32_t), 1, file) == 1
+             && std::fread(&state.position, sizeof(uint64_t), 1, file) == 1
+             && std::fread(&Noise_count, sizeof(uint32_t), 1, file) == 1
+             && std::fread(state.Rand_vars.data(), sizeof(double), state.Rand_vars.size(), file)
+                == state.Rand_vars.size();
+    std::fclose(file);
+    state.Noise_count = Noise_count;
+    return good && Noise_count >= 1 && Noise_count <= Cortical_Column::Noise_block
+                && state.position >= Cortical_Column::Noise_block;
+}
+
+void Warm_Start_Cache::store(const Key& key, const Cortical_Column::State& state) const {
+    if (directory.empty()) {
+        return;
+    }
+
+    /* Written to a temporary file first, so that other processes never read
+     * a partial state */
+    const std::string path = file_name(key);
+    const std::string temp = path + ".tmp"
+                           + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())
+                           + std::to_string(uintptr_t(&state));
+    std::FILE* file = std::fopen(temp.c_str(), "wb");
+    if (!file) {
+        return;
+    }
+    const uint32_t Noise_count = state.Noise_count;
+    bool good = std::fwrite("NMSTATE", 1, 8, file) == 8
+             && std::fwrite(key.data(), sizeof(double), key.size(), file) == key.size()
+             && std::fwrite(state.y.data(), sizeof(double), state.y.size(), file) == state.y.size()
+             && std::fwrite(&state.input, sizeof(double), 1, file) == 1
+             && std::fwrite(&state.seed, sizeof(uint64_t), 1, file) == 1
+             && std::fwrite(&state.id, sizeof(uint32_t), 1, file) == 1
+             && std::fwrite(&state.position, sizeof(uint64_t), 1, file) == 1
+             && std::fwrite(&Noise_count, sizeof(uint32_t), 1, file) == 1
+             && std::fwrite(state.Rand_vars.data(), sizeof(double), state.Rand_vars.size(), file)
+                == state.Rand_vars.size();
+    good = (std::fclose(file) == 0) && good;
+    if (!good || std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::remove(temp.c_str());
+    }
+}
+
+/******************************************************************************/
+/*								Warm start									  */
+/******************************************************************************/
+int warm_start(Cortical_Column& C, const Simulation_Settings& Settings,
+               uint64_t seed, uint32_t id) {
+    if (Settings.warm_start < 0) {
+        return 0;
+    }
+    C.set_state(Warm_Start_Cache::shared().get(C, Settings));
+    C.reseed(seed, id);
+
+    /* Decorrelation of the noise, which is part of the discarded onset */
+    Dormand_Prince Solver(C, Settings);
+    const bool adaptive = Dormand_Prince::applicable(C, Settings);
+    const int steps = (int) (Settings.warm_start * Settings.res);
+    for (int t=0; t < steps; ++t) {
+        if (adaptive) {
+            Solver.step();
+        } else {
+            C.iterate_ODE();
+        }
+    }
+    return Settings.onset*Settings.res;
+}
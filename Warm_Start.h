@@ -0,0 +1,91 @@
+/*
+ *	Copyright (c) 2015 University of Lübeck
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in
+ *	all copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *	THE SOFTWARE.
+ *
+ *	AUTHORS:	Michael Schellenberger Costa: mschellenbergercosta@gmail.com
+ */
+
+/******************************************************************************/
+/*					Warm start after the onset transient					  */
+/*																			  */
+/*	Every simulation discards the first onset seconds. The state of a column */
+/*	after the transient only depends on its parameters and the settings, so  */
+/*	it is computed once (with seed 0 and id 0 and without stimulation) and	  */
+/*	reused: a warm started column continues from the cached state with its	  */
+/*	own seed and is advanced by Settings.warm_start seconds, so that the	  */
+/*	noise of different runs decorrelates before data is recorded.			  */
+/*																			  */
+/*	The cache is shared by all threads of a process. If a directory is set,	  */
+/*	states are also stored there and found again by later processes. The	  */
+/*	file warm_<key>.bin in native byte order contains						  */
+/*																			  */
+/*	char[8] "NMSTATE", double[7] key, Cortical_Column::State fields in the	  */
+/*	order of declaration (y, input, seed, id, position, Noise_count as		  */
+/*	uint32, Rand_vars)														  */
+/*																			  */
+/*	The key consists of sigma_p, g_KNa, dphi, onset, res, the tolerance of	  */
+/*	the adaptive integrator (only for noise free columns) and MATH_BACKEND,	  */
+/*	as the backends give slightly different transients.						  */
+/******************************************************************************/
+#pragma once
+#include <array>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "Cortical_Column.h"
+#include "Simulation_Settings.h"
+
+class Warm_Start_Cache {
+public:
+    /* Cache of the process */
+    static Warm_Start_Cache& shared (void);
+
+    /* Directory for states across processes, empty for memory only */
+    void		set_directory	(const std::string& path);
+
+    /* State of the column C after the transient of Settings.onset seconds,
+     * which is computed (and stored) if it is not cached yet */
+    Cortical_Column::State	get	(const Cortical_Column& C, const Simulation_Settings& Settings);
+
+    /* Statistics of the lookups */
+    unsigned long	hits	(void) const {return numHits;}
+    unsigned long	misses	(void) const {return numMisses;}
+    void			clear	(void);
+private:
+    typedef std::array<double, 7> Key;
+
+    static Key			make_key	(const Cortical_Column& C, const Simulation_Settings& Settings);
+    std::string			file_name	(const Key& key) const;
+    bool				load		(const Key& key, Cortical_Column::State& state) const;
+    void				store		(const Key& key, const Cortical_Column::State& state) const;
+
+    std::mutex								lock;
+    std::string								directory;
+    std::map<Key, Cortical_Column::State>	states;
+    unsigned long							numHits		= 0;
+    unsigned long							numMisses	= 0;
+};
+
+/* Puts the column into the state after the onset, if Settings.warm_start is
+ * not negative. Returns the first time step of the simulation loop, which is
+ * Settings.onset*Settings.res for a warm start and 0 otherwise */
+int warm_start	(Cortical_Column& C, const Simulation_Settings& Settings,
+                 uint64_t seed, uint32_t id = 0);
@@ -0,0 +1,48 @@
+# Overhead of the Python module nm_cortex against the same simulations in C++.
+# Build the module first with: python setup.py build_ext --inplace
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import numpy as np
+import nm_cortex
+
+Param    = [6.5, 2.0, 2.0]		# N3 with noise
+var_stim = np.zeros(8)			# No stimulation
+repeats  = 20
+
+# Per call overhead for short and long simulations. Calls are interleaved and
+# the minimum over the repeats is used, as it is least affected by other load
+for T in [1, 10]:
+    native, python = [], []
+    for i in range(repeats):
+        native.append(nm_cortex.native_time(T, Param, var_stim, 1))
+        start = time.perf_counter()
+        nm_cortex.simulate(T, Param, var_stim, seed=1)
+        python.append(time.perf_counter() - start)
+    print('T = %2d s: C++ %8.3f ms, Python %8.3f ms, overhead %6.1f us per call'
+          % (T, 1E3*min(native), 1E3*min(python), 1E6*(min(python) - min(native))))
+
+# The outputs are views on the simulation buffers, no copy is made
+Vp, Vi, s_ep, s_ei, s_gp, s_gi, marker = nm_cortex.simulate(1, Param, var_stim)
+print('Vp owns its data: %s, Vp and Vi share the buffer: %s'
+      % (Vp.flags.owndata, Vp.base is Vi.base))
+
+# Thread pool, the GIL is released during the simulation
+T       = 5
+threads = 4
+jobs    = 4*threads
+start   = time.perf_counter()
+for i in range(jobs):
+    nm_cortex.simulate(T, Param, var_stim, seed=i)
+serial  = time.perf_counter() - start
+start   = time.perf_counter()
+with ThreadPoolExecutor(threads) as pool:
+    list(pool.map(lambda i: nm_cortex.simulate(T, Param, var_stim, seed=i), range(jobs)))
+pooled  = time.perf_counter() - start
+print('%d simulations: serial %.2f s, thread pool (%d) %.2f s' % (jobs, serial, threads, pooled))
+
+# Batched call over parameter sets
+Params  = np.array([[sigma_e, 2.0, 2.0] for sigma_e in np.linspace(4.6, 6.5, jobs)])
+start   = time.perf_counter()
+results = nm_cortex.simulate_batch(T, Params, var_stim, seed=1)
+print('%d simulations: simulate_batch %.2f s' % (len(results), time.perf_counter() - start))
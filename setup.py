@@ -0,0 +1,21 @@
+# Build of the Python module nm_cortex, see Cortex_py.cpp
+#   python setup.py build_ext --inplace
+from setuptools import setup, Extension
+import numpy
+
+nm_cortex = Extension('nm_cortex',
+                      sources=['Cortex_py.cpp',
+                               'Cortex_Model.cpp',
+                               'Cortical_Column.cpp',
+                               'Dormand_Prince.cpp',
+                               'Parameter_Sweep.cpp',
+                               'Spectral_Analysis.cpp',
+                               'Trace_Writer.cpp',
+                               'Warm_Start.cpp'],
+                      include_dirs=[numpy.get_include()],
+                      define_macros=[('MATH_BACKEND', '0')],
+                      extra_compile_args=['-std=c++11', '-O3', '-pthread'],
+                      extra_link_args=['-pthread'],
+                      language='c++')
+
+setup(name='nm_cortex', version='1.0', ext_modules=[nm_cortex])